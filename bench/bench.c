@@ -0,0 +1,426 @@
+/*! @file
+  @brief
+  Host benchmark runner of Ruby workloads.
+
+  <pre>
+  Copyright (C) 2015-2020 Kyushu Institute of Technology.
+  Copyright (C) 2015-2020 Shimane IT Open-Innovation Center.
+
+  This file is distributed under BSD 3-Clause License.
+
+  (usage)
+  $ make -C bench run			# build, and compare with baseline.txt
+  $ bench/build/mrbc_bench [options] workload...
+
+  -t MS		measure each workload for MS milliseconds. (default 1000)
+  -m KB		heap size. (default 256)
+  -b FILE	compare with the baseline.
+  -s FILE	save the results as a baseline.
+  -r PCT	exit 1 if a result is worse than the baseline by PCT %.
+  -c PROG	get the counts from PROG, the instrumented runner.
+
+  A workload is a .mrb file, or a directory of .mrb files which run as
+  tasks together. Each workload runs in its own process: one warm-up
+  run, and then repeated runs for the time. If the workload sets
+  $bench_ops, ops/s is runs/s * $bench_ops; otherwise an op is a run.
+  The timed runner is built without the counters, so that they don't
+  slow down the dispatch. The instrumented runner (mrbc_bench_count,
+  built with MRBC_OPCODE_STATS and MRBC_ALLOC_STATS) does one warm-up
+  run and one counted run (instructions, allocations, peak heap) in
+  another process.
+  </pre>
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+#include "mrubyc.h"
+
+#define MAX_TASKS	8
+#define MAX_WORKLOADS	64
+
+
+//================================================================
+/*! result of a workload.
+*/
+typedef struct BENCH_RESULT {
+  char name[32];
+  int ok;
+  double ops;		//!< ops per second.
+  double insns;		//!< VM instructions per run.
+  double allocs;	//!< allocations per run.
+  double peak;		//!< peak heap in bytes.
+} bench_result;
+
+
+static int time_ms = 1000;
+static int heap_kb = 256;
+static const char *counter;	//!< instrumented runner, or NULL.
+
+
+static uint8_t *read_file( const char *fname )
+{
+  FILE *fp = fopen(fname, "rb");
+  if( !fp ) {
+    perror(fname);
+    return NULL;
+  }
+  fseek(fp, 0, SEEK_END);
+  long size = ftell(fp);
+  fseek(fp, 0, SEEK_SET);
+
+  uint8_t *buf = malloc(size);
+  if( fread(buf, 1, size, fp) != (size_t)size ) {
+    perror(fname);
+    free(buf);
+    buf = NULL;
+  }
+  fclose(fp);
+  return buf;
+}
+
+
+static int cmp_str( const void *a, const void *b )
+{
+  return strcmp(*(const char **)a, *(const char **)b);
+}
+
+
+//================================================================
+/*! list the .mrb files of the workload, in name order.
+
+  @return	# of files.
+*/
+static int list_files( const char *path, char *files[] )
+{
+  struct stat st;
+  if( stat(path, &st) != 0 ) {
+    perror(path);
+    return 0;
+  }
+  if( !S_ISDIR(st.st_mode) ) {
+    files[0] = strdup(path);
+    return 1;
+  }
+
+  DIR *dir = opendir(path);
+  struct dirent *d;
+  int n = 0;
+  while( dir && (d = readdir(dir)) != NULL && n < MAX_TASKS ) {
+    size_t len = strlen(d->d_name);
+    if( len < 5 || strcmp(d->d_name + len - 4, ".mrb") != 0 ) continue;
+    files[n] = malloc(strlen(path) + len + 2);
+    sprintf(files[n++], "%s/%s", path, d->d_name);
+  }
+  if( dir ) closedir(dir);
+  qsort(files, n, sizeof(char *), cmp_str);
+  return n;
+}
+
+
+//================================================================
+/*! workload name from the path. ("build/greeter.mrb" -> "greeter")
+*/
+static void workload_name( const char *path, char *name, int size )
+{
+  int len = strlen(path);
+  while( len > 0 && path[len-1] == '/' ) len--;
+  const char *base = path + len;
+  while( base > path && base[-1] != '/' ) base--;
+
+  int n = path + len - base;
+  if( n > 4 && strncmp(base + n - 4, ".mrb", 4) == 0 ) n -= 4;
+  if( n >= size ) n = size - 1;
+  memcpy(name, base, n);
+  name[n] = 0;
+}
+
+
+//================================================================
+/*! run all tasks once.
+*/
+static void run_once( mrbc_tcb *tcb[], int n_tasks )
+{
+  int i;
+  for( i = 0; i < n_tasks; i++ ) {
+    mrbc_start_task(tcb[i]);
+  }
+  mrbc_run();
+}
+
+
+//================================================================
+/*! run the workload. (in the child process)
+*/
+static int run_workload( const char *path, bench_result *res )
+{
+  char *files[MAX_TASKS];
+  uint8_t *code[MAX_TASKS];
+  mrbc_tcb *tcb[MAX_TASKS];
+  int n_tasks = list_files(path, files);
+  int i;
+
+  if( n_tasks == 0 ) return -1;
+
+  uint8_t *heap = malloc(heap_kb * 1024);
+  mrbc_init(heap, heap_kb * 1024);
+
+  for( i = 0; i < n_tasks; i++ ) {
+    code[i] = read_file(files[i]);
+    if( !code[i] ) return -1;
+    tcb[i] = mrbc_create_task(code[i], NULL);
+    if( !tcb[i] ) return -1;
+  }
+
+  // warm-up.
+  mrbc_run();
+
+#if BENCH_COUNT
+  // counted run. (instrumented runner)
+#if MRBC_OPCODE_STATS
+  mrbc_opstat_clear(NULL);
+#endif
+#if MRBC_ALLOC_STATS
+  mrbc_alloc_stats_reset();
+#endif
+  run_once(tcb, n_tasks);
+
+#if MRBC_OPCODE_STATS
+  for( i = 0; i < MRBC_OPSTAT_N_OPCODES; i++ ) {
+    res->insns += mrbc_opstat_data.count[i];
+  }
+#endif
+#if MRBC_ALLOC_STATS
+  res->allocs = mrbc_alloc_counter.n_alloc + mrbc_alloc_counter.n_realloc;
+  res->peak = mrbc_alloc_counter.max_used;
+#endif
+  res->ok = 1;
+  return 0;
+
+#else
+  double ops_per_run = 1;
+  mrbc_sym sym_id = mrbc_search_symid("$bench_ops");
+  if( sym_id >= 0 ) {
+    mrbc_value *v = mrbc_get_global(sym_id);
+    if( v && v->tt == MRBC_TT_FIXNUM ) ops_per_run = v->i;
+  }
+
+  // timed runs.
+  long runs = 0;
+  uint64_t t0 = hal_time_us(), t;
+  do {
+    run_once(tcb, n_tasks);
+    runs++;
+    t = hal_time_us() - t0;
+  } while( t < (uint64_t)time_ms * 1000 );
+
+  res->ops = runs * ops_per_run * 1e6 / t;
+  res->ok = 1;
+  return 0;
+#endif
+}
+
+
+//================================================================
+/*! get the counts of the workload from the instrumented runner.
+*/
+static void count( const char *path, bench_result *res )
+{
+  bench_result cnt;
+  char fd_str[16], heap_str[16];
+  int fd[2];
+
+  if( pipe(fd) != 0 ) return;
+
+  fflush(stdout);
+  pid_t pid = fork();
+  if( pid == 0 ) {
+    close(fd[0]);
+    snprintf(fd_str, sizeof(fd_str), "%d", fd[1]);
+    snprintf(heap_str, sizeof(heap_str), "%d", heap_kb);
+    execl(counter, counter, "-m", heap_str, "-k", fd_str, path, (char *)NULL);
+    perror(counter);
+    _exit(1);
+  }
+
+  close(fd[1]);
+  if( pid > 0 && read(fd[0], &cnt, sizeof(cnt)) == sizeof(cnt) && cnt.ok ) {
+    res->insns = cnt.insns;
+    res->allocs = cnt.allocs;
+    res->peak = cnt.peak;
+  }
+  close(fd[0]);
+  if( pid > 0 ) waitpid(pid, NULL, 0);
+}
+
+
+//================================================================
+/*! run the workload in a child process.
+*/
+static void bench( const char *path, bench_result *res )
+{
+  int fd[2];
+
+  memset(res, 0, sizeof(*res));
+  workload_name(path, res->name, sizeof(res->name));
+  if( pipe(fd) != 0 ) return;
+
+  fflush(stdout);
+  pid_t pid = fork();
+  if( pid == 0 ) {
+    close(fd[0]);
+    run_workload(path, res);
+    if( write(fd[1], res, sizeof(*res)) != sizeof(*res) ) _exit(1);
+    _exit(0);
+  }
+
+  close(fd[1]);
+  if( pid < 0 || read(fd[0], res, sizeof(*res)) != sizeof(*res) ) {
+    res->ok = 0;
+  }
+  close(fd[0]);
+  if( pid > 0 ) waitpid(pid, NULL, 0);
+
+  if( res->ok && counter ) count(path, res);
+}
+
+
+//================================================================
+/*! load the baseline.
+
+  @return	# of results.
+*/
+static int load_baseline( const char *fname, bench_result base[] )
+{
+  FILE *fp = fopen(fname, "r");
+  char line[256];
+  int n = 0;
+
+  if( !fp ) {
+    perror(fname);
+    return 0;
+  }
+  while( n < MAX_WORKLOADS && fgets(line, sizeof(line), fp) ) {
+    bench_result *b = &base[n];
+    if( line[0] == '#' ) continue;
+    if( sscanf(line, "%31s %lf %lf %lf %lf", b->name, &b->ops,
+	       &b->insns, &b->allocs, &b->peak) == 5 ) {
+      b->ok = 1;
+      n++;
+    }
+  }
+  fclose(fp);
+  return n;
+}
+
+
+//================================================================
+/*! save the results as a baseline.
+*/
+static void save_baseline( const char *fname, const bench_result res[], int n )
+{
+  FILE *fp = fopen(fname, "w");
+  int i;
+
+  if( !fp ) {
+    perror(fname);
+    return;
+  }
+  fprintf(fp, "# name ops/s insns/run allocs/run peak_heap\n");
+  for( i = 0; i < n; i++ ) {
+    if( !res[i].ok ) continue;
+    fprintf(fp, "%s %.1f %.0f %.0f %.0f\n", res[i].name, res[i].ops,
+	    res[i].insns, res[i].allocs, res[i].peak);
+  }
+  fclose(fp);
+}
+
+
+//================================================================
+/*! print the change from the baseline.
+
+  @param  dir	1: larger is better, -1: smaller is better.
+  @return	1 if worse than the limit.
+*/
+static int print_delta( const char *label, double now, double base, int dir, double limit )
+{
+  if( base == 0 || now == base ) return 0;
+
+  double pct = (now - base) * 100 / base;
+  int worse = dir * pct < -limit;
+  printf("  %s %+.1f%%%s", label, pct, worse ? "!" : "");
+  return worse;
+}
+
+
+int main( int argc, char *argv[] )
+{
+  const char *baseline = NULL, *save = NULL;
+  double limit = -1;
+  int report_fd = -1;
+  int opt;
+
+  while( (opt = getopt(argc, argv, "t:m:b:s:r:c:k:")) != -1 ) {
+    switch( opt ) {
+    case 't': time_ms = atoi(optarg); break;
+    case 'm': heap_kb = atoi(optarg); break;
+    case 'b': baseline = optarg; break;
+    case 's': save = optarg; break;
+    case 'r': limit = atof(optarg); break;
+    case 'c': counter = optarg; break;
+    case 'k': report_fd = atoi(optarg); break;	// called by count().
+    default:
+      fprintf(stderr, "usage: %s [-t ms] [-m heap_kb] [-b baseline] [-s baseline] [-r pct] [-c counter] workload...\n", argv[0]);
+      return 2;
+    }
+  }
+
+  // instrumented runner. write the counts of a workload to the fd.
+  if( report_fd >= 0 ) {
+    bench_result r;
+    memset(&r, 0, sizeof(r));
+    if( optind < argc ) run_workload(argv[optind], &r);
+    return write(report_fd, &r, sizeof(r)) == sizeof(r) ? 0 : 1;
+  }
+
+  static bench_result res[MAX_WORKLOADS], base[MAX_WORKLOADS];
+  int n_base = baseline ? load_baseline(baseline, base) : 0;
+  int n = 0, n_worse = 0;
+  int i, j;
+
+  printf("%-16s %14s %12s %10s %10s\n",
+	 "WORKLOAD", "OPS/S", "INSNS/RUN", "ALLOCS", "PEAK HEAP");
+  for( i = optind; i < argc && n < MAX_WORKLOADS; i++, n++ ) {
+    bench_result *r = &res[n];
+    bench(argv[i], r);
+    if( !r->ok ) {
+      printf("%-16s failed\n", r->name);
+      n_worse++;
+      continue;
+    }
+    printf("%-16s %14.1f %12.0f %10.0f %10.0f",
+	   r->name, r->ops, r->insns, r->allocs, r->peak);
+
+    for( j = 0; j < n_base; j++ ) {
+      const bench_result *b = &base[j];
+      if( strcmp(b->name, r->name) != 0 ) continue;
+      double lim = limit < 0 ? 1e9 : limit;
+      int worse = print_delta("ops", r->ops, b->ops, 1, lim);
+      worse |= print_delta("insns", r->insns, b->insns, -1, lim);
+      worse |= print_delta("allocs", r->allocs, b->allocs, -1, lim);
+      worse |= print_delta("peak", r->peak, b->peak, -1, lim);
+      n_worse += worse;
+      break;
+    }
+    if( n_base && j == n_base ) printf("  (new)");
+    printf("\n");
+  }
+
+  if( save ) save_baseline(save, res, n);
+  return (limit >= 0 && n_worse) ? 1 : 0;
+}
@@ -0,0 +1,22 @@
+# Array and Hash churn: many short-lived containers.
+
+50.times do |i|
+  a = []
+  16.times do |j|
+    a.push((j * 7 + i) % 16)
+  end
+  a.sort!
+  a.shift
+
+  h = {}
+  a.each_with_index do |v, j|
+    h[j] = v
+  end
+  h.delete(0)
+
+  b = a.collect { |v| v + 1 }
+  b.pop
+  raise "collection" if h.size != 14 || b.size != 14
+end
+
+$bench_ops = 50
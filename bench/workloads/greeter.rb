@@ -0,0 +1,35 @@
+# Method-call heavy OOP: instance variables, accessors, inheritance and super.
+
+class Greeter
+  attr_reader :name
+
+  def initialize(name)
+    @name = name
+    @count = 0
+  end
+
+  def greet
+    @count += 1
+    "Hello, " + @name
+  end
+
+  def count
+    @count
+  end
+end
+
+class LoudGreeter < Greeter
+  def greet
+    super + "!"
+  end
+end
+
+greeters = [Greeter.new("ESP32"), LoudGreeter.new("mruby/c")]
+n = 0
+500.times do |i|
+  g = greeters[i % 2]
+  n += g.greet.size + g.name.size
+end
+raise "greeter" if greeters[0].count != 250
+
+$bench_ops = 500
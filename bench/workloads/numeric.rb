@@ -0,0 +1,19 @@
+# Numeric loops: Integer and Float arithmetic, comparisons and recursion.
+
+def fib(n)
+  n < 2 ? n : fib(n - 1) + fib(n - 2)
+end
+
+s = 0
+i = 0
+while i < 1000
+  s += i * i % 7
+  i += 1
+end
+
+x = 0.0
+200.times do |k|
+  x = x * 0.5 + k / 3.0
+end
+
+raise "numeric" if fib(15) != 610
@@ -0,0 +1,18 @@
+# Multi-task ping-pong through a Mutex, with pong.rb.
+# ping hits when the ball is even, pong when it is odd.
+
+$mutex ||= Mutex.new
+$ball ||= 0
+
+hits = 0
+while hits < 100
+  $mutex.lock
+  if $ball % 2 == 0
+    $ball += 1
+    hits += 1
+  end
+  $mutex.unlock
+  relinquish
+end
+
+$bench_ops = 200
@@ -0,0 +1,15 @@
+# Multi-task ping-pong through a Mutex, with ping.rb.
+
+$mutex ||= Mutex.new
+$ball ||= 0
+
+hits = 0
+while hits < 100
+  $mutex.lock
+  if $ball % 2 == 1
+    $ball += 1
+    hits += 1
+  end
+  $mutex.unlock
+  relinquish
+end
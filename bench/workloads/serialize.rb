@@ -0,0 +1,29 @@
+# Serialization: encode records to "key=value;" text and decode them back.
+
+def encode(rec)
+  s = ""
+  rec.each do |k, v|
+    s << k
+    s << "="
+    s << v.to_s
+    s << ";"
+  end
+  s
+end
+
+def decode(s)
+  rec = {}
+  s.split(";").each do |kv|
+    pair = kv.split("=")
+    rec[pair[0]] = pair[1].to_i
+  end
+  rec
+end
+
+rec = {"id" => 0, "temp" => 25, "hum" => 60, "press" => 1013}
+100.times do |i|
+  rec["id"] = i
+  raise "serialize" if decode(encode(rec))["id"] != i
+end
+
+$bench_ops = 100
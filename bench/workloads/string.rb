@@ -0,0 +1,20 @@
+# String building and parsing: <<, +, split, join, strip and to_i.
+
+line = ""
+20.times do |i|
+  line << i.to_s
+  line << ","
+end
+
+sum = 0
+50.times do
+  fields = line.split(",")
+  fields.each do |f|
+    sum += f.strip.to_i
+  end
+  csv = "  " + fields.join(":") + "  "
+  sum += csv.strip.size
+end
+raise "string" if sum != 50 * (190 + 49)
+
+$bench_ops = 50
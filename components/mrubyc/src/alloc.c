@@ -49,6 +49,7 @@
 #include "vm.h"
 #include "alloc.h"
 #include "hal/hal.h"
+#include "console.h"
 
 /***** Constant values ******************************************************/
 /*
@@ -191,8 +192,32 @@ static uint8_t  free_sli_bitmap[MRBC_ALLOC_FLI_BIT_WIDTH +1+1]; // + sentinel
 
 
 /***** Global variables *****************************************************/
+#if MRBC_ALLOC_STATS
+mrbc_alloc_stats mrbc_alloc_counter;
+#endif
+
+
 /***** Signal catching functions ********************************************/
 /***** Local functions ******************************************************/
+//================================================================
+/*! count the allocation and the change of used size.
+
+  @param  n	# of allocated (1) or released (-1) blocks.
+  @param  diff	change of used bytes.
+*/
+static inline void count_alloc(int n, int diff)
+{
+#if MRBC_ALLOC_STATS
+  if( n > 0 ) mrbc_alloc_counter.n_alloc++;
+  if( n < 0 ) mrbc_alloc_counter.n_free++;
+  mrbc_alloc_counter.used += diff;
+  if( mrbc_alloc_counter.used > mrbc_alloc_counter.max_used ) {
+    mrbc_alloc_counter.max_used = mrbc_alloc_counter.used;
+  }
+#endif
+}
+
+
 //================================================================
 /*! Number of leading zeros. 16bit version.
 
@@ -479,7 +504,11 @@ void * mrbc_raw_alloc(unsigned int size)
   if( target ) goto SPLIT_BLOCK;
 
   // else out of memory
+#if MRBC_ALLOC_STATS
+  mrbc_alloc_counter.n_fail++;
+#endif
   static const char msg[] = "Fatal error: Out of memory.\n";
+  mrbc_console_flush();
   hal_write(1, msg, sizeof(msg)-1);
   return NULL;  // ENOMEM
 
@@ -527,6 +556,7 @@ void * mrbc_raw_alloc(unsigned int size)
   memset( (uint8_t *)target + sizeof(USED_BLOCK), 0xaa,
           BLOCK_SIZE(target) - sizeof(USED_BLOCK) );
 #endif
+  count_alloc( 1, BLOCK_SIZE(target) );
 
   return (uint8_t *)target + sizeof(USED_BLOCK);
 }
@@ -572,6 +602,7 @@ void * mrbc_raw_alloc_no_free(unsigned int size)
     prev->size -= alloc_size;		// w/ flags.
     add_free_block( prev );
   }
+  count_alloc( 1, BLOCK_SIZE(tail) );
 
   return (uint8_t *)tail + sizeof(USED_BLOCK);
 
@@ -589,6 +620,7 @@ void mrbc_raw_free(void *ptr)
 {
   // get target block
   FREE_BLOCK *target = (FREE_BLOCK *)((uint8_t *)ptr - sizeof(USED_BLOCK));
+  count_alloc( -1, -(int)BLOCK_SIZE(target) );
 
   // check next block, merge?
   FREE_BLOCK *next = PHYS_NEXT(target);
@@ -626,6 +658,7 @@ void * mrbc_raw_realloc(void *ptr, unsigned int size)
 {
   USED_BLOCK *target = (USED_BLOCK *)((uint8_t *)ptr - sizeof(USED_BLOCK));
   unsigned int alloc_size = size + sizeof(USED_BLOCK);
+  unsigned int old_size = BLOCK_SIZE(target);
   FREE_BLOCK *next;
 
   // align 4 byte
@@ -648,10 +681,14 @@ void * mrbc_raw_realloc(void *ptr, unsigned int size)
 
   // try shrink.
   FREE_BLOCK *release = split_block((FREE_BLOCK *)target, alloc_size);
+#if MRBC_ALLOC_STATS
+  mrbc_alloc_counter.n_realloc++;
+#endif
   if( release != NULL ) {
     SET_PREV_USED(release);
   } else {
     SET_PREV_USED(next);
+    count_alloc( 0, BLOCK_SIZE(target) - old_size );
     return ptr;
   }
 
@@ -663,6 +700,7 @@ void * mrbc_raw_realloc(void *ptr, unsigned int size)
     SET_PREV_FREE(next);
   }
   add_free_block(release);
+  count_alloc( 0, BLOCK_SIZE(target) - old_size );
   return ptr;
 
 
@@ -671,6 +709,11 @@ void * mrbc_raw_realloc(void *ptr, unsigned int size)
  ALLOC_AND_COPY: {
     uint8_t *new_ptr = mrbc_raw_alloc(size);
     if( new_ptr == NULL ) return NULL;  // ENOMEM
+#if MRBC_ALLOC_STATS
+    mrbc_alloc_counter.n_realloc++;
+    mrbc_alloc_counter.n_alloc--;	// counted as a re-allocation.
+    mrbc_alloc_counter.n_free--;
+#endif
 
     memcpy(new_ptr, ptr, BLOCK_SIZE(target) - sizeof(USED_BLOCK));
     SET_VM_ID(new_ptr, target->vm_id);
@@ -762,6 +805,20 @@ int mrbc_get_vm_id(void *ptr)
 }
 
 
+#if MRBC_ALLOC_STATS
+//================================================================
+/*! clear the counters, and start the peak from the current usage.
+*/
+void mrbc_alloc_stats_reset(void)
+{
+  uint32_t used = mrbc_alloc_counter.used;
+  memset( &mrbc_alloc_counter, 0, sizeof(mrbc_alloc_counter) );
+  mrbc_alloc_counter.used = used;
+  mrbc_alloc_counter.max_used = used;
+}
+#endif
+
+
 #if defined(MRBC_DEBUG)
 #include "stdio.h"
 //================================================================
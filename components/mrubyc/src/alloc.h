@@ -22,16 +22,32 @@ extern "C" {
 
 /***** Feature test switches ************************************************/
 /***** System headers *******************************************************/
+#include <stdint.h>
 #if defined(MRBC_ALLOC_LIBC)
 #include <stdlib.h>
 #endif
 
 /***** Local headers ********************************************************/
+#include "vm_config.h"
+
 /***** Constant values ******************************************************/
 /***** Macros ***************************************************************/
 /***** Typedefs *************************************************************/
 struct VM;
 
+//================================================================
+/*!@brief
+  Allocation counters. (need MRBC_ALLOC_STATS)
+*/
+typedef struct ALLOC_STATS {
+  uint32_t n_alloc;	//!< # of allocated blocks.
+  uint32_t n_free;	//!< # of released blocks.
+  uint32_t n_realloc;	//!< # of re-allocations.
+  uint32_t n_fail;	//!< # of failed allocations. (out of memory)
+  uint32_t used;	//!< bytes in use, block headers included.
+  uint32_t max_used;	//!< peak of used.
+} mrbc_alloc_stats;
+
 /***** Global variables *****************************************************/
 /***** Function prototypes **************************************************/
 #if !defined(MRBC_ALLOC_LIBC)
@@ -50,6 +66,11 @@ int mrbc_get_vm_id(void *ptr);
 // for statistics or debug. (need #define MRBC_DEBUG)
 void mrbc_alloc_statistics(int *total, int *used, int *free, int *fragmentation);
 int mrbc_alloc_vm_used(int vm_id);
+
+#if MRBC_ALLOC_STATS
+extern mrbc_alloc_stats mrbc_alloc_counter;
+void mrbc_alloc_stats_reset(void);
+#endif
 #endif
 
 
@@ -0,0 +1,520 @@
+/*! @file
+  @brief
+  Static resource analysis of bytecode.
+
+  <pre>
+  Copyright (C) 2015-2020 Kyushu Institute of Technology.
+  Copyright (C) 2015-2020 Shimane IT Open-Innovation Center.
+
+  This file is distributed under BSD 3-Clause License.
+
+  </pre>
+
+  <pre>
+  Estimates resources which the program needs, to size MAX_REGS_SIZE,
+  MAX_SYMBOLS_COUNT and the memory pool.
+
+  Call graph is made by method name. A call to the method which is
+  defined in the irep tree (OP_METHOD and OP_DEF) counts the frame of
+  the method, other calls are regarded as C functions.
+  Blocks given by OP_SENDB are counted on the frame of called method.
+  Recursive call makes call depth unbounded.
+  Procs called by Proc#call and methods defined in other images are
+  not traced, so the result is a guide, not a guarantee.
+  </pre>
+*/
+
+#include "vm_config.h"
+#include <stdint.h>
+#include <string.h>
+
+#include "vm.h"
+#include "alloc.h"
+#include "class.h"
+#include "symbol.h"
+#include "opcode.h"
+#include "console.h"
+#include "c_string.h"
+#include "c_array.h"
+#include "c_hash.h"
+#include "c_range.h"
+#include "rrt0.h"
+#include "verify.h"
+#include "analyze.h"
+
+
+//================================================================
+/*! work area for each irep.
+*/
+typedef struct IREP_NODE {
+  const mrbc_irep *irep;
+  const char *name;		//!< method name if defined by OP_DEF.
+  int16_t depth;		//!< call depth. (-1: unbounded)
+  int16_t regs;			//!< registers needed. (-1: unbounded)
+  uint8_t state;		//!< 0:not visited, 1:visiting, 2:done
+  uint16_t alloc_sites;		//!< # of instructions which make objects.
+  uint32_t object_bytes;	//!< heap used by the alloc sites.
+} irep_node;
+
+typedef struct ANALYZER {
+  irep_node *node;
+  int n_nodes;
+  const char *recursion;	//!< method name which makes recursion.
+} analyzer;
+
+
+//================================================================
+/*! size of memory block made by mrbc_alloc(). (approx. see alloc.c)
+*/
+static uint32_t block_size( uint32_t size )
+{
+  const uint32_t min_size = 4 + sizeof(void *) * 3;
+
+  if( size == 0 ) return 0;
+  size = (size + 4 + 3) & ~3;		// header and alignment.
+  return size < min_size ? min_size : size;
+}
+
+
+//================================================================
+/*! get n'th symbol string in the irep.
+*/
+static const char * irep_symbol( const mrbc_irep *irep, int n )
+{
+  const uint8_t *p = irep->ptr_to_sym + 4;
+
+  while( n-- > 0 ) {
+    p += 2 + bin_to_uint16(p) + 1;	// size(2 bytes) + symbol len + '\0'
+  }
+  return (const char *)p + 2;
+}
+
+
+//================================================================
+/*! count ireps in the tree.
+*/
+static int count_ireps( const mrbc_irep *irep )
+{
+  int n = 1;
+  int i;
+  for( i = 0; i < irep->rlen; i++ ) {
+    n += count_ireps( irep->reps[i] );
+  }
+  return n;
+}
+
+
+//================================================================
+/*! register all ireps in the tree. (preorder)
+*/
+static void collect_ireps( analyzer *a, const mrbc_irep *irep )
+{
+  a->node[a->n_nodes++].irep = irep;
+
+  int i;
+  for( i = 0; i < irep->rlen; i++ ) {
+    collect_ireps( a, irep->reps[i] );
+  }
+}
+
+
+//================================================================
+/*! find node of the irep.
+*/
+static irep_node * find_node( analyzer *a, const mrbc_irep *irep )
+{
+  int i;
+  for( i = 0; i < a->n_nodes; i++ ) {
+    if( a->node[i].irep == irep ) return &a->node[i];
+  }
+  return NULL;
+}
+
+
+//================================================================
+/*! scan the irep, to find method names and alloc sites.
+*/
+static void scan_irep( analyzer *a, irep_node *nd )
+{
+  const mrbc_irep *irep = nd->irep;
+  int method_reg = -1;
+  int method_rep = 0;
+  int pc = 0;
+  int ext = 0;
+  uint32_t opr[3];
+
+  while( pc < irep->ilen ) {
+    int op = irep->code[pc++];
+    int len = mrbc_decode_operands( irep, pc, op, ext, opr );
+    if( len < 0 ) break;
+    pc += len;
+    ext = (op >= OP_EXT1 && op <= OP_EXT3) ? op - OP_EXT1 + 1 : 0;
+
+    uint32_t size = 0;
+    switch( op ) {
+    case OP_METHOD:
+      method_reg = opr[0];
+      method_rep = opr[1];
+      size = block_size( sizeof(mrbc_proc) );
+      break;
+
+    case OP_DEF:
+      if( opr[0] + 1 == method_reg ) {
+	find_node( a, irep->reps[method_rep] )->name = irep_symbol( irep, opr[1] );
+      }
+      method_reg = -1;
+      break;
+
+    case OP_STRING:
+      /* CAUTION: pool_obj->str - 2. see IREP POOL structure. */
+      size = block_size( sizeof(mrbc_string) ) +
+	block_size( bin_to_uint16(irep->pools[opr[1]]->str - 2) + 1 );
+      break;
+
+    case OP_ARRAY:
+      size = block_size( sizeof(mrbc_array) ) +
+	block_size( sizeof(mrbc_value) * opr[1] );
+      break;
+
+    case OP_ARRAY2:
+      size = block_size( sizeof(mrbc_array) ) +
+	block_size( sizeof(mrbc_value) * opr[2] );
+      break;
+
+    case OP_HASH:
+      size = block_size( sizeof(mrbc_hash) ) +
+	block_size( sizeof(mrbc_value) * opr[1] * 2 );
+      break;
+
+    case OP_RANGE_INC:
+    case OP_RANGE_EXC:
+      size = block_size( sizeof(mrbc_range) );
+      break;
+
+    case OP_LAMBDA:
+    case OP_BLOCK:
+      size = block_size( sizeof(mrbc_proc) );
+      break;
+
+    case OP_CLASS:
+    case OP_MODULE:
+      size = block_size( sizeof(mrbc_class) );
+      break;
+
+    default:
+      continue;
+    }
+
+    if( size == 0 ) continue;
+    nd->alloc_sites++;
+    nd->object_bytes += size;
+  }
+}
+
+
+static void visit( analyzer *a, irep_node *nd );
+
+//================================================================
+/*! calculate cost of calling the method by name.
+
+  @param  a	analyzer.
+  @param  name	method name.
+  @param  self	node to be excluded. (for super)
+  @param  depth	returns call depth.
+  @param  regs	returns registers needed.
+  @return	1 if found, 0 if not found, -1 if unbounded.
+*/
+static int call_cost( analyzer *a, const char *name, const irep_node *self, int *depth, int *regs )
+{
+  int found = 0;
+  int i;
+
+  *depth = 0;
+  *regs = 0;
+  for( i = 0; i < a->n_nodes; i++ ) {
+    irep_node *nd = &a->node[i];
+    if( nd == self || !nd->name || strcmp( nd->name, name ) != 0 ) continue;
+
+    visit( a, nd );
+    if( nd->state != 2 || nd->depth < 0 ) {
+      if( !a->recursion ) a->recursion = name;
+      return -1;
+    }
+
+    found = 1;
+    if( nd->depth > *depth ) *depth = nd->depth;
+    if( nd->regs > *regs ) *regs = nd->regs;
+  }
+
+  return found;
+}
+
+
+//================================================================
+/*! calculate call depth and registers of the irep.
+*/
+static void visit( analyzer *a, irep_node *nd )
+{
+  if( nd->state != 0 ) return;		// done or recursion.
+  nd->state = 1;
+
+  const mrbc_irep *irep = nd->irep;
+  int depth = 0;
+  int regs = irep->nregs;
+  int unbounded = 0;
+  int block_rep = -1;
+  int pc = 0;
+  int ext = 0;
+  uint32_t opr[3];
+
+  while( pc < irep->ilen && !unbounded ) {
+    int op = irep->code[pc++];
+    int len = mrbc_decode_operands( irep, pc, op, ext, opr );
+    if( len < 0 ) break;
+    pc += len;
+    ext = (op >= OP_EXT1 && op <= OP_EXT3) ? op - OP_EXT1 + 1 : 0;
+
+    int d = 0, r = 0;
+    switch( op ) {
+    case OP_BLOCK:
+      block_rep = opr[1];
+      continue;
+
+    case OP_SEND:
+    case OP_SENDB:
+    case OP_SENDV:
+    case OP_SENDVB:
+    case OP_SUPER: {
+      const char *name;
+      int argc;
+      if( op == OP_SUPER ) {
+	name = nd->name;
+	argc = opr[1];
+      } else {
+	name = irep_symbol( irep, opr[1] );
+	argc = (op == OP_SEND || op == OP_SENDB) ? opr[2] : 1;
+      }
+      if( argc == 127 ) argc = 1;	// args are packed in array.
+
+      int found = name ? call_cost( a, name, nd, &d, &r ) : 0;
+      if( found < 0 ) {
+	unbounded = 1;
+	break;
+      }
+      if( found == 0 ) r = argc + 2;	// C function. receiver, args and block.
+
+      if( (op == OP_SENDB || op == OP_SENDVB) && block_rep >= 0 ) {
+	irep_node *blk = find_node( a, irep->reps[block_rep] );
+	visit( a, blk );
+	if( blk->state != 2 || blk->depth < 0 ) {
+	  unbounded = 1;
+	  break;
+	}
+	d += blk->depth;
+	r += blk->regs;
+      }
+      block_rep = -1;
+      r += opr[0];
+    } break;
+
+    case OP_EXEC: {
+      irep_node *body = find_node( a, irep->reps[opr[1]] );
+      visit( a, body );
+      if( body->state != 2 || body->depth < 0 ) {
+	unbounded = 1;
+	break;
+      }
+      d = body->depth;
+      r = opr[0] + body->regs;
+    } break;
+
+    default:
+      continue;
+    }
+
+    if( d > depth ) depth = d;
+    if( r > regs ) regs = r;
+  }
+
+  nd->depth = unbounded ? -1 : depth + 1;
+  nd->regs = unbounded ? -1 : regs;
+  nd->state = 2;
+}
+
+
+//================================================================
+/*! check if the symbol appears before. (in the preceding ireps or symbols)
+*/
+static int symbol_seen( const analyzer *a, int idx, int n, const char *str )
+{
+  int i, j;
+  for( i = 0; i <= idx; i++ ) {
+    const mrbc_irep *irep = a->node[i].irep;
+    int n_syms = (i == idx) ? n : bin_to_uint32( irep->ptr_to_sym );
+    for( j = 0; j < n_syms; j++ ) {
+      if( strcmp( irep_symbol( irep, j ), str ) == 0 ) return 1;
+    }
+  }
+  return 0;
+}
+
+
+//================================================================
+/*! prepare the analyzer.
+
+  @return	zero if no error.
+*/
+static int analyzer_open( analyzer *a, const mrbc_irep *irep )
+{
+  int n = count_ireps( irep );
+
+  a->node = mrbc_raw_alloc( sizeof(irep_node) * n );
+  if( !a->node ) return -1;	// ENOMEM
+  memset( a->node, 0, sizeof(irep_node) * n );
+  a->n_nodes = 0;
+  a->recursion = NULL;
+
+  collect_ireps( a, irep );
+
+  int i;
+  for( i = 0; i < n; i++ ) {
+    scan_irep( a, &a->node[i] );
+  }
+  for( i = 0; i < n; i++ ) {
+    visit( a, &a->node[i] );	// methods are also entry points.
+  }
+
+  return 0;
+}
+
+
+//================================================================
+/*! analyze the irep tree.
+*/
+static void analyze_sub( analyzer *a, mrbc_analyze_info *info )
+{
+  memset( info, 0, sizeof(mrbc_analyze_info) );
+  info->n_ireps = a->n_nodes;
+
+  int i, j;
+  for( i = 0; i < a->n_nodes; i++ ) {
+    const irep_node *nd = &a->node[i];
+    const mrbc_irep *irep = nd->irep;
+
+    if( irep->nregs > info->max_nregs ) info->max_nregs = irep->nregs;
+    if( info->max_call_depth >= 0 ) {
+      if( nd->depth < 0 ) {
+	info->max_call_depth = info->max_regs = -1;
+      } else {
+	if( nd->depth > info->max_call_depth ) info->max_call_depth = nd->depth;
+	if( nd->regs > info->max_regs ) info->max_regs = nd->regs;
+      }
+    }
+    info->n_alloc_sites += nd->alloc_sites;
+    info->object_bytes += nd->object_bytes;
+
+    info->irep_bytes += block_size( sizeof(mrbc_irep) ) +
+      block_size( sizeof(mrbc_irep *) * irep->rlen ) +
+      block_size( sizeof(mrbc_object *) * irep->plen ) +
+      block_size( sizeof(mrbc_object) ) * irep->plen;
+    if( irep->hlen ) {
+      info->irep_bytes += block_size( sizeof(mrbc_irep_handler) * irep->hlen );
+    }
+
+    for( j = 0; j < irep->plen; j++ ) {
+      if( irep->pools[j]->tt != MRBC_TT_STRING ) continue;
+      info->literal_bytes += bin_to_uint16(irep->pools[j]->str - 2) + 1;
+    }
+
+    int n_syms = bin_to_uint32( irep->ptr_to_sym );
+    for( j = 0; j < n_syms; j++ ) {
+      const char *str = irep_symbol( irep, j );
+      if( symbol_seen( a, i, j, str ) ) continue;
+      info->n_symbols++;
+      if( mrbc_search_symid( str ) < 0 ) info->n_new_symbols++;
+    }
+  }
+
+  if( info->max_call_depth > 1 ) {
+    info->callinfo_bytes = block_size( sizeof(mrbc_callinfo) ) *
+      (info->max_call_depth - 1);
+  }
+}
+
+
+//================================================================
+/*! analyze resources which the program needs.
+
+  @param  irep	top irep. (loaded by mrbc_load_mrb)
+  @param  info	returns result.
+  @return int	zero if no error.
+*/
+int mrbc_analyze_irep( const mrbc_irep *irep, mrbc_analyze_info *info )
+{
+  analyzer a;
+  if( analyzer_open( &a, irep ) != 0 ) return -1;
+
+  analyze_sub( &a, info );
+
+  mrbc_raw_free( a.node );
+  return 0;
+}
+
+
+//================================================================
+/*! print analysis and recommended configuration.
+
+  @param  irep	top irep. (loaded by mrbc_load_mrb)
+*/
+void mrbc_analyze_print( const mrbc_irep *irep )
+{
+  analyzer a;
+  mrbc_analyze_info info;
+  int i;
+
+  if( analyzer_open( &a, irep ) != 0 ) return;
+  analyze_sub( &a, &info );
+
+  console_printf("IREP NREGS NLOCALS  ILEN PLEN RLEN ALLOC(bytes) DEPTH REGS NAME\n");
+  for( i = 0; i < a.n_nodes; i++ ) {
+    const irep_node *nd = &a.node[i];
+    console_printf("%4d %5d %7d %5d %4d %4d %5d(%5d) %5d %4d %s\n", i,
+		   nd->irep->nregs, nd->irep->nlocals, nd->irep->ilen,
+		   nd->irep->plen, nd->irep->rlen,
+		   nd->alloc_sites, nd->object_bytes,
+		   nd->depth, nd->regs, nd->name ? nd->name : "");
+  }
+
+  int used_syms;
+  mrbc_symbol_statistics( &used_syms );
+  int regs = info.max_regs < 0 ? MAX_REGS_SIZE : info.max_regs;
+  uint32_t task_bytes = block_size( sizeof(mrbc_tcb) -
+				    sizeof(mrbc_value) * (MAX_REGS_SIZE - regs) );
+  uint32_t total = info.irep_bytes + task_bytes +
+    info.callinfo_bytes + info.object_bytes;
+
+  console_printf("\n");
+  if( info.max_call_depth < 0 ) {
+    console_printf("Call depth: unbounded (recursive call of '%s')\n",
+		   a.recursion ? a.recursion : "?");
+  } else {
+    console_printf("Call depth: %d\n", info.max_call_depth);
+  }
+  console_printf("Symbols: %d in image, %d new, %d/%d used\n",
+		 info.n_symbols, info.n_new_symbols, used_syms, MAX_SYMBOLS_COUNT);
+  console_printf("String literals: %d bytes\n", info.literal_bytes);
+  console_printf("Heap: irep %d + task %d + callinfo %d + objects %d = %d bytes\n",
+		 info.irep_bytes, task_bytes, info.callinfo_bytes,
+		 info.object_bytes, total);
+
+  console_printf("\nRecommended:\n");
+  if( info.max_regs < 0 ) {
+    console_printf(" MAX_REGS_SIZE      %d (unbounded, keep current)\n", MAX_REGS_SIZE);
+  } else {
+    console_printf(" MAX_REGS_SIZE      %d\n", info.max_regs);
+  }
+  console_printf(" MAX_SYMBOLS_COUNT  %d\n", used_syms + info.n_new_symbols);
+  console_printf(" memory pool        %d + runtime objects (bytes)\n", total);
+
+  mrbc_raw_free( a.node );
+}
@@ -0,0 +1,51 @@
+/*! @file
+  @brief
+  Static resource analysis of bytecode.
+
+  <pre>
+  Copyright (C) 2015-2020 Kyushu Institute of Technology.
+  Copyright (C) 2015-2020 Shimane IT Open-Innovation Center.
+
+  This file is distributed under BSD 3-Clause License.
+
+  </pre>
+*/
+
+#ifndef MRBC_SRC_ANALYZE_H_
+#define MRBC_SRC_ANALYZE_H_
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct IREP;
+
+//================================================================
+/*!@brief
+  Result of analysis.
+*/
+typedef struct MRBC_ANALYZE_INFO {
+  uint16_t n_ireps;		//!< # of ireps in the tree.
+  uint16_t max_nregs;		//!< max nregs of an irep.
+  int16_t  max_call_depth;	//!< worst case call depth. (-1: unbounded)
+  int16_t  max_regs;		//!< registers needed by worst case path. (-1: unbounded)
+  uint16_t n_symbols;		//!< # of distinct symbols in the tree.
+  uint16_t n_new_symbols;	//!< # of symbols not registered yet.
+  uint16_t n_alloc_sites;	//!< # of instructions which make objects.
+  uint32_t literal_bytes;	//!< size of string literals. (in the image)
+  uint32_t irep_bytes;		//!< heap used by ireps and pools after loading.
+  uint32_t object_bytes;	//!< heap used when each alloc site runs once.
+  uint32_t callinfo_bytes;	//!< heap used by callinfo at worst case depth.
+} mrbc_analyze_info;
+
+
+int mrbc_analyze_irep(const struct IREP *irep, mrbc_analyze_info *info);
+void mrbc_analyze_print(const struct IREP *irep);
+
+
+#ifdef __cplusplus
+}
+#endif
+#endif
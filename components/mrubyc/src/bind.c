@@ -0,0 +1,81 @@
+/*! @file
+  @brief
+  Declarative binding of C functions as methods.
+
+  <pre>
+  Copyright (C) 2015-2020 Kyushu Institute of Technology.
+  Copyright (C) 2015-2020 Shimane IT Open-Innovation Center.
+
+  This file is distributed under BSD 3-Clause License.
+
+  </pre>
+*/
+
+#include "vm_config.h"
+
+#include "value.h"
+#include "class.h"
+#include "console.h"
+#include "bind.h"
+
+
+//================================================================
+/*! argument error of the method made by MRBC_BIND_n()
+
+  @param  vm		pointer to vm.
+  @param  v		receiver and params.
+  @param  argc		num of params.
+  @param  min		min num of params.
+  @param  max		max num of params.
+*/
+void mrbc_bind_error( struct VM *vm, mrbc_value v[], int argc, int min, int max )
+{
+  if( argc < min || argc > max ) {
+    console_printf("ArgumentError: wrong number of arguments (given %d, expected %d",
+		   argc, min);
+    if( min != max ) console_printf("..%d", max);
+    console_printf(")\n");
+  } else {
+    console_printf("TypeError: wrong argument type.\n");
+  }
+
+  SET_NIL_RETURN();
+}
+
+
+//================================================================
+/*! define methods by table.
+
+  @param  vm		pointer to vm.
+  @param  cls		class.
+  @param  table		method table.
+  @param  n		num of entries.
+*/
+void mrbc_define_methods( struct VM *vm, mrbc_class *cls,
+			  const mrbc_method_table *table, int n )
+{
+  int i;
+  for( i = 0; i < n; i++ ) {
+    mrbc_define_method( vm, cls, table[i].name, table[i].func );
+  }
+}
+
+
+//================================================================
+/*! define class and its methods by table.
+
+  @param  vm		pointer to vm.
+  @param  name		class name.
+  @param  super		super class, or NULL (Object).
+  @param  table		method table.
+  @param  n		num of entries.
+  @return		pointer to class.
+*/
+mrbc_class * mrbc_define_class_with_methods( struct VM *vm, const char *name,
+	mrbc_class *super, const mrbc_method_table *table, int n )
+{
+  mrbc_class *cls = mrbc_define_class( vm, name, super );
+  if( cls ) mrbc_define_methods( vm, cls, table, n );
+
+  return cls;
+}
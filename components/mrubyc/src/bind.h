@@ -0,0 +1,182 @@
+/*! @file
+  @brief
+  Declarative binding of C functions as methods.
+
+  <pre>
+  Copyright (C) 2015-2020 Kyushu Institute of Technology.
+  Copyright (C) 2015-2020 Shimane IT Open-Innovation Center.
+
+  This file is distributed under BSD 3-Clause License.
+
+  </pre>
+
+  <pre>
+  MRBC_BIND_n() makes a method function which checks arity and types,
+  unpacks the arguments and sets the return value, from the plain C
+  function. All of them are expanded at compile time.
+
+  (usage)
+  static int add( int a, int b ) { return a + b; }
+  static double scale( double x, double k ) { return x * k; }
+
+  MRBC_BIND_2( c_add, INT, add, INT, INT )
+  MRBC_BIND_2_OPT( c_scale, FLOAT, scale, FLOAT, FLOAT, 1.0 )	// scale(x, k=1.0)
+
+  static const mrbc_method_table calc_methods[] = {
+    { "add",   c_add },
+    { "scale", c_scale },
+  };
+  mrbc_define_class_with_methods( vm, "Calc", 0,
+                   calc_methods, MRBC_COUNTOF(calc_methods) );
+
+  Argument types (C type)
+   INT     Integer                 mrbc_int
+   FLOAT   Float or Integer        mrbc_float
+   STRING  String                  const char *
+   SYMBOL  Symbol                  mrbc_sym
+   BOOL    any (nil, false: 0)     int
+   VALUE   any                     mrbc_value *
+
+  Return types (C type)
+   NIL (void), INT, FLOAT, BOOL, STRING (const char *, NULL is nil),
+   VALUE (mrbc_value)
+  </pre>
+*/
+
+#ifndef MRBC_SRC_BIND_H_
+#define MRBC_SRC_BIND_H_
+
+#include "value.h"
+#include "class.h"
+#include "c_string.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+//================================================================
+/*!@brief
+  method table for mrbc_define_methods()
+*/
+typedef struct MRBC_METHOD_TABLE {
+  const char *name;
+  mrbc_func_t func;
+} mrbc_method_table;
+
+#define MRBC_COUNTOF(a)	(sizeof(a) / sizeof((a)[0]))
+
+
+/*
+  argument types.
+*/
+#define MRBC_BIND_CHECK_INT(v)		((v).tt == MRBC_TT_FIXNUM)
+#define MRBC_BIND_GET_INT(v)		((v).i)
+#define MRBC_BIND_CHECK_FLOAT(v)	((v).tt == MRBC_TT_FLOAT || (v).tt == MRBC_TT_FIXNUM)
+#define MRBC_BIND_GET_FLOAT(v)		((v).tt == MRBC_TT_FLOAT ? (v).d : (mrbc_float)(v).i)
+#define MRBC_BIND_CHECK_STRING(v)	((v).tt == MRBC_TT_STRING)
+#define MRBC_BIND_GET_STRING(v)		((const char *)mrbc_string_cstr(&(v)))
+#define MRBC_BIND_CHECK_SYMBOL(v)	((v).tt == MRBC_TT_SYMBOL)
+#define MRBC_BIND_GET_SYMBOL(v)		((mrbc_sym)(v).i)
+#define MRBC_BIND_CHECK_BOOL(v)		1
+#define MRBC_BIND_GET_BOOL(v)		((v).tt > MRBC_TT_FALSE)
+#define MRBC_BIND_CHECK_VALUE(v)	1
+#define MRBC_BIND_GET_VALUE(v)		(&(v))
+
+/*
+  return types.
+*/
+#define MRBC_BIND_RET_NIL(e)	do { e; SET_NIL_RETURN(); } while(0)
+#define MRBC_BIND_RET_INT(e)	SET_INT_RETURN(e)
+#define MRBC_BIND_RET_FLOAT(e)	SET_FLOAT_RETURN(e)
+#define MRBC_BIND_RET_BOOL(e)	SET_BOOL_RETURN(e)
+#define MRBC_BIND_RET_VALUE(e)	SET_RETURN(e)
+#define MRBC_BIND_RET_STRING(e)	do { const char *s_ = (e); \
+    SET_RETURN( s_ ? mrbc_string_new_cstr(vm, s_) : mrbc_nil_value() ); } while(0)
+
+/*
+  n'th argument. (required and optional)
+*/
+#define MRBC_BIND_CHK_(T,n)	MRBC_BIND_CHECK_##T(v[n])
+#define MRBC_BIND_ARG_(T,n)	MRBC_BIND_GET_##T(v[n])
+#define MRBC_BIND_CHK_OPT_(T,n)	(argc < (n) || MRBC_BIND_CHECK_##T(v[n]))
+#define MRBC_BIND_ARG_OPT_(T,n,d) (argc < (n) ? (d) : MRBC_BIND_GET_##T(v[n]))
+
+#define MRBC_BIND_FUNC_(wrapper, R, min, max, check, call)	\
+  static void wrapper(struct VM *vm, mrbc_value v[], int argc)	\
+  {								\
+    if( argc < (min) || argc > (max) || !(check) ) {		\
+      mrbc_bind_error( vm, v, argc, (min), (max) );		\
+      return;							\
+    }								\
+    MRBC_BIND_RET_##R( call );					\
+  }
+
+
+/*
+  wrapper makers.
+   wrapper	name of the function to be made.
+   R		return type.
+   cfunc	C function.
+   T1..T4	argument types.
+   D1..D4	default value of the last argument.
+*/
+#define MRBC_BIND_0(wrapper, R, cfunc)			\
+  MRBC_BIND_FUNC_(wrapper, R, 0, 0, 1, cfunc())
+
+#define MRBC_BIND_1(wrapper, R, cfunc, T1)		\
+  MRBC_BIND_FUNC_(wrapper, R, 1, 1, MRBC_BIND_CHK_(T1,1),	\
+    cfunc( MRBC_BIND_ARG_(T1,1) ))
+
+#define MRBC_BIND_2(wrapper, R, cfunc, T1, T2)		\
+  MRBC_BIND_FUNC_(wrapper, R, 2, 2,			\
+    MRBC_BIND_CHK_(T1,1) && MRBC_BIND_CHK_(T2,2),	\
+    cfunc( MRBC_BIND_ARG_(T1,1), MRBC_BIND_ARG_(T2,2) ))
+
+#define MRBC_BIND_3(wrapper, R, cfunc, T1, T2, T3)	\
+  MRBC_BIND_FUNC_(wrapper, R, 3, 3,			\
+    MRBC_BIND_CHK_(T1,1) && MRBC_BIND_CHK_(T2,2) &&	\
+    MRBC_BIND_CHK_(T3,3),				\
+    cfunc( MRBC_BIND_ARG_(T1,1), MRBC_BIND_ARG_(T2,2),	\
+	   MRBC_BIND_ARG_(T3,3) ))
+
+#define MRBC_BIND_4(wrapper, R, cfunc, T1, T2, T3, T4)	\
+  MRBC_BIND_FUNC_(wrapper, R, 4, 4,			\
+    MRBC_BIND_CHK_(T1,1) && MRBC_BIND_CHK_(T2,2) &&	\
+    MRBC_BIND_CHK_(T3,3) && MRBC_BIND_CHK_(T4,4),	\
+    cfunc( MRBC_BIND_ARG_(T1,1), MRBC_BIND_ARG_(T2,2),	\
+	   MRBC_BIND_ARG_(T3,3), MRBC_BIND_ARG_(T4,4) ))
+
+#define MRBC_BIND_1_OPT(wrapper, R, cfunc, T1, D1)	\
+  MRBC_BIND_FUNC_(wrapper, R, 0, 1, MRBC_BIND_CHK_OPT_(T1,1), \
+    cfunc( MRBC_BIND_ARG_OPT_(T1,1,D1) ))
+
+#define MRBC_BIND_2_OPT(wrapper, R, cfunc, T1, T2, D2)	\
+  MRBC_BIND_FUNC_(wrapper, R, 1, 2,			\
+    MRBC_BIND_CHK_(T1,1) && MRBC_BIND_CHK_OPT_(T2,2),	\
+    cfunc( MRBC_BIND_ARG_(T1,1), MRBC_BIND_ARG_OPT_(T2,2,D2) ))
+
+#define MRBC_BIND_3_OPT(wrapper, R, cfunc, T1, T2, T3, D3)	\
+  MRBC_BIND_FUNC_(wrapper, R, 2, 3,			\
+    MRBC_BIND_CHK_(T1,1) && MRBC_BIND_CHK_(T2,2) &&	\
+    MRBC_BIND_CHK_OPT_(T3,3),				\
+    cfunc( MRBC_BIND_ARG_(T1,1), MRBC_BIND_ARG_(T2,2),	\
+	   MRBC_BIND_ARG_OPT_(T3,3,D3) ))
+
+#define MRBC_BIND_4_OPT(wrapper, R, cfunc, T1, T2, T3, T4, D4)	\
+  MRBC_BIND_FUNC_(wrapper, R, 3, 4,			\
+    MRBC_BIND_CHK_(T1,1) && MRBC_BIND_CHK_(T2,2) &&	\
+    MRBC_BIND_CHK_(T3,3) && MRBC_BIND_CHK_OPT_(T4,4),	\
+    cfunc( MRBC_BIND_ARG_(T1,1), MRBC_BIND_ARG_(T2,2),	\
+	   MRBC_BIND_ARG_(T3,3), MRBC_BIND_ARG_OPT_(T4,4,D4) ))
+
+
+void mrbc_bind_error(struct VM *vm, mrbc_value v[], int argc, int min, int max);
+void mrbc_define_methods(struct VM *vm, mrbc_class *cls, const mrbc_method_table *table, int n);
+mrbc_class *mrbc_define_class_with_methods(struct VM *vm, const char *name, mrbc_class *super, const mrbc_method_table *table, int n);
+
+
+#ifdef __cplusplus
+}
+#endif
+#endif
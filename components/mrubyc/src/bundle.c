@@ -0,0 +1,267 @@
+/*! @file
+  @brief
+  Bundle image loader. (many .mrb modules with a table of contents)
+
+  <pre>
+  Copyright (C) 2015-2020 Kyushu Institute of Technology.
+  Copyright (C) 2015-2020 Shimane IT Open-Innovation Center.
+
+  This file is distributed under BSD 3-Clause License.
+
+  </pre>
+
+  <pre>
+  Structure (all numbers are big endian, same as RITE binary)
+
+  Header
+   "MRBB"	identifier
+   "0001"	version
+   0000_0000	total size
+   0000		number of modules
+   0000		CRC of TOC
+
+  TOC entry (32 bytes * number of modules, dependency order)
+   name[20]	module name, zero padded.
+   0000_0000	offset from top of bundle
+   0000_0000	size
+   00		kind (enum MrbcBundleKind)
+   00		task priority
+   0000		CRC of module image
+
+  Module images (.mrb or .mrbz), each aligned to 4 bytes.
+
+  CRC is CRC-16/CCITT (poly 0x1021, init 0xffff).
+  tools/mrbbundle.rb makes this image.
+  </pre>
+*/
+
+#include "vm_config.h"
+#include <stdint.h>
+#include <string.h>
+
+#include "vm.h"
+#include "alloc.h"
+#include "class.h"
+#include "console.h"
+#include "rrt0.h"
+#include "bundle.h"
+
+
+//================================================================
+/*! calculate CRC-16/CCITT
+
+  @param  p	pointer to data.
+  @param  size	data size.
+  @return	CRC value.
+*/
+static uint16_t calc_crc( const uint8_t *p, uint32_t size )
+{
+  uint16_t crc = 0xffff;
+
+  while( size-- > 0 ) {
+    crc ^= (uint16_t)*p++ << 8;
+    int i;
+    for( i = 0; i < 8; i++ ) {
+      crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : (crc << 1);
+    }
+  }
+  return crc;
+}
+
+
+//================================================================
+/*! get pointer to the TOC entry.
+*/
+static inline const uint8_t * toc_entry( const mrbc_bundle *bundle, int idx )
+{
+  return bundle->image + MRBC_BUNDLE_HEADER_SIZE + MRBC_BUNDLE_ENTRY_SIZE * idx;
+}
+
+
+//================================================================
+/*! open the bundle image and verify all modules.
+
+  @param  bundle	pointer to bundle handle.
+  @param  image		pointer to bundle image.
+  @return int		zero if no error.
+*/
+int mrbc_bundle_open( mrbc_bundle *bundle, const uint8_t *image )
+{
+  bundle->image = image;
+  bundle->n_modules = 0;
+
+  if( memcmp(image, "MRBB0001", 8) != 0 ) {
+    console_printf("Error: Illegal bundle header.\n");
+    return -1;
+  }
+
+  uint32_t total_size = bin_to_uint32(image + 8);
+  int n_modules = bin_to_uint16(image + 12);
+  uint32_t toc_size = MRBC_BUNDLE_ENTRY_SIZE * n_modules;
+
+  if( MRBC_BUNDLE_HEADER_SIZE + toc_size > total_size ) goto ERROR_SIZE;
+  if( calc_crc(image + MRBC_BUNDLE_HEADER_SIZE, toc_size) !=
+      bin_to_uint16(image + 14) ) {
+    console_printf("Error: Bundle TOC checksum mismatch.\n");
+    return -1;
+  }
+
+  bundle->n_modules = n_modules;
+
+  int i;
+  for( i = 0; i < n_modules; i++ ) {
+    const uint8_t *p = toc_entry(bundle, i);
+    uint32_t offset = bin_to_uint32(p + MRBC_BUNDLE_NAME_LEN);
+    uint32_t size = bin_to_uint32(p + MRBC_BUNDLE_NAME_LEN + 4);
+
+    if( p[MRBC_BUNDLE_NAME_LEN - 1] != 0 ) goto ERROR_MODULE;
+    if( offset > total_size || size > total_size - offset ) goto ERROR_MODULE;
+    if( size < 16 ) goto ERROR_MODULE;
+    if( memcmp(image + offset, "RITE", 4) != 0 &&
+	memcmp(image + offset, "MRBZ", 4) != 0 ) goto ERROR_MODULE;
+    if( calc_crc(image + offset, size) !=
+	bin_to_uint16(p + MRBC_BUNDLE_NAME_LEN + 10) ) {
+      console_printf("Error: Checksum mismatch in '%s'.\n", p);
+      bundle->n_modules = 0;
+      return -1;
+    }
+  }
+
+  return 0;
+
+
+ ERROR_SIZE:
+  console_printf("Error: Illegal bundle size.\n");
+  return -1;
+
+ ERROR_MODULE:
+  console_printf("Error: Illegal module entry %d in bundle.\n", i);
+  bundle->n_modules = 0;
+  return -1;
+}
+
+
+//================================================================
+/*! find module by name.
+
+  @param  bundle	pointer to bundle handle.
+  @param  name		module name.
+  @return int		index of module or -1 if not found.
+*/
+int mrbc_bundle_find( const mrbc_bundle *bundle, const char *name )
+{
+  int i;
+  for( i = 0; i < bundle->n_modules; i++ ) {
+    if( strcmp( (const char *)toc_entry(bundle, i), name ) == 0 ) return i;
+  }
+  return -1;
+}
+
+
+//================================================================
+/*! get module name.
+*/
+const char * mrbc_bundle_name( const mrbc_bundle *bundle, int idx )
+{
+  if( idx < 0 || idx >= bundle->n_modules ) return NULL;
+  return (const char *)toc_entry(bundle, idx);
+}
+
+
+//================================================================
+/*! get module kind.
+
+  @return int	enum MrbcBundleKind, or -1 if index error.
+*/
+int mrbc_bundle_kind( const mrbc_bundle *bundle, int idx )
+{
+  if( idx < 0 || idx >= bundle->n_modules ) return -1;
+  return toc_entry(bundle, idx)[MRBC_BUNDLE_NAME_LEN + 8];
+}
+
+
+//================================================================
+/*! get pointer to module (.mrb) image.
+*/
+const uint8_t * mrbc_bundle_module( const mrbc_bundle *bundle, int idx )
+{
+  if( idx < 0 || idx >= bundle->n_modules ) return NULL;
+  return bundle->image + bin_to_uint32(toc_entry(bundle, idx) + MRBC_BUNDLE_NAME_LEN);
+}
+
+
+//================================================================
+/*! run all library modules in TOC (dependency) order.
+
+  @param  bundle	pointer to bundle handle.
+  @return int		number of modules executed.
+*/
+int mrbc_bundle_run_libraries( const mrbc_bundle *bundle )
+{
+  int n = 0;
+  int i;
+  for( i = 0; i < bundle->n_modules; i++ ) {
+    if( mrbc_bundle_kind(bundle, i) != MRBC_BUNDLE_LIBRARY ) continue;
+    mrbc_run_mrblib( mrbc_bundle_module(bundle, i) );
+    n++;
+  }
+  return n;
+}
+
+
+//================================================================
+/*! create task by module name.
+
+  @param  bundle	pointer to bundle handle.
+  @param  name		module name.
+  @param  tcb		Task control block with parameter, or NULL.
+  @retval		Pointer of mrbc_tcb.
+  @retval		NULL is error.
+*/
+mrbc_tcb * mrbc_bundle_create_task( const mrbc_bundle *bundle, const char *name, mrbc_tcb *tcb )
+{
+  int idx = mrbc_bundle_find(bundle, name);
+  int kind = mrbc_bundle_kind(bundle, idx);
+  if( kind != MRBC_BUNDLE_TASK && kind != MRBC_BUNDLE_TASK_DORMANT ) {
+    console_printf("Error: No such task '%s' in bundle.\n", name);
+    return NULL;
+  }
+
+  if( tcb == NULL ) {
+    tcb = (mrbc_tcb*)mrbc_raw_alloc( sizeof(mrbc_tcb) );
+    if( tcb == NULL ) return NULL;	// ENOMEM
+
+    mrbc_init_tcb( tcb );
+    int priority = toc_entry(bundle, idx)[MRBC_BUNDLE_NAME_LEN + 9];
+    if( priority != 0 ) tcb->priority = priority;
+    if( kind == MRBC_BUNDLE_TASK_DORMANT ) tcb->state = TASKSTATE_DORMANT;
+  }
+
+  return mrbc_create_task( mrbc_bundle_module(bundle, idx), tcb );
+}
+
+
+//================================================================
+/*! open the bundle, run libraries and create all tasks.
+
+  @param  image		pointer to bundle image.
+  @return int		zero if no error.
+*/
+int mrbc_bundle_load( const uint8_t *image )
+{
+  mrbc_bundle bundle;
+
+  if( mrbc_bundle_open( &bundle, image ) != 0 ) return -1;
+  mrbc_bundle_run_libraries( &bundle );
+
+  int ret = 0;
+  int i;
+  for( i = 0; i < bundle.n_modules; i++ ) {
+    if( mrbc_bundle_kind(&bundle, i) == MRBC_BUNDLE_LIBRARY ) continue;
+    if( !mrbc_bundle_create_task( &bundle, mrbc_bundle_name(&bundle, i), 0 )) {
+      ret = -1;
+    }
+  }
+
+  return ret;
+}
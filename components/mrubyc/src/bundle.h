@@ -0,0 +1,62 @@
+/*! @file
+  @brief
+  Bundle image loader. (many .mrb modules with a table of contents)
+
+  <pre>
+  Copyright (C) 2015-2020 Kyushu Institute of Technology.
+  Copyright (C) 2015-2020 Shimane IT Open-Innovation Center.
+
+  This file is distributed under BSD 3-Clause License.
+
+  </pre>
+*/
+
+#ifndef MRBC_SRC_BUNDLE_H_
+#define MRBC_SRC_BUNDLE_H_
+
+#include <stdint.h>
+#include "rrt0.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define MRBC_BUNDLE_HEADER_SIZE 16
+#define MRBC_BUNDLE_ENTRY_SIZE  32
+#define MRBC_BUNDLE_NAME_LEN    20
+
+//================================================================
+/*!@brief
+  Kind of module in bundle.
+*/
+enum MrbcBundleKind {
+  MRBC_BUNDLE_LIBRARY      = 0,	//!< run once by mrbc_run_mrblib()
+  MRBC_BUNDLE_TASK         = 1,	//!< create as ready task.
+  MRBC_BUNDLE_TASK_DORMANT = 2,	//!< create as dormant task.
+};
+
+
+//================================================================
+/*!@brief
+  Bundle handle.
+*/
+typedef struct MRBC_BUNDLE {
+  const uint8_t *image;		//!< pointer to top of bundle image.
+  uint16_t n_modules;		//!< number of modules.
+} mrbc_bundle;
+
+
+int mrbc_bundle_open(mrbc_bundle *bundle, const uint8_t *image);
+int mrbc_bundle_find(const mrbc_bundle *bundle, const char *name);
+const char *mrbc_bundle_name(const mrbc_bundle *bundle, int idx);
+int mrbc_bundle_kind(const mrbc_bundle *bundle, int idx);
+const uint8_t *mrbc_bundle_module(const mrbc_bundle *bundle, int idx);
+int mrbc_bundle_run_libraries(const mrbc_bundle *bundle);
+mrbc_tcb *mrbc_bundle_create_task(const mrbc_bundle *bundle, const char *name, mrbc_tcb *tcb);
+int mrbc_bundle_load(const uint8_t *image);
+
+
+#ifdef __cplusplus
+}
+#endif
+#endif
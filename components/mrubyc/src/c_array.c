@@ -54,8 +54,16 @@
     mrbc_array_compare
     mrbc_array_minmax
     mrbc_array_dup
+    mrbc_array_unshare
+
+ (copy on write)
+    mrbc_array_dup makes a new handle which shares the data buffer.
+    The number of sharing handles is kept in the cell next to the last
+    data (data[n_stored]), and all mutators call mrbc_array_unshare first.
 */
 
+#define SHARED_COUNT(h)	((h)->data[(h)->n_stored].i)
+
 
 //================================================================
 /*! constructor
@@ -82,9 +90,11 @@ mrbc_value mrbc_array_new(struct VM *vm, int size)
 
   h->ref_count = 1;
   h->tt = MRBC_TT_ARRAY;
+  h->flag_shared = 0;
   h->data_size = size;
   h->n_stored = 0;
   h->data = data;
+  mrbc_objspace_new( MRBC_TT_ARRAY );
 
   value.array = h;
   return value;
@@ -100,6 +110,14 @@ void mrbc_array_delete(mrbc_value *ary)
 {
   mrbc_array *h = ary->array;
 
+  // the shared data buffer is released by the last one.
+  if( h->flag_shared && --SHARED_COUNT(h) != 0 ) {
+    mrbc_objspace_delete( ary->tt );
+    mrbc_raw_free(h);
+    return;
+  }
+  h->flag_shared = 0;
+
   mrbc_value *p1 = h->data;
   const mrbc_value *p2 = p1 + h->n_stored;
   while( p1 < p2 ) {
@@ -120,6 +138,7 @@ void mrbc_array_clear_vm_id(mrbc_value *ary)
   mrbc_array *h = ary->array;
 
   mrbc_set_vm_id( h, 0 );
+  mrbc_set_vm_id( h->data, 0 );
 
   mrbc_value *p1 = h->data;
   const mrbc_value *p2 = p1 + h->n_stored;
@@ -138,6 +157,8 @@ void mrbc_array_clear_vm_id(mrbc_value *ary)
 */
 int mrbc_array_resize(mrbc_value *ary, int size)
 {
+  if( mrbc_array_unshare(ary) != 0 ) return E_NOMEMORY_ERROR;	// ENOMEM
+
   mrbc_array *h = ary->array;
 
   mrbc_value *data2 = mrbc_raw_realloc(h->data, sizeof(mrbc_value) * size);
@@ -160,6 +181,8 @@ int mrbc_array_resize(mrbc_value *ary, int size)
 */
 int mrbc_array_set(mrbc_value *ary, int idx, mrbc_value *set_val)
 {
+  if( mrbc_array_unshare(ary) != 0 ) return E_NOMEMORY_ERROR;	// ENOMEM
+
   mrbc_array *h = ary->array;
 
   if( idx < 0 ) {
@@ -217,6 +240,8 @@ mrbc_value mrbc_array_get(const mrbc_value *ary, int idx)
 */
 int mrbc_array_push(mrbc_value *ary, mrbc_value *set_val)
 {
+  if( mrbc_array_unshare(ary) != 0 ) return E_NOMEMORY_ERROR;	// ENOMEM
+
   mrbc_array *h = ary->array;
 
   if( h->n_stored >= h->data_size ) {
@@ -239,6 +264,8 @@ int mrbc_array_push(mrbc_value *ary, mrbc_value *set_val)
 */
 mrbc_value mrbc_array_pop(mrbc_value *ary)
 {
+  if( mrbc_array_unshare(ary) != 0 ) return mrbc_nil_value();	// ENOMEM
+
   mrbc_array *h = ary->array;
 
   if( h->n_stored <= 0 ) return mrbc_nil_value();
@@ -267,6 +294,8 @@ int mrbc_array_unshift(mrbc_value *ary, mrbc_value *set_val)
 */
 mrbc_value mrbc_array_shift(mrbc_value *ary)
 {
+  if( mrbc_array_unshare(ary) != 0 ) return mrbc_nil_value();	// ENOMEM
+
   mrbc_array *h = ary->array;
 
   if( h->n_stored <= 0 ) return mrbc_nil_value();
@@ -288,6 +317,8 @@ mrbc_value mrbc_array_shift(mrbc_value *ary)
 */
 int mrbc_array_insert(mrbc_value *ary, int idx, mrbc_value *set_val)
 {
+  if( mrbc_array_unshare(ary) != 0 ) return E_NOMEMORY_ERROR;	// ENOMEM
+
   mrbc_array *h = ary->array;
 
   if( idx < 0 ) {
@@ -338,6 +369,8 @@ int mrbc_array_insert(mrbc_value *ary, int idx, mrbc_value *set_val)
 */
 mrbc_value mrbc_array_remove(mrbc_value *ary, int idx)
 {
+  if( mrbc_array_unshare(ary) != 0 ) return mrbc_nil_value();	// ENOMEM
+
   mrbc_array *h = ary->array;
 
   if( idx < 0 ) idx = h->n_stored + idx;
@@ -363,6 +396,20 @@ void mrbc_array_clear(mrbc_value *ary)
 {
   mrbc_array *h = ary->array;
 
+  // detach from the shared data buffer, without copying.
+  if( h->flag_shared && SHARED_COUNT(h) > 1 ) {
+    mrbc_value *data = mrbc_raw_alloc( sizeof(mrbc_value) * h->data_size );
+    if( !data ) return;		// ENOMEM
+    mrbc_set_vm_id( data, mrbc_get_vm_id(h) );
+
+    SHARED_COUNT(h)--;
+    h->flag_shared = 0;
+    h->data = data;
+    h->n_stored = 0;
+    return;
+  }
+  h->flag_shared = 0;
+
   mrbc_value *p1 = h->data;
   const mrbc_value *p2 = p1 + h->n_stored;
   while( p1 < p2 ) {
@@ -434,6 +481,8 @@ void mrbc_array_minmax(mrbc_value *ary, mrbc_value **pp_min_value, mrbc_value **
 //================================================================
 /*! duplicate (shallow copy)
 
+  The data buffer is shared until either one is modified.
+
   @param  vm	pointer to VM.
   @param  ary	source
   @return	result
@@ -441,23 +490,64 @@ void mrbc_array_minmax(mrbc_value *ary, mrbc_value **pp_min_value, mrbc_value **
 mrbc_value mrbc_array_dup(struct VM *vm, const mrbc_value *ary)
 {
   mrbc_array *sh = ary->array;
+  mrbc_value dv = {.tt = ary->tt};
 
-  mrbc_value dv = mrbc_array_new(vm, sh->n_stored);
-  if( dv.array == NULL ) return dv;		// ENOMEM
+  if( !sh->flag_shared ) {
+    // needs a cell for the share count.
+    if( sh->n_stored >= sh->data_size &&
+	mrbc_array_resize( (mrbc_value *)ary, sh->n_stored + 1 ) != 0 ) {
+      return dv;				// ENOMEM
+    }
+    sh->data[sh->n_stored] = mrbc_nil_value();
+    SHARED_COUNT(sh) = 1;
+    sh->flag_shared = 1;
+  }
 
-  memcpy( dv.array->data, sh->data, sizeof(mrbc_value) * sh->n_stored );
-  dv.array->n_stored = sh->n_stored;
+  mrbc_array *h = mrbc_alloc(vm, sizeof(mrbc_array));
+  if( !h ) return dv;				// ENOMEM
 
-  mrbc_value *p1 = dv.array->data;
-  const mrbc_value *p2 = p1 + dv.array->n_stored;
-  while( p1 < p2 ) {
-    mrbc_dup(p1++);
-  }
+  *h = *sh;
+  h->ref_count = 1;
+  SHARED_COUNT(sh)++;
+  mrbc_objspace_new( dv.tt );
 
+  dv.array = h;
   return dv;
 }
 
 
+//================================================================
+/*! copy the shared data buffer. (copy on write)
+
+  @param  ary	pointer to target value
+  @return	mrbc_error_code
+*/
+int mrbc_array_unshare_sub(mrbc_value *ary)
+{
+  mrbc_array *h = ary->array;
+
+  // the last one takes over the buffer.
+  if( SHARED_COUNT(h) > 1 ) {
+    mrbc_value *data = mrbc_raw_alloc( sizeof(mrbc_value) * h->data_size );
+    if( !data ) return E_NOMEMORY_ERROR;	// ENOMEM
+    mrbc_set_vm_id( data, mrbc_get_vm_id(h) );
+
+    memcpy( data, h->data, sizeof(mrbc_value) * h->n_stored );
+    SHARED_COUNT(h)--;
+    h->data = data;
+
+    mrbc_value *p1 = data;
+    const mrbc_value *p2 = p1 + h->n_stored;
+    while( p1 < p2 ) {
+      mrbc_dup(p1++);
+    }
+  }
+
+  h->flag_shared = 0;
+  return 0;
+}
+
+
 //================================================================
 /*! method new
 */
@@ -882,6 +972,510 @@ static void c_array_minmax(struct VM *vm, mrbc_value v[], int argc)
 }
 
 
+/*
+  sort
+
+  Introsort (quicksort with median of three, heapsort if it goes too
+  deep, and insertion sort for small ranges), which doesn't need extra
+  memory. The comparison is chosen once by the types of the elements,
+  so Fixnum, Float and String arrays don't go through mrbc_compare().
+  The block is called only if given.
+  If vals is not NULL, it is permuted along with keys. (for sort_by)
+*/
+#define SORT_INSERTION_SIZE 12
+
+enum {
+  SORT_GENERIC,
+  SORT_FIXNUM,
+  SORT_FLOAT,
+  SORT_STRING,
+  SORT_BLOCK,
+};
+
+typedef struct SORT_CONTEXT {
+  int kind;
+  struct VM *vm;
+  const mrbc_value *block;
+  int eql;		// order the equal numbers by type. (1 and 1.0)
+} sort_context;
+
+
+//================================================================
+/*! decide the comparison by the types of the elements.
+*/
+static int sort_kind(const mrbc_value *p, int n)
+{
+  int n_fixnum = 0, n_float = 0, n_string = 0;
+  int i;
+  for( i = 0; i < n; i++ ) {
+    switch( p[i].tt ) {
+    case MRBC_TT_FIXNUM:	n_fixnum++;	break;
+    case MRBC_TT_FLOAT:		n_float++;	break;
+    case MRBC_TT_STRING:	n_string++;	break;
+    default:			return SORT_GENERIC;
+    }
+  }
+
+  if( n_fixnum == n ) return SORT_FIXNUM;
+#if MRBC_USE_FLOAT
+  if( n_string == 0 ) return SORT_FLOAT;
+#endif
+#if MRBC_USE_STRING
+  if( n_string == n ) return SORT_STRING;
+#endif
+  return SORT_GENERIC;
+}
+
+
+//================================================================
+/*! compare by the block. (<=>)
+*/
+static int sort_call_block(sort_context *ctx, const mrbc_value *a, const mrbc_value *b)
+{
+  if( ctx->vm->flag_raised ) return 0;
+
+  mrbc_value argv[2] = { *a, *b };
+  mrbc_value ret = mrbc_call_block( ctx->vm, ctx->block, 2, argv );
+
+  int res = 0;
+  if( ret.tt == MRBC_TT_FIXNUM ) res = (ret.i > 0) - (ret.i < 0);
+#if MRBC_USE_FLOAT
+  if( ret.tt == MRBC_TT_FLOAT ) res = (ret.d > 0) - (ret.d < 0);
+#endif
+  mrbc_release( &ret );
+
+  return res;
+}
+
+
+//================================================================
+/*! compare
+*/
+static inline int sort_cmp(sort_context *ctx, const mrbc_value *a, const mrbc_value *b)
+{
+  switch( ctx->kind ) {
+  case SORT_FIXNUM:
+    return (a->i > b->i) - (a->i < b->i);
+
+#if MRBC_USE_FLOAT
+  case SORT_FLOAT: {
+    mrbc_float d1 = (a->tt == MRBC_TT_FLOAT) ? a->d : a->i;
+    mrbc_float d2 = (b->tt == MRBC_TT_FLOAT) ? b->d : b->i;
+    if( d1 == d2 && ctx->eql ) return a->tt - b->tt;
+    return (d1 > d2) - (d1 < d2);
+  }
+#endif
+
+#if MRBC_USE_STRING
+  case SORT_STRING:
+    return mrbc_string_compare( a, b );
+#endif
+
+  case SORT_BLOCK:
+    return sort_call_block( ctx, a, b );
+  }
+
+  int res = mrbc_compare( a, b );
+  if( res == 0 && ctx->eql ) res = a->tt - b->tt;
+  return res;
+}
+
+
+static inline void sort_swap(mrbc_value *keys, mrbc_value *vals, int i, int j)
+{
+  mrbc_value tmp = keys[i]; keys[i] = keys[j]; keys[j] = tmp;
+  if( vals ) {
+    tmp = vals[i]; vals[i] = vals[j]; vals[j] = tmp;
+  }
+}
+
+
+static void sort_insertion(sort_context *ctx, mrbc_value *keys, mrbc_value *vals,
+			   int lo, int hi)
+{
+  int i, j;
+  for( i = lo + 1; i < hi; i++ ) {
+    for( j = i; j > lo && sort_cmp(ctx, &keys[j-1], &keys[j]) > 0; j-- ) {
+      sort_swap( keys, vals, j-1, j );
+    }
+  }
+}
+
+
+static void sort_sift_down(sort_context *ctx, mrbc_value *keys, mrbc_value *vals,
+			   int lo, int root, int n)
+{
+  while( 1 ) {
+    int child = root * 2 + 1;
+    if( child >= n ) break;
+    if( child + 1 < n &&
+	sort_cmp(ctx, &keys[lo+child], &keys[lo+child+1]) < 0 ) child++;
+    if( sort_cmp(ctx, &keys[lo+root], &keys[lo+child]) >= 0 ) break;
+
+    sort_swap( keys, vals, lo+root, lo+child );
+    root = child;
+  }
+}
+
+
+static void sort_heap(sort_context *ctx, mrbc_value *keys, mrbc_value *vals,
+		      int lo, int hi)
+{
+  int n = hi - lo;
+  int i;
+  for( i = n / 2 - 1; i >= 0; i-- ) {
+    sort_sift_down( ctx, keys, vals, lo, i, n );
+  }
+  for( i = n - 1; i > 0; i-- ) {
+    sort_swap( keys, vals, lo, lo+i );
+    sort_sift_down( ctx, keys, vals, lo, 0, i );
+  }
+}
+
+
+static void sort_intro(sort_context *ctx, mrbc_value *keys, mrbc_value *vals,
+		       int lo, int hi, int depth)
+{
+  while( hi - lo > SORT_INSERTION_SIZE ) {
+    if( depth-- == 0 ) {
+      sort_heap( ctx, keys, vals, lo, hi );
+      return;
+    }
+
+    // median of three, and move it to the first as a pivot.
+    int mid = lo + (hi - lo) / 2;
+    if( sort_cmp(ctx, &keys[mid], &keys[lo]) < 0 ) sort_swap( keys, vals, mid, lo );
+    if( sort_cmp(ctx, &keys[hi-1], &keys[lo]) < 0 ) sort_swap( keys, vals, hi-1, lo );
+    if( sort_cmp(ctx, &keys[hi-1], &keys[mid]) < 0 ) sort_swap( keys, vals, hi-1, mid );
+    sort_swap( keys, vals, lo, mid );
+
+    // partition.
+    int i = lo, j = hi;
+    while( 1 ) {
+      do { i++; } while( i < hi && sort_cmp(ctx, &keys[i], &keys[lo]) < 0 );
+      do { j--; } while( j > lo && sort_cmp(ctx, &keys[j], &keys[lo]) > 0 );
+      if( i >= j ) break;
+      sort_swap( keys, vals, i, j );
+    }
+    sort_swap( keys, vals, lo, j );
+
+    // recurse into the smaller one, to limit the stack depth.
+    if( j - lo < hi - j ) {
+      sort_intro( ctx, keys, vals, lo, j, depth );
+      lo = j + 1;
+    } else {
+      sort_intro( ctx, keys, vals, j + 1, hi, depth );
+      hi = j;
+    }
+  }
+
+  sort_insertion( ctx, keys, vals, lo, hi );
+}
+
+
+//================================================================
+/*! sort keys by the context, and vals along with it.
+*/
+static void sort_by_context(sort_context *ctx, mrbc_value *keys, mrbc_value *vals, int n)
+{
+  int depth = 0;
+  int i;
+  for( i = n; i > 1; i >>= 1 ) depth += 2;
+
+  sort_intro( ctx, keys, vals, 0, n, depth );
+}
+
+
+//================================================================
+/*! sort keys, and vals along with it.
+
+  @param  vm	pointer to VM.
+  @param  keys	keys.
+  @param  vals	values or NULL.
+  @param  n	number of keys.
+  @param  block	comparison block or NULL.
+*/
+static void sort_values(struct VM *vm, mrbc_value *keys, mrbc_value *vals,
+			int n, const mrbc_value *block)
+{
+  sort_context ctx = {
+    .kind = block ? SORT_BLOCK : sort_kind(keys, n),
+    .vm = vm,
+    .block = block,
+  };
+
+  sort_by_context( &ctx, keys, vals, n );
+}
+
+
+//================================================================
+/*! get the block argument, or NULL.
+*/
+static const mrbc_value *get_block(mrbc_value v[], int argc)
+{
+  return (v[argc+1].tt == MRBC_TT_PROC) ? &v[argc+1] : NULL;
+}
+
+
+//================================================================
+/*! make keys by the block. (for sort_by, uniq ...)
+
+  @return	allocated keys, or NULL if error.
+*/
+static mrbc_value *make_keys(struct VM *vm, const mrbc_value *ary, const mrbc_value *block)
+{
+  int n = mrbc_array_size(ary);
+  mrbc_value *keys = mrbc_alloc(vm, sizeof(mrbc_value) * n);
+  if( !keys ) return NULL;			// ENOMEM
+
+  int i;
+  for( i = 0; i < n; i++ ) {
+    keys[i] = mrbc_call_block( vm, block, 1, &ary->array->data[i] );
+    if( vm->flag_raised ) {
+      while( i >= 0 ) mrbc_release( &keys[i--] );
+      mrbc_raw_free( keys );
+      return NULL;
+    }
+  }
+
+  return keys;
+}
+
+
+static void free_keys(mrbc_value *keys, int n)
+{
+  int i;
+  for( i = 0; i < n; i++ ) {
+    mrbc_release( &keys[i] );
+  }
+  mrbc_raw_free( keys );
+}
+
+
+//================================================================
+/*! (method) sort!
+*/
+static void c_array_sort_self(struct VM *vm, mrbc_value v[], int argc)
+{
+  if( mrbc_array_unshare(v) != 0 ) return;	// ENOMEM
+
+  sort_values( vm, v->array->data, NULL, mrbc_array_size(v), get_block(v, argc) );
+}
+
+
+//================================================================
+/*! (method) sort
+*/
+static void c_array_sort(struct VM *vm, mrbc_value v[], int argc)
+{
+  mrbc_value ret = mrbc_array_dup( vm, v );
+  if( !ret.array || mrbc_array_unshare(&ret) != 0 ) {	// ENOMEM
+    if( ret.array ) mrbc_release( &ret );
+    SET_NIL_RETURN();
+    return;
+  }
+
+  sort_values( vm, ret.array->data, NULL, mrbc_array_size(&ret), get_block(v, argc) );
+  SET_RETURN( ret );
+}
+
+
+//================================================================
+/*! (method) sort_by
+*/
+static void c_array_sort_by(struct VM *vm, mrbc_value v[], int argc)
+{
+  const mrbc_value *block = get_block(v, argc);
+  if( !block ) {
+    console_printf("ArgumentError: no block given\n");
+    goto RETURN_NIL;
+  }
+
+  int n = mrbc_array_size(v);
+  mrbc_value *keys = make_keys( vm, v, block );
+  if( !keys ) goto RETURN_NIL;
+
+  mrbc_value ret = mrbc_array_dup( vm, v );
+  if( !ret.array || mrbc_array_unshare(&ret) != 0 ) {	// ENOMEM
+    if( ret.array ) mrbc_release( &ret );
+    free_keys( keys, n );
+    goto RETURN_NIL;
+  }
+
+  sort_values( vm, keys, ret.array->data, n, NULL );
+  free_keys( keys, n );
+
+  SET_RETURN( ret );
+  return;
+
+ RETURN_NIL:
+  SET_NIL_RETURN();
+}
+
+
+//================================================================
+/*! (method) min_by, max_by
+*/
+static void array_min_max_by(struct VM *vm, mrbc_value v[], int argc, int sign)
+{
+  const mrbc_value *block = get_block(v, argc);
+  int n = mrbc_array_size(v);
+  if( !block || n == 0 ) goto RETURN_NIL;
+
+  mrbc_value *keys = make_keys( vm, v, block );
+  if( !keys ) goto RETURN_NIL;
+
+  sort_context ctx = { .kind = sort_kind(keys, n) };
+  int found = 0;
+  int i;
+  for( i = 1; i < n; i++ ) {
+    if( sort_cmp( &ctx, &keys[i], &keys[found] ) * sign < 0 ) found = i;
+  }
+  free_keys( keys, n );
+
+  mrbc_value ret = v->array->data[found];
+  mrbc_dup( &ret );
+  SET_RETURN( ret );
+  return;
+
+ RETURN_NIL:
+  SET_NIL_RETURN();
+}
+
+static void c_array_min_by(struct VM *vm, mrbc_value v[], int argc)
+{
+  array_min_max_by( vm, v, argc, 1 );
+}
+
+static void c_array_max_by(struct VM *vm, mrbc_value v[], int argc)
+{
+  array_min_max_by( vm, v, argc, -1 );
+}
+
+
+//================================================================
+/*! (method) bsearch
+
+  find-minimum mode (block returns true or false) and
+  find-any mode (block returns a number) are supported.
+*/
+static void c_array_bsearch(struct VM *vm, mrbc_value v[], int argc)
+{
+  const mrbc_value *block = get_block(v, argc);
+  if( !block ) {
+    console_printf("ArgumentError: no block given\n");
+    SET_NIL_RETURN();
+    return;
+  }
+
+  int lo = 0;
+  int hi = mrbc_array_size(v);
+  int found = -1;
+
+  while( lo < hi ) {
+    int mid = lo + (hi - lo) / 2;
+    mrbc_value ret = mrbc_call_block( vm, block, 1, &v->array->data[mid] );
+    if( vm->flag_raised ) return;
+
+    int cmp;
+    switch( ret.tt ) {
+    case MRBC_TT_TRUE:	cmp = -1; found = mid;	break;
+    case MRBC_TT_FIXNUM:	cmp = (ret.i > 0) - (ret.i < 0);	break;
+#if MRBC_USE_FLOAT
+    case MRBC_TT_FLOAT:	cmp = (ret.d > 0) - (ret.d < 0);	break;
+#endif
+    default:		cmp = 1;		break;	// false, nil
+    }
+    mrbc_release( &ret );
+
+    if( cmp == 0 ) {
+      found = mid;
+      break;
+    }
+    if( cmp < 0 ) hi = mid; else lo = mid + 1;
+  }
+
+  if( found < 0 || found >= mrbc_array_size(v) ) {
+    SET_NIL_RETURN();
+    return;
+  }
+
+  mrbc_value ret = v->array->data[found];
+  mrbc_dup( &ret );
+  SET_RETURN( ret );
+}
+
+
+//================================================================
+/*! (method) uniq
+
+  Sorts (key, index) pairs to find the duplicates in O(n log n),
+  and keeps the first one of each in the original order.
+  The keys are compared like eql?, so 1 and 1.0 are different.
+*/
+static void c_array_uniq(struct VM *vm, mrbc_value v[], int argc)
+{
+  const mrbc_value *block = get_block(v, argc);
+  int n = mrbc_array_size(v);
+  mrbc_value *keys = NULL;
+  mrbc_value *index = NULL;
+  uint8_t *keep = NULL;
+  mrbc_value ret = {.tt = MRBC_TT_EMPTY};
+
+  if( n <= 1 ) {
+    ret = mrbc_array_dup( vm, v );
+    goto RETURN;
+  }
+
+  if( block ) {
+    keys = make_keys( vm, v, block );
+  } else {
+    keys = mrbc_alloc( vm, sizeof(mrbc_value) * n );
+    if( keys ) memcpy( keys, v->array->data, sizeof(mrbc_value) * n );
+  }
+  index = mrbc_alloc( vm, sizeof(mrbc_value) * n );
+  keep = mrbc_alloc( vm, n );
+  ret = mrbc_array_new( vm, n );
+  if( !keys || !index || !keep || !ret.array ) goto RETURN;	// ENOMEM
+
+  int i, j;
+  for( i = 0; i < n; i++ ) {
+    index[i] = mrbc_fixnum_value( i );
+    keep[i] = 0;
+  }
+  sort_context ctx = { .kind = sort_kind(keys, n), .vm = vm, .eql = 1 };
+  sort_by_context( &ctx, keys, index, n );
+
+  // keep the first index of each run of the same keys.
+  for( i = 0; i < n; i = j ) {
+    int first = index[i].i;
+    for( j = i + 1; j < n && sort_cmp(&ctx, &keys[i], &keys[j]) == 0; j++ ) {
+      if( index[j].i < first ) first = index[j].i;
+    }
+    keep[first] = 1;
+  }
+
+  for( i = 0; i < n; i++ ) {
+    if( !keep[i] ) continue;
+    mrbc_dup( &v->array->data[i] );
+    mrbc_array_push( &ret, &v->array->data[i] );
+  }
+
+ RETURN:
+  if( keys ) {
+    if( block ) free_keys( keys, n ); else mrbc_raw_free( keys );
+  }
+  if( index ) mrbc_raw_free( index );
+  if( keep ) mrbc_raw_free( keep );
+
+  if( ret.tt == MRBC_TT_EMPTY || !ret.array ) {
+    SET_NIL_RETURN();
+    return;
+  }
+  SET_RETURN( ret );
+}
+
+
 #if MRBC_USE_STRING
 //================================================================
 /*! (method) inspect
@@ -986,6 +1580,13 @@ void mrbc_init_class_array(struct VM *vm)
   mrbc_define_method(vm, mrbc_class_array, "min", c_array_min);
   mrbc_define_method(vm, mrbc_class_array, "max", c_array_max);
   mrbc_define_method(vm, mrbc_class_array, "minmax", c_array_minmax);
+  mrbc_define_method(vm, mrbc_class_array, "min_by", c_array_min_by);
+  mrbc_define_method(vm, mrbc_class_array, "max_by", c_array_max_by);
+  mrbc_define_method(vm, mrbc_class_array, "sort", c_array_sort);
+  mrbc_define_method(vm, mrbc_class_array, "sort!", c_array_sort_self);
+  mrbc_define_method(vm, mrbc_class_array, "sort_by", c_array_sort_by);
+  mrbc_define_method(vm, mrbc_class_array, "bsearch", c_array_bsearch);
+  mrbc_define_method(vm, mrbc_class_array, "uniq", c_array_uniq);
 #if MRBC_USE_STRING
   mrbc_define_method(vm, mrbc_class_array, "inspect", c_array_inspect);
   mrbc_define_method(vm, mrbc_class_array, "to_s", c_array_inspect);
@@ -15,6 +15,7 @@
 #define MRBC_SRC_C_ARRAY_H_
 
 #include "value.h"
+#include "objspace.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -27,6 +28,7 @@ extern "C" {
 typedef struct RArray {
   MRBC_OBJECT_HEADER;
 
+  uint8_t flag_shared;	//!< data buffer is shared with dup. (copy on write)
   uint16_t data_size;	//!< data buffer size.
   uint16_t n_stored;	//!< # of stored.
   mrbc_value *data;	//!< pointer to allocated memory.
@@ -50,6 +52,7 @@ void mrbc_array_clear(mrbc_value *ary);
 int mrbc_array_compare(const mrbc_value *v1, const mrbc_value *v2);
 void mrbc_array_minmax(mrbc_value *ary, mrbc_value **pp_min_value, mrbc_value **pp_max_value);
 mrbc_value mrbc_array_dup(struct VM *vm, const mrbc_value *ary);
+int mrbc_array_unshare_sub(mrbc_value *ary);
 void mrbc_init_class_array(struct VM *vm);
 
 
@@ -62,14 +65,30 @@ static inline int mrbc_array_size(const mrbc_value *ary)
 }
 
 
+//================================================================
+/*! make the data buffer own before modify it.
+
+  @param  ary	pointer to target value
+  @return	mrbc_error_code
+*/
+static inline int mrbc_array_unshare(mrbc_value *ary)
+{
+  return ary->array->flag_shared ? mrbc_array_unshare_sub(ary) : 0;
+}
+
+
 //================================================================
 /*! delete handle (do not decrement reference counter)
+
+  The data buffer shared with other arrays is not freed. Call
+  mrbc_array_unshare() before taking the elements out of it.
 */
 static inline void mrbc_array_delete_handle(mrbc_value *ary)
 {
   mrbc_array *h = ary->array;
 
-  mrbc_raw_free(h->data);
+  mrbc_objspace_delete( ary->tt );
+  if( !h->flag_shared ) mrbc_raw_free(h->data);
   mrbc_raw_free(h);
 }
 
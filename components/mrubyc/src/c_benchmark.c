@@ -0,0 +1,242 @@
+/*! @file
+  @brief
+  mruby/c Benchmark class and monotonic clock
+
+  <pre>
+  Copyright (C) 2015-2020 Kyushu Institute of Technology.
+  Copyright (C) 2015-2020 Shimane IT Open-Innovation Center.
+
+  This file is distributed under BSD 3-Clause License.
+
+  (usage)
+  t0 = Time.monotonic_us		# microseconds. (hal_time_us)
+  us = Benchmark.measure { work }	# elapsed microseconds.
+  sec = Benchmark.realtime { work }	# elapsed seconds in Float.
+  Benchmark.ips("work") { work }	# iterations per second.
+  Benchmark.ips("work", 2000, 500) { work }	# measure 2 s after 0.5 s warm-up.
+
+  Benchmark.ips runs the block for the warm-up time, and calibrates the
+  number of iterations per batch from it, so that the clock is read about
+  every BENCHMARK_BATCH_US. The spread is the standard deviation of the
+  time per iteration between the batches.
+  The block runs in the C method, so other tasks don't run meanwhile.
+  </pre>
+*/
+
+#include "vm_config.h"
+#include <stdint.h>
+#if MRBC_USE_FLOAT
+#include <math.h>
+#endif
+
+#include "value.h"
+#include "vm.h"
+#include "static.h"
+#include "class.h"
+#include "console.h"
+#include "hal/hal.h"
+#include "c_string.h"
+#include "c_benchmark.h"
+
+#if MRBC_USE_BENCHMARK
+
+#define BENCHMARK_BATCH_US	10000
+
+
+//================================================================
+/*! make the value of microseconds.
+
+  Integer, or Float if it does not fit in Integer.
+  (wraps around if MRBC_USE_FLOAT is 0)
+
+  @param  us	microseconds.
+  @return	Integer or Float.
+*/
+mrbc_value mrbc_time_us_value(uint64_t us)
+{
+#if MRBC_USE_FLOAT
+  if( us > MRBC_INT_MAX ) return mrbc_float_value( (mrbc_float)us );
+#endif
+  return mrbc_fixnum_value( (mrbc_int)(us & MRBC_INT_MAX) );
+}
+
+
+//================================================================
+/*! call the block once.
+
+  @return	0 if an exception is raised.
+*/
+static int call_block(struct VM *vm, const mrbc_value *block)
+{
+  mrbc_value ret = mrbc_call_block( vm, block, 0, NULL );
+  mrbc_release( &ret );
+  return !vm->flag_raised;
+}
+
+
+//================================================================
+/*! get the block argument, or NULL.
+*/
+static const mrbc_value *get_block(struct VM *vm, mrbc_value v[], int argc)
+{
+  if( v[argc+1].tt == MRBC_TT_PROC ) return &v[argc+1];
+
+  console_printf("ArgumentError: Benchmark needs a block\n");
+  return NULL;
+}
+
+
+//================================================================
+/*! (method) Time.monotonic_us
+*/
+static void c_time_monotonic_us(struct VM *vm, mrbc_value v[], int argc)
+{
+  SET_RETURN( mrbc_time_us_value( hal_time_us() ) );
+}
+
+
+#if MRBC_USE_FLOAT
+//================================================================
+/*! (method) Time.monotonic	seconds in Float.
+*/
+static void c_time_monotonic(struct VM *vm, mrbc_value v[], int argc)
+{
+  SET_FLOAT_RETURN( hal_time_us() / (mrbc_float)1e6 );
+}
+#endif
+
+
+//================================================================
+/*! (method) Benchmark.measure { }	elapsed microseconds.
+*/
+static void c_benchmark_measure(struct VM *vm, mrbc_value v[], int argc)
+{
+  const mrbc_value *block = get_block( vm, v, argc );
+  if( !block ) {
+    SET_NIL_RETURN();
+    return;
+  }
+
+  uint64_t t0 = hal_time_us();
+  call_block( vm, block );
+  SET_RETURN( mrbc_time_us_value( hal_time_us() - t0 ) );
+}
+
+
+#if MRBC_USE_FLOAT
+//================================================================
+/*! (method) Benchmark.realtime { }	elapsed seconds in Float.
+*/
+static void c_benchmark_realtime(struct VM *vm, mrbc_value v[], int argc)
+{
+  const mrbc_value *block = get_block( vm, v, argc );
+  if( !block ) {
+    SET_NIL_RETURN();
+    return;
+  }
+
+  uint64_t t0 = hal_time_us();
+  call_block( vm, block );
+  SET_FLOAT_RETURN( (hal_time_us() - t0) / (mrbc_float)1e6 );
+}
+#endif
+
+
+//================================================================
+/*! (method) Benchmark.ips(label = nil, time_ms = 1000, warmup_ms = 200) { }
+
+  print the result, and return iterations per second.
+*/
+static void c_benchmark_ips(struct VM *vm, mrbc_value v[], int argc)
+{
+  const mrbc_value *block = get_block( vm, v, argc );
+  const char *label = "";
+  uint64_t time_us = 1000000;
+  uint64_t warmup_us = 200000;
+
+  SET_NIL_RETURN();
+  if( !block ) return;
+#if MRBC_USE_STRING
+  if( argc >= 1 && v[1].tt == MRBC_TT_STRING ) label = mrbc_string_cstr( &v[1] );
+#endif
+  if( argc >= 2 && v[2].tt == MRBC_TT_FIXNUM && v[2].i > 0 ) time_us = (uint64_t)v[2].i * 1000;
+  if( argc >= 3 && v[3].tt == MRBC_TT_FIXNUM && v[3].i >= 0 ) warmup_us = (uint64_t)v[3].i * 1000;
+
+  // warm-up, and count the iterations in the time.
+  uint64_t t0 = hal_time_us(), t;
+  uint32_t n = 0;
+  do {
+    if( !call_block( vm, block ) ) return;
+    n++;
+  } while( (t = hal_time_us() - t0) < warmup_us );
+
+  // calibrate the batch size.
+  uint32_t batch = t ? (uint64_t)n * BENCHMARK_BATCH_US / t : n;
+  if( batch == 0 ) batch = 1;
+
+  // measure.
+  uint64_t n_iter = 0;
+  uint32_t n_batch = 0;
+#if MRBC_USE_FLOAT
+  double sum = 0, sum2 = 0;
+#endif
+  t0 = hal_time_us();
+  do {
+#if MRBC_USE_FLOAT
+    uint64_t tb = hal_time_us();
+#endif
+    uint32_t i;
+    for( i = 0; i < batch; i++ ) {
+      if( !call_block( vm, block ) ) return;
+    }
+    t = hal_time_us();
+    n_iter += batch;
+    n_batch++;
+#if MRBC_USE_FLOAT
+    double us = (double)(t - tb) / batch;
+    sum += us;
+    sum2 += us * us;
+#endif
+  } while( t - t0 < time_us );
+  t -= t0;
+
+#if MRBC_USE_FLOAT
+  double ips = n_iter * 1e6 / t;
+  double mean = sum / n_batch;
+  double var = sum2 / n_batch - mean * mean;
+  double spread = (var > 0 && mean > 0) ? sqrt(var) / mean * 100 : 0;
+
+  console_printf("%-20s %12.1f i/s  %10.3f us/i  +-%.1f%%  (%d x %d)\n",
+		 label, ips, t / (double)n_iter, spread, n_batch, batch);
+  SET_FLOAT_RETURN( ips );
+#else
+  uint32_t ips = n_iter * 1000000 / t;
+  console_printf("%-20s %12d i/s  (%d x %d)\n", label, ips, n_batch, batch);
+  SET_INT_RETURN( ips );
+#endif
+}
+
+
+
+//================================================================
+/*! initialize
+*/
+void mrbc_init_class_benchmark(struct VM *vm)
+{
+  mrbc_class *cls;
+
+  cls = mrbc_define_class(vm, "Time", mrbc_class_object);
+  mrbc_define_method(vm, cls, "monotonic_us", c_time_monotonic_us);
+#if MRBC_USE_FLOAT
+  mrbc_define_method(vm, cls, "monotonic", c_time_monotonic);
+#endif
+
+  cls = mrbc_define_class(vm, "Benchmark", mrbc_class_object);
+  mrbc_define_method(vm, cls, "measure", c_benchmark_measure);
+#if MRBC_USE_FLOAT
+  mrbc_define_method(vm, cls, "realtime", c_benchmark_realtime);
+#endif
+  mrbc_define_method(vm, cls, "ips", c_benchmark_ips);
+}
+
+#endif  // MRBC_USE_BENCHMARK
@@ -0,0 +1,35 @@
+/*! @file
+  @brief
+  mruby/c Benchmark class and monotonic clock
+
+  <pre>
+  Copyright (C) 2015-2020 Kyushu Institute of Technology.
+  Copyright (C) 2015-2020 Shimane IT Open-Innovation Center.
+
+  This file is distributed under BSD 3-Clause License.
+
+  </pre>
+*/
+
+#ifndef MRBC_SRC_C_BENCHMARK_H_
+#define MRBC_SRC_C_BENCHMARK_H_
+
+#include <stdint.h>
+#include "value.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#if MRBC_USE_BENCHMARK
+
+mrbc_value mrbc_time_us_value(uint64_t us);
+void mrbc_init_class_benchmark(struct VM *vm);
+
+#endif
+
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -0,0 +1,566 @@
+/*! @file
+  @brief
+  mruby/c Fixed class (fixed-point number)
+
+  <pre>
+  Copyright (C) 2015-2020 Kyushu Institute of Technology.
+  Copyright (C) 2015-2020 Shimane IT Open-Innovation Center.
+
+  This file is distributed under BSD 3-Clause License.
+
+  (usage)
+  kp = Fixed.new(12, 10)		# 1.2
+  out = kp * err + ki * sum		# + - * / are in the VM fast path.
+  out.to_i
+
+  Fixed is an immediate value like Fixnum, in 32 bit signed
+  Q16.16 (or Q24.8, see MRBC_FIXED_FRAC_BITS). The operations
+  saturate at the max/min instead of wrapping, and don't use Float,
+  so the results are the same on all targets.
+  sin and cos are calculated by CORDIC.
+  </pre>
+*/
+
+#include "vm_config.h"
+#include <stdint.h>
+
+#include "value.h"
+#include "static.h"
+#include "class.h"
+#include "console.h"
+#include "c_string.h"
+#include "c_fixed.h"
+
+
+#if MRBC_USE_FIXED
+
+#if MRBC_FIXED_FRAC_BITS > 16
+#error "MRBC_FIXED_FRAC_BITS must be 16 or less."
+#endif
+
+#if MRBC_FIXED_FRAC_BITS > 8
+#define FRAC_SCALE 100000	// 5 digits for to_s.
+#else
+#define FRAC_SCALE 1000
+#endif
+
+#define FIXED_PI	((mrbc_fixed)(3.14159265358979 * MRBC_FIXED_ONE + 0.5))
+
+/*
+  CORDIC. (in Q16.16)
+*/
+#define CORDIC_SHIFT	(16 - MRBC_FIXED_FRAC_BITS)
+#define CORDIC_PI	205887
+#define CORDIC_PI_2	102944
+#define CORDIC_K	39797		// 1 / gain
+static const int32_t cordic_atan[] = {	// atan(2**-i)
+  51472, 30386, 16055, 8150, 4091, 2047, 1024, 512,
+  256, 128, 64, 32, 16, 8, 4, 2,
+};
+
+
+//================================================================
+/*! convert to Fixed.
+
+  @param  v	Fixed, Fixnum or Float.
+  @param  ret	returns the value.
+  @return	0 if not convertible.
+*/
+static int get_fixed(const mrbc_value *v, mrbc_fixed *ret)
+{
+  switch( v->tt ) {
+  case MRBC_TT_FIXED:
+    *ret = v->fx;
+    return 1;
+
+  case MRBC_TT_FIXNUM:
+    *ret = mrbc_fixed_from_int( v->i );
+    return 1;
+
+#if MRBC_USE_FLOAT
+  case MRBC_TT_FLOAT: {
+    mrbc_float d = v->d * MRBC_FIXED_ONE;
+    if( d >= (mrbc_float)MRBC_FIXED_MAX ) *ret = MRBC_FIXED_MAX;
+    else if( d <= (mrbc_float)MRBC_FIXED_MIN ) *ret = MRBC_FIXED_MIN;
+    else *ret = (mrbc_fixed)(d < 0 ? d - (mrbc_float)0.5 : d + (mrbc_float)0.5);
+    return 1;
+  }
+#endif
+
+  default:
+    return 0;
+  }
+}
+
+
+#if MRBC_USE_FLOAT
+static inline mrbc_float fixed_to_float( mrbc_fixed x )
+{
+  return (mrbc_float)x / MRBC_FIXED_ONE;
+}
+#endif
+
+
+//================================================================
+/*! value scaled by MRBC_FIXED_ONE. (Fixed or Fixnum)
+*/
+static int64_t scaled_value(const mrbc_value *v)
+{
+  if( v->tt == MRBC_TT_FIXED ) return v->fx;
+
+  mrbc_int n = v->i;
+#if MRBC_INT64
+  // out of the range of Fixed anyway.
+  if( n > INT32_MAX ) n = INT32_MAX;
+  if( n < INT32_MIN ) n = INT32_MIN;
+#endif
+  return (int64_t)n * MRBC_FIXED_ONE;
+}
+
+
+//================================================================
+/*! compare Fixed with other numeric. (called from mrbc_compare)
+
+  @retval 0	v1 == v2
+  @retval plus	v1 >  v2
+  @retval minus	v1 <  v2
+*/
+int mrbc_fixed_compare(const mrbc_value *v1, const mrbc_value *v2)
+{
+#if MRBC_USE_FLOAT
+  if( v1->tt == MRBC_TT_FLOAT || v2->tt == MRBC_TT_FLOAT ) {
+    if( v1->tt != MRBC_TT_FIXED && v2->tt != MRBC_TT_FIXED ) goto OTHER;
+    mrbc_float d1 = (v1->tt == MRBC_TT_FLOAT) ? v1->d : fixed_to_float(v1->fx);
+    mrbc_float d2 = (v2->tt == MRBC_TT_FLOAT) ? v2->d : fixed_to_float(v2->fx);
+    return (d1 > d2) - (d1 < d2);
+  }
+#endif
+
+  if( (v1->tt == MRBC_TT_FIXED || v1->tt == MRBC_TT_FIXNUM) &&
+      (v2->tt == MRBC_TT_FIXED || v2->tt == MRBC_TT_FIXNUM) ) {
+    int64_t x = scaled_value(v1);
+    int64_t y = scaled_value(v2);
+    return (x > y) - (x < y);
+  }
+
+#if MRBC_USE_FLOAT
+ OTHER:
+#endif
+  return v1->tt - v2->tt;
+}
+
+
+//================================================================
+/*! convert to decimal string, such as "-1.25"
+
+  @param  x	value.
+  @param  buf	buffer. (16 bytes or more)
+  @return	buf
+*/
+char *mrbc_fixed_to_cstr(mrbc_fixed x, char *buf)
+{
+  char *p = buf;
+  uint32_t u = x;
+
+  if( x < 0 ) {
+    *p++ = '-';
+    u = 0U - u;
+  }
+
+  uint32_t ipart = u >> MRBC_FIXED_FRAC_BITS;
+  uint32_t fpart = ((uint64_t)(u & (MRBC_FIXED_ONE - 1)) * FRAC_SCALE +
+		    MRBC_FIXED_ONE / 2) >> MRBC_FIXED_FRAC_BITS;
+  if( fpart >= FRAC_SCALE ) {
+    ipart++;
+    fpart -= FRAC_SCALE;
+  }
+
+  char tmp[12];
+  int n = 0;
+  do {
+    tmp[n++] = '0' + ipart % 10;
+    ipart /= 10;
+  } while( ipart != 0 );
+  while( n > 0 ) *p++ = tmp[--n];
+
+  *p++ = '.';
+  int i;
+  for( i = FRAC_SCALE / 10; i > 0; i /= 10 ) {
+    *p++ = '0' + fpart / i % 10;
+  }
+  while( p[-1] == '0' && p[-2] != '.' ) p--;	// trailing zeros.
+  *p = '\0';
+
+  return buf;
+}
+
+
+//================================================================
+/*! square root. (floor)
+*/
+static uint32_t isqrt64( uint64_t n )
+{
+  uint64_t ret = 0;
+  uint64_t bit = (uint64_t)1 << 62;
+
+  while( bit > n ) bit >>= 2;
+  while( bit != 0 ) {
+    if( n >= ret + bit ) {
+      n -= ret + bit;
+      ret = (ret >> 1) + bit;
+    } else {
+      ret >>= 1;
+    }
+    bit >>= 2;
+  }
+
+  return ret;
+}
+
+
+//================================================================
+/*! sin and cos by CORDIC.
+*/
+static void fixed_sincos( mrbc_fixed angle, mrbc_fixed *s, mrbc_fixed *c )
+{
+  // -PI .. PI
+  int32_t z = angle % (FIXED_PI * 2);
+  if( z > FIXED_PI ) z -= FIXED_PI * 2;
+  if( z < -FIXED_PI ) z += FIXED_PI * 2;
+  z *= (1 << CORDIC_SHIFT);
+
+  // -PI/2 .. PI/2
+  int neg = 0;
+  if( z > CORDIC_PI_2 ) {
+    z -= CORDIC_PI;
+    neg = 1;
+  } else if( z < -CORDIC_PI_2 ) {
+    z += CORDIC_PI;
+    neg = 1;
+  }
+
+  int32_t x = CORDIC_K, y = 0;
+  int i;
+  for( i = 0; i < sizeof(cordic_atan) / sizeof(cordic_atan[0]); i++ ) {
+    int32_t dx = y >> i;
+    int32_t dy = x >> i;
+    if( z >= 0 ) {
+      x -= dx;
+      y += dy;
+      z -= cordic_atan[i];
+    } else {
+      x += dx;
+      y -= dy;
+      z += cordic_atan[i];
+    }
+  }
+  if( neg ) {
+    x = -x;
+    y = -y;
+  }
+
+  *c = x / (1 << CORDIC_SHIFT);
+  *s = y / (1 << CORDIC_SHIFT);
+}
+
+
+//================================================================
+/*! (method) Fixed.new(x, den = 1)
+*/
+static void c_fixed_new(struct VM *vm, mrbc_value v[], int argc)
+{
+  mrbc_fixed x, y;
+
+  if( argc < 1 || argc > 2 || !get_fixed( &v[1], &x ) ) goto ERROR;
+  if( argc == 2 ) {
+    if( v[1].tt == MRBC_TT_FIXNUM && v[2].tt == MRBC_TT_FIXNUM && v[2].i != 0 ) {
+      x = mrbc_fixed_saturate( (int64_t)v[1].i * MRBC_FIXED_ONE / v[2].i );
+    } else {
+      if( !get_fixed( &v[2], &y ) ) goto ERROR;
+      x = mrbc_fixed_div( x, y );
+    }
+  }
+
+  SET_RETURN( mrbc_fixed_value( x ) );
+  return;
+
+ ERROR:
+  console_printf("ArgumentError: Fixed.new needs numeric\n");
+  SET_NIL_RETURN();
+}
+
+
+//================================================================
+/*! (method) Fixed.from_raw(n)
+*/
+static void c_fixed_from_raw(struct VM *vm, mrbc_value v[], int argc)
+{
+  if( argc != 1 || v[1].tt != MRBC_TT_FIXNUM ) {
+    console_printf("ArgumentError: Fixed.from_raw needs Integer\n");
+    SET_NIL_RETURN();
+    return;
+  }
+
+  SET_RETURN( mrbc_fixed_value( (mrbc_fixed)v[1].i ) );
+}
+
+
+//================================================================
+/*! (method) Fixed.pi
+*/
+static void c_fixed_pi(struct VM *vm, mrbc_value v[], int argc)
+{
+  SET_RETURN( mrbc_fixed_value( FIXED_PI ) );
+}
+
+
+//================================================================
+/*! (operator) + - * /
+
+  Fixed and Fixed or Integer makes Fixed, and Float makes Float.
+  (normally Fixed and Fixed or Integer are done in the VM)
+*/
+static void fixed_arith(struct VM *vm, mrbc_value v[], int argc, int op)
+{
+#if MRBC_USE_FLOAT
+  if( v[0].tt == MRBC_TT_FLOAT || v[1].tt == MRBC_TT_FLOAT ) {
+    mrbc_float d1, d2;
+    if( v[0].tt == MRBC_TT_FLOAT ) d1 = v[0].d;
+    else if( v[0].tt == MRBC_TT_FIXED ) d1 = fixed_to_float(v[0].fx);
+    else goto TYPE_ERROR;
+    if( v[1].tt == MRBC_TT_FLOAT ) d2 = v[1].d;
+    else if( v[1].tt == MRBC_TT_FIXED ) d2 = fixed_to_float(v[1].fx);
+    else if( v[1].tt == MRBC_TT_FIXNUM ) d2 = v[1].i;
+    else goto TYPE_ERROR;
+
+    switch( op ) {
+    case '+':	d1 += d2;	break;
+    case '-':	d1 -= d2;	break;
+    case '*':	d1 *= d2;	break;
+    case '/':	d1 /= d2;	break;
+    }
+    SET_FLOAT_RETURN( d1 );
+    return;
+  }
+#endif
+
+  mrbc_fixed x, y;
+  if( !mrbc_fixed_operands( &v[0], &v[1], &x, &y ) ) goto TYPE_ERROR;
+
+  switch( op ) {
+  case '+':	x = mrbc_fixed_add( x, y );	break;
+  case '-':	x = mrbc_fixed_sub( x, y );	break;
+  case '*':	x = mrbc_fixed_mul( x, y );	break;
+  case '/':	x = mrbc_fixed_div( x, y );	break;
+  }
+  SET_RETURN( mrbc_fixed_value( x ) );
+  return;
+
+ TYPE_ERROR:
+  console_printf("TypeError: wrong argument type.\n");
+  SET_NIL_RETURN();
+}
+
+static void c_fixed_add(struct VM *vm, mrbc_value v[], int argc)
+{
+  fixed_arith( vm, v, argc, '+' );
+}
+
+static void c_fixed_sub(struct VM *vm, mrbc_value v[], int argc)
+{
+  fixed_arith( vm, v, argc, '-' );
+}
+
+static void c_fixed_mul(struct VM *vm, mrbc_value v[], int argc)
+{
+  fixed_arith( vm, v, argc, '*' );
+}
+
+static void c_fixed_div(struct VM *vm, mrbc_value v[], int argc)
+{
+  fixed_arith( vm, v, argc, '/' );
+}
+
+
+//================================================================
+/*! (operator) unary -
+*/
+static void c_fixed_negative(struct VM *vm, mrbc_value v[], int argc)
+{
+  v[0].fx = mrbc_fixed_sub( 0, v[0].fx );
+}
+
+
+//================================================================
+/*! (method) abs
+*/
+static void c_fixed_abs(struct VM *vm, mrbc_value v[], int argc)
+{
+  if( v[0].fx < 0 ) v[0].fx = mrbc_fixed_sub( 0, v[0].fx );
+}
+
+
+//================================================================
+/*! (operator) <=>
+*/
+static void c_fixed_compare(struct VM *vm, mrbc_value v[], int argc)
+{
+  int ret = mrbc_compare( &v[0], &v[1] );
+  SET_INT_RETURN( (ret > 0) - (ret < 0) );
+}
+
+
+//================================================================
+/*! (method) to_i, floor, ceil, round
+*/
+static void c_fixed_to_i(struct VM *vm, mrbc_value v[], int argc)
+{
+  SET_INT_RETURN( mrbc_fixed_to_int( v[0].fx ) );
+}
+
+static void c_fixed_floor(struct VM *vm, mrbc_value v[], int argc)
+{
+  SET_INT_RETURN( (int64_t)v[0].fx >> MRBC_FIXED_FRAC_BITS );
+}
+
+static void c_fixed_ceil(struct VM *vm, mrbc_value v[], int argc)
+{
+  SET_INT_RETURN( ((int64_t)v[0].fx + MRBC_FIXED_ONE - 1) >> MRBC_FIXED_FRAC_BITS );
+}
+
+static void c_fixed_round(struct VM *vm, mrbc_value v[], int argc)
+{
+  int64_t x = v[0].fx;
+  if( x < 0 ) {
+    SET_INT_RETURN( -((-x + MRBC_FIXED_ONE / 2) >> MRBC_FIXED_FRAC_BITS) );
+  } else {
+    SET_INT_RETURN( (x + MRBC_FIXED_ONE / 2) >> MRBC_FIXED_FRAC_BITS );
+  }
+}
+
+
+//================================================================
+/*! (method) raw
+*/
+static void c_fixed_raw(struct VM *vm, mrbc_value v[], int argc)
+{
+  SET_INT_RETURN( v[0].fx );
+}
+
+
+#if MRBC_USE_FLOAT
+//================================================================
+/*! (method) to_f
+*/
+static void c_fixed_to_f(struct VM *vm, mrbc_value v[], int argc)
+{
+  SET_FLOAT_RETURN( fixed_to_float( v[0].fx ) );
+}
+#endif
+
+
+//================================================================
+/*! (method) to_fixed  (Fixed, Integer and Float)
+*/
+static void c_fixed_to_fixed(struct VM *vm, mrbc_value v[], int argc)
+{
+  mrbc_fixed x = 0;
+  get_fixed( &v[0], &x );
+  SET_RETURN( mrbc_fixed_value( x ) );
+}
+
+
+//================================================================
+/*! (method) sqrt
+*/
+static void c_fixed_sqrt(struct VM *vm, mrbc_value v[], int argc)
+{
+  if( v[0].fx < 0 ) {
+    console_printf("ArgumentError: sqrt of negative\n");
+    SET_NIL_RETURN();
+    return;
+  }
+
+  v[0].fx = isqrt64( (uint64_t)v[0].fx << MRBC_FIXED_FRAC_BITS );
+}
+
+
+//================================================================
+/*! (method) sin, cos
+*/
+static void c_fixed_sin(struct VM *vm, mrbc_value v[], int argc)
+{
+  mrbc_fixed s, c;
+  fixed_sincos( v[0].fx, &s, &c );
+  v[0].fx = s;
+}
+
+static void c_fixed_cos(struct VM *vm, mrbc_value v[], int argc)
+{
+  mrbc_fixed s, c;
+  fixed_sincos( v[0].fx, &s, &c );
+  v[0].fx = c;
+}
+
+
+#if MRBC_USE_STRING
+//================================================================
+/*! (method) to_s
+*/
+static void c_fixed_to_s(struct VM *vm, mrbc_value v[], int argc)
+{
+  char buf[16];
+  SET_RETURN( mrbc_string_new_cstr( vm, mrbc_fixed_to_cstr( v[0].fx, buf ) ) );
+}
+#endif
+
+
+
+//================================================================
+/*! initialize
+*/
+void mrbc_init_class_fixed(struct VM *vm)
+{
+  mrbc_class_fixed = mrbc_define_class(vm, "Fixed", mrbc_class_object);
+
+  mrbc_define_method(vm, mrbc_class_fixed, "new", c_fixed_new);
+  mrbc_define_method(vm, mrbc_class_fixed, "from_raw", c_fixed_from_raw);
+  mrbc_define_method(vm, mrbc_class_fixed, "pi", c_fixed_pi);
+  mrbc_define_method(vm, mrbc_class_fixed, "+", c_fixed_add);
+  mrbc_define_method(vm, mrbc_class_fixed, "-", c_fixed_sub);
+  mrbc_define_method(vm, mrbc_class_fixed, "*", c_fixed_mul);
+  mrbc_define_method(vm, mrbc_class_fixed, "/", c_fixed_div);
+  mrbc_define_method(vm, mrbc_class_fixed, "-@", c_fixed_negative);
+  mrbc_define_method(vm, mrbc_class_fixed, "abs", c_fixed_abs);
+  mrbc_define_method(vm, mrbc_class_fixed, "<=>", c_fixed_compare);
+  mrbc_define_method(vm, mrbc_class_fixed, "to_i", c_fixed_to_i);
+  mrbc_define_method(vm, mrbc_class_fixed, "floor", c_fixed_floor);
+  mrbc_define_method(vm, mrbc_class_fixed, "ceil", c_fixed_ceil);
+  mrbc_define_method(vm, mrbc_class_fixed, "round", c_fixed_round);
+  mrbc_define_method(vm, mrbc_class_fixed, "raw", c_fixed_raw);
+  mrbc_define_method(vm, mrbc_class_fixed, "to_fixed", c_fixed_to_fixed);
+  mrbc_define_method(vm, mrbc_class_fixed, "sqrt", c_fixed_sqrt);
+  mrbc_define_method(vm, mrbc_class_fixed, "sin", c_fixed_sin);
+  mrbc_define_method(vm, mrbc_class_fixed, "cos", c_fixed_cos);
+#if MRBC_USE_FLOAT
+  mrbc_define_method(vm, mrbc_class_fixed, "to_f", c_fixed_to_f);
+#endif
+#if MRBC_USE_STRING
+  mrbc_define_method(vm, mrbc_class_fixed, "to_s", c_fixed_to_s);
+  mrbc_define_method(vm, mrbc_class_fixed, "inspect", c_fixed_to_s);
+#endif
+
+  mrbc_define_method(vm, mrbc_class_fixnum, "to_fixed", c_fixed_to_fixed);
+#if MRBC_USE_FLOAT
+  mrbc_define_method(vm, mrbc_class_float, "to_fixed", c_fixed_to_fixed);
+
+  // Float op Fixed. (Float has no method for these)
+  mrbc_define_method(vm, mrbc_class_float, "+", c_fixed_add);
+  mrbc_define_method(vm, mrbc_class_float, "-", c_fixed_sub);
+  mrbc_define_method(vm, mrbc_class_float, "*", c_fixed_mul);
+  mrbc_define_method(vm, mrbc_class_float, "/", c_fixed_div);
+#endif
+}
+
+
+#endif  // MRBC_USE_FIXED
@@ -0,0 +1,120 @@
+/*! @file
+  @brief
+  mruby/c Fixed class (fixed-point number)
+
+  <pre>
+  Copyright (C) 2015-2020 Kyushu Institute of Technology.
+  Copyright (C) 2015-2020 Shimane IT Open-Innovation Center.
+
+  This file is distributed under BSD 3-Clause License.
+
+  </pre>
+*/
+
+#ifndef MRBC_SRC_C_FIXED_H_
+#define MRBC_SRC_C_FIXED_H_
+
+#include <stdint.h>
+#include "value.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#if MRBC_USE_FIXED
+
+#define MRBC_FIXED_ONE	((mrbc_fixed)1 << MRBC_FIXED_FRAC_BITS)
+#define MRBC_FIXED_MAX	INT32_MAX
+#define MRBC_FIXED_MIN	INT32_MIN
+
+#define mrbc_fixed_value(n)	((mrbc_value){.tt = MRBC_TT_FIXED, .fx=(n)})
+
+
+/*
+  Saturating operations.
+  The result is clipped to MRBC_FIXED_MIN..MRBC_FIXED_MAX, not wrapped.
+*/
+static inline mrbc_fixed mrbc_fixed_saturate( int64_t x )
+{
+  if( x > MRBC_FIXED_MAX ) return MRBC_FIXED_MAX;
+  if( x < MRBC_FIXED_MIN ) return MRBC_FIXED_MIN;
+  return (mrbc_fixed)x;
+}
+
+static inline mrbc_fixed mrbc_fixed_add( mrbc_fixed x, mrbc_fixed y )
+{
+  mrbc_fixed ret;
+  if( __builtin_add_overflow( x, y, &ret ) ) {
+    return (x < 0) ? MRBC_FIXED_MIN : MRBC_FIXED_MAX;
+  }
+  return ret;
+}
+
+static inline mrbc_fixed mrbc_fixed_sub( mrbc_fixed x, mrbc_fixed y )
+{
+  mrbc_fixed ret;
+  if( __builtin_sub_overflow( x, y, &ret ) ) {
+    return (x < 0) ? MRBC_FIXED_MIN : MRBC_FIXED_MAX;
+  }
+  return ret;
+}
+
+static inline mrbc_fixed mrbc_fixed_mul( mrbc_fixed x, mrbc_fixed y )
+{
+  return mrbc_fixed_saturate( ((int64_t)x * y) >> MRBC_FIXED_FRAC_BITS );
+}
+
+static inline mrbc_fixed mrbc_fixed_div( mrbc_fixed x, mrbc_fixed y )
+{
+  if( y == 0 ) return (x < 0) ? MRBC_FIXED_MIN : MRBC_FIXED_MAX;
+  return mrbc_fixed_saturate( (int64_t)x * MRBC_FIXED_ONE / y );
+}
+
+static inline mrbc_fixed mrbc_fixed_from_int( mrbc_int n )
+{
+  if( n > (MRBC_FIXED_MAX >> MRBC_FIXED_FRAC_BITS) ) return MRBC_FIXED_MAX;
+  if( n < (MRBC_FIXED_MIN >> MRBC_FIXED_FRAC_BITS) ) return MRBC_FIXED_MIN;
+  return (mrbc_fixed)n * MRBC_FIXED_ONE;
+}
+
+// truncate toward zero, same as Float#to_i.
+static inline mrbc_int mrbc_fixed_to_int( mrbc_fixed x )
+{
+  return x / MRBC_FIXED_ONE;
+}
+
+
+//================================================================
+/*! get the operands of Fixed arithmetic.
+
+  @return	true if both are Fixed or Fixnum, and at least one is Fixed.
+*/
+static inline int mrbc_fixed_operands( const mrbc_value *v1, const mrbc_value *v2,
+				       mrbc_fixed *x, mrbc_fixed *y )
+{
+  if( v1->tt == MRBC_TT_FIXED ) {
+    *x = v1->fx;
+    if( v2->tt == MRBC_TT_FIXED ) { *y = v2->fx; return 1; }
+    if( v2->tt == MRBC_TT_FIXNUM ) { *y = mrbc_fixed_from_int(v2->i); return 1; }
+
+  } else if( v1->tt == MRBC_TT_FIXNUM && v2->tt == MRBC_TT_FIXED ) {
+    *x = mrbc_fixed_from_int(v1->i);
+    *y = v2->fx;
+    return 1;
+  }
+
+  return 0;
+}
+
+
+int mrbc_fixed_compare(const mrbc_value *v1, const mrbc_value *v2);
+char *mrbc_fixed_to_cstr(mrbc_fixed x, char *buf);
+void mrbc_init_class_fixed(struct VM *vm);
+
+#endif  // MRBC_USE_FIXED
+
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -23,6 +23,7 @@
 #include "c_array.h"
 #include "c_hash.h"
 #include "c_string.h"
+#include "objspace.h"
 
 /*
   function summary
@@ -71,9 +72,11 @@ mrbc_value mrbc_hash_new(struct VM *vm, int size)
 
   h->ref_count = 1;
   h->tt = MRBC_TT_HASH;
+  h->flag_shared = 0;
   h->data_size = size * 2;
   h->n_stored = 0;
   h->data = data;
+  mrbc_objspace_new( MRBC_TT_HASH );
 
   value.hash = h;
   return value;
@@ -138,6 +141,8 @@ mrbc_value * mrbc_hash_search(const mrbc_value *hash, const mrbc_value *key)
 */
 int mrbc_hash_set(mrbc_value *hash, mrbc_value *key, mrbc_value *val)
 {
+  if( mrbc_array_unshare(hash) != 0 ) return E_NOMEMORY_ERROR;	// ENOMEM
+
   mrbc_value *v = mrbc_hash_search(hash, key);
   int ret = 0;
   if( v == NULL ) {
@@ -181,6 +186,8 @@ mrbc_value mrbc_hash_get(mrbc_value *hash, mrbc_value *key)
 */
 mrbc_value mrbc_hash_remove(mrbc_value *hash, mrbc_value *key)
 {
+  if( mrbc_array_unshare(hash) != 0 ) return mrbc_nil_value();	// ENOMEM
+
   mrbc_value *v = mrbc_hash_search(hash, key);
   if( v == NULL ) return mrbc_nil_value();
 
@@ -243,22 +250,9 @@ int mrbc_hash_compare(const mrbc_value *v1, const mrbc_value *v2)
 */
 mrbc_value mrbc_hash_dup( struct VM *vm, mrbc_value *src )
 {
-  mrbc_value ret = mrbc_hash_new(vm, mrbc_hash_size(src));
-  if( ret.hash == NULL ) return ret;		// ENOMEM
-
-  mrbc_hash *h = src->hash;
-  memcpy( ret.hash->data, h->data, sizeof(mrbc_value) * h->n_stored );
-  ret.hash->n_stored = h->n_stored;
-
-  mrbc_value *p1 = h->data;
-  const mrbc_value *p2 = p1 + h->n_stored;
-  while( p1 < p2 ) {
-    mrbc_dup(p1++);
-  }
-
   // TODO: dup other members.
 
-  return ret;
+  return mrbc_array_dup( vm, src );
 }
 
 
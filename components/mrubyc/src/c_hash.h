@@ -30,6 +30,7 @@ typedef struct RHash {
   //  Needs to be same members and order as RArray.
   MRBC_OBJECT_HEADER;
 
+  uint8_t flag_shared;	//!< data buffer is shared with dup. (copy on write)
   uint16_t data_size;	//!< data buffer size.
   uint16_t n_stored;	//!< # of stored.
   mrbc_value *data;	//!< pointer to allocated memory.
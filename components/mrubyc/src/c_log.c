@@ -0,0 +1,319 @@
+/*! @file
+  @brief
+  mruby/c Log class (deferred-format binary logging)
+
+  <pre>
+  Copyright (C) 2015-2020 Kyushu Institute of Technology.
+  Copyright (C) 2015-2020 Shimane IT Open-Innovation Center.
+
+  This file is distributed under BSD 3-Clause License.
+
+  (usage)
+  Log.info(12, temp, humid)		#log: 12 "temp=%.1f humid=%d%%"
+  Log.level = 2				# 0:debug 1:info 2:warn 3:error
+  Log.flush
+
+  MRBC_LOG_I( 12, adc, count );		// same in C. (Integer only)
+
+  A record keeps only the format id, timestamp, task id and the raw
+  argument values in a ring buffer, and the text is made on the host.
+  Log.flush (and the idle scheduler) writes the records to the console
+  as "@L <hex words>" lines, and tools/mrblog.rb decodes them with the
+  format table extracted from the "log:" comments in the sources.
+  </pre>
+*/
+
+#include "vm_config.h"
+#include <string.h>
+
+#include "value.h"
+#include "vm.h"
+#include "static.h"
+#include "class.h"
+#include "console.h"
+#include "rrt0.h"
+#include "c_fixed.h"
+#include "c_log.h"
+
+#if MRBC_USE_LOG
+
+#if (MRBC_LOG_BUFFER_SIZE & (MRBC_LOG_BUFFER_SIZE - 1)) != 0 || MRBC_LOG_BUFFER_SIZE > 0x8000
+#error "MRBC_LOG_BUFFER_SIZE must be a power of 2, and 32768 or less."
+#endif
+
+#define LOG_BUF(idx)	log_.buf[(idx) & (MRBC_LOG_BUFFER_SIZE - 1)]
+#define LOG_MAX_WORDS	(3 + MRBC_LOG_MAX_ARGS)
+
+
+uint8_t mrbc_log_level;
+
+static struct {
+  uint32_t head;		//!< write position. (free running)
+  uint32_t tail;		//!< read position. (free running)
+  mrbc_log_statistics stat;
+  uint32_t buf[MRBC_LOG_BUFFER_SIZE];
+} log_;
+
+
+//================================================================
+/*! write a log record.
+
+  @param  level		log level.
+  @param  fmt_id	format id. (0..65535)
+  @param  task_id	task (vm) id, or 0.
+  @param  types		argument types, 2 bits each.
+  @param  args		argument values.
+  @param  n_args	number of arguments.
+*/
+void mrbc_log_write(int level, int fmt_id, int task_id, uint32_t types,
+		    const uint32_t *args, int n_args)
+{
+  if( n_args > MRBC_LOG_MAX_ARGS ) n_args = MRBC_LOG_MAX_ARGS;
+  uint32_t n_words = n_args ? 3 + n_args : 2;
+
+  hal_disable_irq();
+  uint32_t head = log_.head;
+  uint32_t used = head - log_.tail;
+  if( used + n_words > MRBC_LOG_BUFFER_SIZE ) {
+    log_.stat.n_dropped++;
+    hal_enable_irq();
+    return;
+  }
+
+  LOG_BUF(head++) = (uint32_t)fmt_id << 16 | n_args << 12 |
+		    (level & 0x0f) << 8 | (task_id & 0xff);
+  LOG_BUF(head++) = mrbc_get_tick();
+  if( n_args ) {
+    LOG_BUF(head++) = types;
+    int i;
+    for( i = 0; i < n_args; i++ ) {
+      LOG_BUF(head++) = args[i];
+    }
+  }
+  log_.head = head;
+
+  log_.stat.n_records++;
+  used += n_words;
+  if( used > log_.stat.max_used ) log_.stat.max_used = used;
+  hal_enable_irq();
+}
+
+
+//================================================================
+/*! read records from the buffer. (for other transports)
+
+  @param  buf	output buffer.
+  @param  size	buffer size in words.
+  @return	number of words read. only whole records are read.
+*/
+int mrbc_log_read(uint32_t *buf, int size)
+{
+  int n = 0;
+
+  hal_disable_irq();
+  while( log_.tail != log_.head ) {
+    int n_args = (LOG_BUF(log_.tail) >> 12) & 0x0f;
+    int n_words = n_args ? 3 + n_args : 2;
+    if( n + n_words > size ) break;
+
+    int i;
+    for( i = 0; i < n_words; i++ ) {
+      buf[n++] = LOG_BUF(log_.tail++);
+    }
+  }
+  hal_enable_irq();
+
+  return n;
+}
+
+
+//================================================================
+/*! write out all records to the console as "@L <hex words>" lines.
+*/
+void mrbc_log_flush(void)
+{
+  static const char hex[] = "0123456789abcdef";
+  uint32_t rec[LOG_MAX_WORDS];
+  char line[2 + LOG_MAX_WORDS * 9 + 1];
+  int n;
+
+  while( (n = mrbc_log_read( rec, LOG_MAX_WORDS )) > 0 ) {
+    int i = 0;
+    while( i < n ) {
+      // one record per line.
+      int n_args = (rec[i] >> 12) & 0x0f;
+      int end = i + (n_args ? 3 + n_args : 2);
+      char *p = line;
+      *p++ = '@';
+      *p++ = 'L';
+
+      for( ; i < end; i++ ) {
+	int j;
+	*p++ = ' ';
+	for( j = 28; j >= 0; j -= 4 ) {
+	  *p++ = hex[(rec[i] >> j) & 0x0f];
+	}
+      }
+      *p++ = '\n';
+      console_nprint( line, p - line );
+    }
+  }
+}
+
+
+//================================================================
+/*! get the log statistics.
+
+  @param  stat	pointer to the result.
+*/
+void mrbc_log_get_statistics(mrbc_log_statistics *stat)
+{
+  hal_disable_irq();
+  *stat = log_.stat;
+  stat->used = log_.head - log_.tail;
+  hal_enable_irq();
+}
+
+
+//================================================================
+/*! get the bit pattern of float.
+*/
+static inline uint32_t float_bits(float f)
+{
+  uint32_t ret;
+  memcpy( &ret, &f, sizeof(ret) );
+  return ret;
+}
+
+
+//================================================================
+/*! Log.debug / info / warn / error (fmt_id, *args)
+*/
+static void c_log_sub(struct VM *vm, mrbc_value v[], int argc, int level)
+{
+  SET_NIL_RETURN();
+  if( level < mrbc_log_level ) return;
+
+  if( argc < 1 || v[1].tt != MRBC_TT_FIXNUM || (uint32_t)v[1].i > 0xffff ) {
+    console_printf("ArgumentError: Log needs format id\n");
+    return;
+  }
+
+  uint32_t args[MRBC_LOG_MAX_ARGS];
+  uint32_t types = 0;
+  int n_args = argc - 1;
+  if( n_args > MRBC_LOG_MAX_ARGS ) n_args = MRBC_LOG_MAX_ARGS;
+
+  int i;
+  for( i = 0; i < n_args; i++ ) {
+    mrbc_value *arg = &v[i+2];
+    uint32_t type = MRBC_LOG_TYPE_INT;
+
+    switch( arg->tt ) {
+    case MRBC_TT_FIXNUM:
+      args[i] = (uint32_t)arg->i;
+      break;
+
+#if MRBC_USE_FLOAT
+    case MRBC_TT_FLOAT:
+      args[i] = float_bits( arg->d );
+      type = MRBC_LOG_TYPE_FLOAT;
+      break;
+#endif
+
+#if MRBC_USE_FIXED
+    case MRBC_TT_FIXED:
+      args[i] = float_bits( (float)arg->fx / MRBC_FIXED_ONE );
+      type = MRBC_LOG_TYPE_FLOAT;
+      break;
+#endif
+
+    case MRBC_TT_NIL:	args[i] = 0; type = MRBC_LOG_TYPE_SPECIAL; break;
+    case MRBC_TT_FALSE:	args[i] = 1; type = MRBC_LOG_TYPE_SPECIAL; break;
+    case MRBC_TT_TRUE:	args[i] = 2; type = MRBC_LOG_TYPE_SPECIAL; break;
+    default:		args[i] = 3; type = MRBC_LOG_TYPE_SPECIAL; break;
+    }
+    types |= type << (i * 2);
+  }
+
+  mrbc_log_write( level, v[1].i, vm->vm_id, types, args, n_args );
+}
+
+static void c_log_debug(struct VM *vm, mrbc_value v[], int argc)
+{
+  c_log_sub( vm, v, argc, MRBC_LOG_DEBUG );
+}
+
+static void c_log_info(struct VM *vm, mrbc_value v[], int argc)
+{
+  c_log_sub( vm, v, argc, MRBC_LOG_INFO );
+}
+
+static void c_log_warn(struct VM *vm, mrbc_value v[], int argc)
+{
+  c_log_sub( vm, v, argc, MRBC_LOG_WARN );
+}
+
+static void c_log_error(struct VM *vm, mrbc_value v[], int argc)
+{
+  c_log_sub( vm, v, argc, MRBC_LOG_ERROR );
+}
+
+
+//================================================================
+/*! Log.level / Log.level=
+*/
+static void c_log_level(struct VM *vm, mrbc_value v[], int argc)
+{
+  SET_INT_RETURN( mrbc_log_level );
+}
+
+static void c_log_set_level(struct VM *vm, mrbc_value v[], int argc)
+{
+  if( v[1].tt != MRBC_TT_FIXNUM ) {
+    console_printf("ArgumentError: Log.level needs Integer\n");
+    return;
+  }
+  mrbc_log_level = v[1].i < 0 ? 0 : v[1].i > 0xff ? 0xff : v[1].i;
+}
+
+
+//================================================================
+/*! Log.flush
+*/
+static void c_log_flush(struct VM *vm, mrbc_value v[], int argc)
+{
+  mrbc_log_flush();
+  SET_NIL_RETURN();
+}
+
+
+//================================================================
+/*! Log.dropped	number of dropped records.
+*/
+static void c_log_dropped(struct VM *vm, mrbc_value v[], int argc)
+{
+  SET_INT_RETURN( log_.stat.n_dropped );
+}
+
+
+
+//================================================================
+/*! initialize
+*/
+void mrbc_init_class_log(struct VM *vm)
+{
+  mrbc_log_level = MRBC_LOG_DEFAULT_LEVEL;
+  mrbc_class_log = mrbc_define_class(vm, "Log", mrbc_class_object);
+
+  mrbc_define_method(vm, mrbc_class_log, "debug", c_log_debug);
+  mrbc_define_method(vm, mrbc_class_log, "info", c_log_info);
+  mrbc_define_method(vm, mrbc_class_log, "warn", c_log_warn);
+  mrbc_define_method(vm, mrbc_class_log, "error", c_log_error);
+  mrbc_define_method(vm, mrbc_class_log, "level", c_log_level);
+  mrbc_define_method(vm, mrbc_class_log, "level=", c_log_set_level);
+  mrbc_define_method(vm, mrbc_class_log, "flush", c_log_flush);
+  mrbc_define_method(vm, mrbc_class_log, "dropped", c_log_dropped);
+}
+
+#endif  // MRBC_USE_LOG
@@ -0,0 +1,91 @@
+/*! @file
+  @brief
+  mruby/c Log class (deferred-format binary logging)
+
+  <pre>
+  Copyright (C) 2015-2020 Kyushu Institute of Technology.
+  Copyright (C) 2015-2020 Shimane IT Open-Innovation Center.
+
+  This file is distributed under BSD 3-Clause License.
+
+  </pre>
+*/
+
+#ifndef MRBC_SRC_C_LOG_H_
+#define MRBC_SRC_C_LOG_H_
+
+#include <stdint.h>
+#include "value.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#if MRBC_USE_LOG
+
+#define MRBC_LOG_DEBUG	0
+#define MRBC_LOG_INFO	1
+#define MRBC_LOG_WARN	2
+#define MRBC_LOG_ERROR	3
+
+#define MRBC_LOG_MAX_ARGS 15
+
+/*
+  Record format. (uint32_t words)
+
+  [0] fmt_id << 16 | n_args << 12 | level << 8 | task id
+  [1] timestamp (tick count)
+  [2] argument types, 2 bits each (only if n_args > 0)
+  [3..] raw argument values
+*/
+#define MRBC_LOG_TYPE_INT	0	//!< int32_t
+#define MRBC_LOG_TYPE_FLOAT	1	//!< bits of float
+#define MRBC_LOG_TYPE_SPECIAL	2	//!< 0:nil 1:false 2:true 3:other
+
+
+//================================================================
+/*! log statistics.
+*/
+typedef struct LOG_STATISTICS {
+  uint32_t n_records;		//!< records written.
+  uint32_t n_dropped;		//!< records dropped. (buffer full)
+  uint16_t used;		//!< words in the buffer now.
+  uint16_t max_used;		//!< high-water mark.
+} mrbc_log_statistics;
+
+
+extern uint8_t mrbc_log_level;
+
+void mrbc_log_write(int level, int fmt_id, int task_id, uint32_t types,
+		    const uint32_t *args, int n_args);
+int mrbc_log_read(uint32_t *buf, int size);
+void mrbc_log_flush(void);
+void mrbc_log_get_statistics(mrbc_log_statistics *stat);
+void mrbc_init_class_log(struct VM *vm);
+
+
+//================================================================
+/*! write a log record with integer arguments from C.
+
+  MRBC_LOG( MRBC_LOG_INFO, 12, adc, count );	//log: 12 "adc=%d count=%d"
+*/
+#define MRBC_LOG(level, fmt_id, ...) do {				\
+    if( (level) >= mrbc_log_level ) {					\
+      const uint32_t log_args_[] = { 0, ##__VA_ARGS__ };		\
+      mrbc_log_write( (level), (fmt_id), 0, 0, log_args_ + 1,		\
+		      sizeof(log_args_) / sizeof(uint32_t) - 1 );	\
+    }									\
+  } while(0)
+
+#define MRBC_LOG_D(fmt_id, ...) MRBC_LOG(MRBC_LOG_DEBUG, fmt_id, ##__VA_ARGS__)
+#define MRBC_LOG_I(fmt_id, ...) MRBC_LOG(MRBC_LOG_INFO, fmt_id, ##__VA_ARGS__)
+#define MRBC_LOG_W(fmt_id, ...) MRBC_LOG(MRBC_LOG_WARN, fmt_id, ##__VA_ARGS__)
+#define MRBC_LOG_E(fmt_id, ...) MRBC_LOG(MRBC_LOG_ERROR, fmt_id, ##__VA_ARGS__)
+
+#endif  // MRBC_USE_LOG
+
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -15,216 +15,283 @@
 #include <math.h>
 
 #include "value.h"
+#include "alloc.h"
 #include "static.h"
 #include "class.h"
+#include "c_array.h"
+#include "console.h"
+#include "bind.h"
 
 
 #if MRBC_USE_FLOAT && MRBC_USE_MATH
 
 //================================================================
-/*! convert mrbc_value to c double
+/*! ldexp with Float exponent. (truncated)
 */
-static double to_double( const mrbc_value *v )
+static mrbc_float math_ldexp( mrbc_float x, mrbc_float exp )
 {
-  switch( v->tt ) {
-  case MRBC_TT_FIXNUM:	return (double)v->i;
-  case MRBC_TT_FLOAT:	return (double)v->d;
-  default:		return 0;	// TypeError. raise?
-  }
+  return MRBC_FLOAT_FUNC(ldexp)( x, (int)exp );
 }
 
 
-
-//================================================================
-/*! (method) acos
-*/
-static void c_math_acos(struct VM *vm, mrbc_value v[], int argc)
-{
-  v[0] = mrbc_float_value( acos( to_double(&v[1]) ));
-}
-
-//================================================================
-/*! (method) acosh
+/*
+  (method) Math.xxx
 */
-static void c_math_acosh(struct VM *vm, mrbc_value v[], int argc)
-{
-  v[0] = mrbc_float_value( acosh( to_double(&v[1]) ));
-}
-
-//================================================================
-/*! (method) asin
+MRBC_BIND_1( c_math_acos, FLOAT, MRBC_FLOAT_FUNC(acos), FLOAT )
+MRBC_BIND_1( c_math_acosh, FLOAT, MRBC_FLOAT_FUNC(acosh), FLOAT )
+MRBC_BIND_1( c_math_asin, FLOAT, MRBC_FLOAT_FUNC(asin), FLOAT )
+MRBC_BIND_1( c_math_asinh, FLOAT, MRBC_FLOAT_FUNC(asinh), FLOAT )
+MRBC_BIND_1( c_math_atan, FLOAT, MRBC_FLOAT_FUNC(atan), FLOAT )
+MRBC_BIND_2( c_math_atan2, FLOAT, MRBC_FLOAT_FUNC(atan2), FLOAT, FLOAT )
+MRBC_BIND_1( c_math_atanh, FLOAT, MRBC_FLOAT_FUNC(atanh), FLOAT )
+MRBC_BIND_1( c_math_cbrt, FLOAT, MRBC_FLOAT_FUNC(cbrt), FLOAT )
+MRBC_BIND_1( c_math_cos, FLOAT, MRBC_FLOAT_FUNC(cos), FLOAT )
+MRBC_BIND_1( c_math_cosh, FLOAT, MRBC_FLOAT_FUNC(cosh), FLOAT )
+MRBC_BIND_1( c_math_erf, FLOAT, MRBC_FLOAT_FUNC(erf), FLOAT )
+MRBC_BIND_1( c_math_erfc, FLOAT, MRBC_FLOAT_FUNC(erfc), FLOAT )
+MRBC_BIND_1( c_math_exp, FLOAT, MRBC_FLOAT_FUNC(exp), FLOAT )
+MRBC_BIND_2( c_math_hypot, FLOAT, MRBC_FLOAT_FUNC(hypot), FLOAT, FLOAT )
+MRBC_BIND_2( c_math_ldexp, FLOAT, math_ldexp, FLOAT, FLOAT )
+MRBC_BIND_1( c_math_log, FLOAT, MRBC_FLOAT_FUNC(log), FLOAT )
+MRBC_BIND_1( c_math_log10, FLOAT, MRBC_FLOAT_FUNC(log10), FLOAT )
+MRBC_BIND_1( c_math_log2, FLOAT, MRBC_FLOAT_FUNC(log2), FLOAT )
+MRBC_BIND_1( c_math_sin, FLOAT, MRBC_FLOAT_FUNC(sin), FLOAT )
+MRBC_BIND_1( c_math_sinh, FLOAT, MRBC_FLOAT_FUNC(sinh), FLOAT )
+MRBC_BIND_1( c_math_sqrt, FLOAT, MRBC_FLOAT_FUNC(sqrt), FLOAT )
+MRBC_BIND_1( c_math_tan, FLOAT, MRBC_FLOAT_FUNC(tan), FLOAT )
+MRBC_BIND_1( c_math_tanh, FLOAT, MRBC_FLOAT_FUNC(tanh), FLOAT )
+
+
+/*
+  Array versions.
+
+  The elements are unboxed into a plain mrbc_float buffer first, so the
+  loops below run over contiguous floats and the compiler can unroll
+  and vectorize them, and the method is dispatched only once per array.
 */
-static void c_math_asin(struct VM *vm, mrbc_value v[], int argc)
-{
-  v[0] = mrbc_float_value( asin( to_double(&v[1]) ));
-}
-
 //================================================================
-/*! (method) asinh
-*/
-static void c_math_asinh(struct VM *vm, mrbc_value v[], int argc)
-{
-  v[0] = mrbc_float_value( asinh( to_double(&v[1]) ));
-}
+/*! unbox the numeric array to the float buffer.
 
-//================================================================
-/*! (method) atan
+  @param  vm	pointer to VM.
+  @param  ary	Array of Float or Integer.
+  @param  n	returns number of elements.
+  @return	allocated buffer, or NULL if error.
 */
-static void c_math_atan(struct VM *vm, mrbc_value v[], int argc)
+static mrbc_float *math_unbox_array(struct VM *vm, const mrbc_value *ary, int *n)
 {
-  v[0] = mrbc_float_value( atan( to_double(&v[1]) ));
-}
+  if( ary->tt != MRBC_TT_ARRAY ) goto TYPE_ERROR;
+
+  *n = mrbc_array_size(ary);
+  mrbc_float *buf = mrbc_alloc( vm, sizeof(mrbc_float) * (*n ? *n : 1) );
+  if( !buf ) return NULL;		// ENOMEM
+
+  const mrbc_value *p = ary->array->data;
+  int i;
+  for( i = 0; i < *n; i++ ) {
+    if( !MRBC_BIND_CHECK_FLOAT(p[i]) ) {
+      mrbc_raw_free( buf );
+      goto TYPE_ERROR;
+    }
+    buf[i] = MRBC_BIND_GET_FLOAT(p[i]);
+  }
+  return buf;
 
-//================================================================
-/*! (method) atan2
-*/
-static void c_math_atan2(struct VM *vm, mrbc_value v[], int argc)
-{
-  v[0] = mrbc_float_value( atan2( to_double(&v[1]), to_double(&v[2]) ));
+ TYPE_ERROR:
+  console_printf("TypeError: wrong argument type.\n");
+  return NULL;
 }
 
-//================================================================
-/*! (method) atanh
-*/
-static void c_math_atanh(struct VM *vm, mrbc_value v[], int argc)
-{
-  v[0] = mrbc_float_value( atanh( to_double(&v[1]) ));
-}
 
 //================================================================
-/*! (method) cbrt
+/*! box the float buffer to the new array, and free the buffer.
 */
-static void c_math_cbrt(struct VM *vm, mrbc_value v[], int argc)
+static mrbc_value math_box_array(struct VM *vm, mrbc_float *buf, int n)
 {
-  v[0] = mrbc_float_value( cbrt( to_double(&v[1]) ));
-}
+  mrbc_value ret = mrbc_array_new( vm, n );
+  if( ret.array ) {
+    int i;
+    for( i = 0; i < n; i++ ) {
+      ret.array->data[i] = mrbc_float_value( buf[i] );
+    }
+    ret.array->n_stored = n;
+  }
+  mrbc_raw_free( buf );
 
-//================================================================
-/*! (method) cos
-*/
-static void c_math_cos(struct VM *vm, mrbc_value v[], int argc)
-{
-  v[0] = mrbc_float_value( cos( to_double(&v[1]) ));
+  return ret.array ? ret : mrbc_nil_value();
 }
 
-//================================================================
-/*! (method) cosh
-*/
-static void c_math_cosh(struct VM *vm, mrbc_value v[], int argc)
-{
-  v[0] = mrbc_float_value( cosh( to_double(&v[1]) ));
-}
 
-//================================================================
-/*! (method) erf
+/*
+  (method) Math.xxx_all(ary)
 */
-static void c_math_erf(struct VM *vm, mrbc_value v[], int argc)
-{
-  v[0] = mrbc_float_value( erf( to_double(&v[1]) ));
-}
+#define MATH_MAP_1(wrapper, cfunc)				\
+  static void wrapper(struct VM *vm, mrbc_value v[], int argc)	\
+  {								\
+    int n, i;							\
+    mrbc_float *buf;						\
+    if( argc != 1 ) {						\
+      mrbc_bind_error( vm, v, argc, 1, 1 );			\
+      return;							\
+    }								\
+    buf = math_unbox_array( vm, &v[1], &n );			\
+    if( !buf ) {						\
+      SET_NIL_RETURN();						\
+      return;							\
+    }								\
+    for( i = 0; i < n; i++ ) buf[i] = cfunc( buf[i] );		\
+    SET_RETURN( math_box_array( vm, buf, n ) );			\
+  }
 
-//================================================================
-/*! (method) erfc
-*/
-static void c_math_erfc(struct VM *vm, mrbc_value v[], int argc)
-{
-  v[0] = mrbc_float_value( erfc( to_double(&v[1]) ));
-}
+MATH_MAP_1( c_math_cos_all, MRBC_FLOAT_FUNC(cos) )
+MATH_MAP_1( c_math_exp_all, MRBC_FLOAT_FUNC(exp) )
+MATH_MAP_1( c_math_log_all, MRBC_FLOAT_FUNC(log) )
+MATH_MAP_1( c_math_log10_all, MRBC_FLOAT_FUNC(log10) )
+MATH_MAP_1( c_math_sin_all, MRBC_FLOAT_FUNC(sin) )
+MATH_MAP_1( c_math_sqrt_all, MRBC_FLOAT_FUNC(sqrt) )
+MATH_MAP_1( c_math_tan_all, MRBC_FLOAT_FUNC(tan) )
 
-//================================================================
-/*! (method) exp
-*/
-static void c_math_exp(struct VM *vm, mrbc_value v[], int argc)
-{
-  v[0] = mrbc_float_value( exp( to_double(&v[1]) ));
-}
 
 //================================================================
-/*! (method) hypot
+/*! (method) Math.hypot_all(xs, ys)
 */
-static void c_math_hypot(struct VM *vm, mrbc_value v[], int argc)
+static void c_math_hypot_all(struct VM *vm, mrbc_value v[], int argc)
 {
-  v[0] = mrbc_float_value( hypot( to_double(&v[1]), to_double(&v[2]) ));
-}
+  if( argc != 2 ) {
+    mrbc_bind_error( vm, v, argc, 2, 2 );
+    return;
+  }
 
-//================================================================
-/*! (method) ldexp
-*/
-static void c_math_ldexp(struct VM *vm, mrbc_value v[], int argc)
-{
-  int exp;
-  switch( v[2].tt ) {
-  case MRBC_TT_FIXNUM:	exp = v[2].i;		break;
-  case MRBC_TT_FLOAT:	exp = (int)v[2].d;	break;
-  default:		exp = 0;	// TypeError. raise?
+  int n, n2, i;
+  mrbc_float *xs = math_unbox_array( vm, &v[1], &n );
+  mrbc_float *ys = xs ? math_unbox_array( vm, &v[2], &n2 ) : NULL;
+  if( !ys ) goto RETURN_NIL;
+  if( n != n2 ) {
+    console_printf("ArgumentError: array size mismatch\n");
+    goto RETURN_NIL;
   }
 
-  v[0] = mrbc_float_value( ldexp( to_double(&v[1]), exp ));
-}
+  // not hypot(), to keep the loop vectorizable.
+  for( i = 0; i < n; i++ ) xs[i] = MRBC_FLOAT_FUNC(sqrt)( xs[i] * xs[i] + ys[i] * ys[i] );
+  mrbc_raw_free( ys );
+  SET_RETURN( math_box_array( vm, xs, n ) );
+  return;
 
-//================================================================
-/*! (method) log
-*/
-static void c_math_log(struct VM *vm, mrbc_value v[], int argc)
-{
-  v[0] = mrbc_float_value( log( to_double(&v[1]) ));
+ RETURN_NIL:
+  if( xs ) mrbc_raw_free( xs );
+  if( ys ) mrbc_raw_free( ys );
+  SET_NIL_RETURN();
 }
 
-//================================================================
-/*! (method) log10
-*/
-static void c_math_log10(struct VM *vm, mrbc_value v[], int argc)
-{
-  v[0] = mrbc_float_value( log10( to_double(&v[1]) ));
-}
 
-//================================================================
-/*! (method) log2
+/*
+  reductions.
 */
-static void c_math_log2(struct VM *vm, mrbc_value v[], int argc)
+static mrbc_float math_sum( const mrbc_float *buf, int n )
 {
-  v[0] = mrbc_float_value( log2( to_double(&v[1]) ));
+  mrbc_float sum = 0;
+  int i;
+  for( i = 0; i < n; i++ ) sum += buf[i];
+  return sum;
 }
 
-//================================================================
-/*! (method) sin
-*/
-static void c_math_sin(struct VM *vm, mrbc_value v[], int argc)
+static mrbc_float math_mean( const mrbc_float *buf, int n )
 {
-  v[0] = mrbc_float_value( sin( to_double(&v[1]) ));
+  return n ? math_sum( buf, n ) / n : 0;
 }
 
-//================================================================
-/*! (method) sinh
-*/
-static void c_math_sinh(struct VM *vm, mrbc_value v[], int argc)
+static mrbc_float math_rms( const mrbc_float *buf, int n )
 {
-  v[0] = mrbc_float_value( sinh( to_double(&v[1]) ));
+  mrbc_float sum = 0;
+  int i;
+  for( i = 0; i < n; i++ ) sum += buf[i] * buf[i];
+  return n ? MRBC_FLOAT_FUNC(sqrt)( sum / n ) : 0;
 }
 
-//================================================================
-/*! (method) sqrt
-*/
-static void c_math_sqrt(struct VM *vm, mrbc_value v[], int argc)
+// population variance, in two passes for accuracy.
+static mrbc_float math_variance( const mrbc_float *buf, int n )
 {
-  v[0] = mrbc_float_value( sqrt( to_double(&v[1]) ));
+  mrbc_float mean = math_mean( buf, n );
+  mrbc_float sum = 0;
+  int i;
+  for( i = 0; i < n; i++ ) sum += (buf[i] - mean) * (buf[i] - mean);
+  return n ? sum / n : 0;
 }
 
-//================================================================
-/*! (method) tan
-*/
-static void c_math_tan(struct VM *vm, mrbc_value v[], int argc)
+static mrbc_float math_stddev( const mrbc_float *buf, int n )
 {
-  v[0] = mrbc_float_value( tan( to_double(&v[1]) ));
+  return MRBC_FLOAT_FUNC(sqrt)( math_variance( buf, n ) );
 }
 
-//================================================================
-/*! (method) tanh
+
+/*
+  (method) Math.xxx(ary)
 */
-static void c_math_tanh(struct VM *vm, mrbc_value v[], int argc)
-{
-  v[0] = mrbc_float_value( tanh( to_double(&v[1]) ));
-}
+#define MATH_REDUCE(wrapper, cfunc)				\
+  static void wrapper(struct VM *vm, mrbc_value v[], int argc)	\
+  {								\
+    int n;							\
+    mrbc_float *buf, ret;					\
+    if( argc != 1 ) {						\
+      mrbc_bind_error( vm, v, argc, 1, 1 );			\
+      return;							\
+    }								\
+    buf = math_unbox_array( vm, &v[1], &n );			\
+    if( !buf ) {						\
+      SET_NIL_RETURN();						\
+      return;							\
+    }								\
+    ret = cfunc( buf, n );					\
+    mrbc_raw_free( buf );					\
+    SET_FLOAT_RETURN( ret );					\
+  }
+
+MATH_REDUCE( c_math_sum, math_sum )
+MATH_REDUCE( c_math_mean, math_mean )
+MATH_REDUCE( c_math_rms, math_rms )
+MATH_REDUCE( c_math_variance, math_variance )
+MATH_REDUCE( c_math_stddev, math_stddev )
+
+
+static const mrbc_method_table math_methods[] = {
+  { "acos",	c_math_acos },
+  { "acosh",	c_math_acosh },
+  { "asin",	c_math_asin },
+  { "asinh",	c_math_asinh },
+  { "atan",	c_math_atan },
+  { "atan2",	c_math_atan2 },
+  { "atanh",	c_math_atanh },
+  { "cbrt",	c_math_cbrt },
+  { "cos",	c_math_cos },
+  { "cosh",	c_math_cosh },
+  { "erf",	c_math_erf },
+  { "erfc",	c_math_erfc },
+  { "exp",	c_math_exp },
+  { "hypot",	c_math_hypot },
+  { "ldexp",	c_math_ldexp },
+  { "log",	c_math_log },
+  { "log10",	c_math_log10 },
+  { "log2",	c_math_log2 },
+  { "sin",	c_math_sin },
+  { "sinh",	c_math_sinh },
+  { "sqrt",	c_math_sqrt },
+  { "tan",	c_math_tan },
+  { "tanh",	c_math_tanh },
+
+  { "cos_all",	c_math_cos_all },
+  { "exp_all",	c_math_exp_all },
+  { "hypot_all",c_math_hypot_all },
+  { "log_all",	c_math_log_all },
+  { "log10_all",c_math_log10_all },
+  { "sin_all",	c_math_sin_all },
+  { "sqrt_all",	c_math_sqrt_all },
+  { "tan_all",	c_math_tan_all },
+
+  { "mean",	c_math_mean },
+  { "rms",	c_math_rms },
+  { "stddev",	c_math_stddev },
+  { "sum",	c_math_sum },
+  { "variance",	c_math_variance },
+};
 
 
 //================================================================
@@ -232,31 +299,8 @@ static void c_math_tanh(struct VM *vm, mrbc_value v[], int argc)
 */
 void mrbc_init_class_math(struct VM *vm)
 {
-  mrbc_class_math = mrbc_define_class(vm, "Math",	mrbc_class_object);
-
-  mrbc_define_method(vm, mrbc_class_math, "acos",	c_math_acos);
-  mrbc_define_method(vm, mrbc_class_math, "acosh",	c_math_acosh);
-  mrbc_define_method(vm, mrbc_class_math, "asin",	c_math_asin);
-  mrbc_define_method(vm, mrbc_class_math, "asinh",	c_math_asinh);
-  mrbc_define_method(vm, mrbc_class_math, "atan",	c_math_atan);
-  mrbc_define_method(vm, mrbc_class_math, "atan2",	c_math_atan2);
-  mrbc_define_method(vm, mrbc_class_math, "atanh",	c_math_atanh);
-  mrbc_define_method(vm, mrbc_class_math, "cbrt",	c_math_cbrt);
-  mrbc_define_method(vm, mrbc_class_math, "cos",	c_math_cos);
-  mrbc_define_method(vm, mrbc_class_math, "cosh",	c_math_cosh);
-  mrbc_define_method(vm, mrbc_class_math, "erf",	c_math_erf);
-  mrbc_define_method(vm, mrbc_class_math, "erfc",	c_math_erfc);
-  mrbc_define_method(vm, mrbc_class_math, "exp",	c_math_exp);
-  mrbc_define_method(vm, mrbc_class_math, "hypot",	c_math_hypot);
-  mrbc_define_method(vm, mrbc_class_math, "ldexp",	c_math_ldexp);
-  mrbc_define_method(vm, mrbc_class_math, "log",	c_math_log);
-  mrbc_define_method(vm, mrbc_class_math, "log10",	c_math_log10);
-  mrbc_define_method(vm, mrbc_class_math, "log2",	c_math_log2);
-  mrbc_define_method(vm, mrbc_class_math, "sin",	c_math_sin);
-  mrbc_define_method(vm, mrbc_class_math, "sinh",	c_math_sinh);
-  mrbc_define_method(vm, mrbc_class_math, "sqrt",	c_math_sqrt);
-  mrbc_define_method(vm, mrbc_class_math, "tan",	c_math_tan);
-  mrbc_define_method(vm, mrbc_class_math, "tanh",	c_math_tanh);
+  mrbc_class_math = mrbc_define_class_with_methods(vm, "Math", mrbc_class_object,
+			math_methods, MRBC_COUNTOF(math_methods));
 }
 
 
@@ -33,8 +33,8 @@
  */
 static void c_fixnum_bitref(struct VM *vm, mrbc_value v[], int argc)
 {
-  if( 0 <= v[1].i && v[1].i < 32 ) {
-    SET_INT_RETURN( (v[0].i & (1 << v[1].i)) ? 1 : 0 );
+  if( 0 <= v[1].i && v[1].i < (int)sizeof(mrbc_int) * CHAR_BIT ) {
+    SET_INT_RETURN( (v[0].i & ((mrbc_int)1 << v[1].i)) ? 1 : 0 );
   } else {
     SET_INT_RETURN( 0 );
   }
@@ -55,8 +55,7 @@ static void c_fixnum_positive(struct VM *vm, mrbc_value v[], int argc)
 */
 static void c_fixnum_negative(struct VM *vm, mrbc_value v[], int argc)
 {
-  mrbc_int num = GET_INT_ARG(0);
-  SET_INT_RETURN( -num );
+  mrbc_int_sub( v, 0, v[0].i );
 }
 
 
@@ -67,18 +66,23 @@ static void c_fixnum_power(struct VM *vm, mrbc_value v[], int argc)
 {
   if( v[1].tt == MRBC_TT_FIXNUM ) {
     mrbc_int x = 1;
-    int i;
+    mrbc_int i;
 
     if( v[1].i < 0 ) x = 0;
     for( i = 0; i < v[1].i; i++ ) {
-      x *= v[0].i;;
+      if( __builtin_mul_overflow( x, v[0].i, &x ) ) {
+#if MRBC_USE_FLOAT && MRBC_USE_MATH
+	SET_FLOAT_RETURN( MRBC_FLOAT_FUNC(pow)( v[0].i, v[1].i ) );
+	return;
+#endif
+      }
     }
     SET_INT_RETURN( x );
   }
 
 #if MRBC_USE_FLOAT && MRBC_USE_MATH
   else if( v[1].tt == MRBC_TT_FLOAT ) {
-    SET_FLOAT_RETURN( pow( v[0].i, v[1].d ) );
+    SET_FLOAT_RETURN( MRBC_FLOAT_FUNC(pow)( v[0].i, v[1].d ) );
   }
 #endif
 }
@@ -175,7 +179,7 @@ static void c_fixnum_rshift(struct VM *vm, mrbc_value v[], int argc)
 static void c_fixnum_abs(struct VM *vm, mrbc_value v[], int argc)
 {
   if( v[0].i < 0 ) {
-    v[0].i = -v[0].i;
+    mrbc_int_sub( v, 0, v[0].i );
   }
 }
 
@@ -219,7 +223,7 @@ static void c_fixnum_to_s(struct VM *vm, mrbc_value v[], int argc)
   }
 
   mrbc_printf pf;
-  char buf[16];
+  char buf[sizeof(mrbc_int) * CHAR_BIT + 2];
   mrbc_printf_init( &pf, buf, sizeof(buf), NULL );
   pf.fmt.type = 'd';
   mrbc_printf_int( &pf, v->i, base );
@@ -296,7 +300,7 @@ static void c_float_power(struct VM *vm, mrbc_value v[], int argc)
   default:				break;
   }
 
-  SET_FLOAT_RETURN( pow( v[0].d, n ));
+  SET_FLOAT_RETURN( MRBC_FLOAT_FUNC(pow)( v[0].d, n ));
 }
 #endif
 
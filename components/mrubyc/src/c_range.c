@@ -20,6 +20,7 @@
 #include "c_string.h"
 #include "console.h"
 #include "opcode.h"
+#include "objspace.h"
 
 
 //================================================================
@@ -43,6 +44,7 @@ mrbc_value mrbc_range_new(struct VM *vm, mrbc_value *first, mrbc_value *last, in
   value.range->flag_exclude = flag_exclude;
   value.range->first = *first;
   value.range->last = *last;
+  mrbc_objspace_new( MRBC_TT_RANGE );
 
   return value;
 }
@@ -55,6 +57,7 @@ mrbc_value mrbc_range_new(struct VM *vm, mrbc_value *first, mrbc_value *last, in
 */
 void mrbc_range_delete(mrbc_value *v)
 {
+  mrbc_objspace_delete( MRBC_TT_RANGE );
   mrbc_dec_ref_counter( &v->range->first );
   mrbc_dec_ref_counter( &v->range->last );
 
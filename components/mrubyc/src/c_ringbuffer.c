@@ -0,0 +1,466 @@
+/*! @file
+  @brief
+  mruby/c RingBuffer class
+
+  <pre>
+  Copyright (C) 2015-2020 Kyushu Institute of Technology.
+  Copyright (C) 2015-2020 Shimane IT Open-Innovation Center.
+
+  This file is distributed under BSD 3-Clause License.
+
+  (usage)
+  rb = RingBuffer.new(4)		# grows when full.
+  rb = RingBuffer.new(4, true)		# keeps the last 4 data.
+  rb.push(x); rb.shift; rb.unshift(x); rb.pop; rb[0]; rb[-1]
+
+  Both ends are O(1), unlike Array#shift and Array#unshift which
+  move all data. In overwrite mode, push drops the first data and
+  unshift drops the last data when full, and never allocates memory.
+  </pre>
+*/
+
+#include "vm_config.h"
+#include <string.h>
+
+#include "value.h"
+#include "vm.h"
+#include "alloc.h"
+#include "static.h"
+#include "class.h"
+#include "console.h"
+#include "c_array.h"
+#include "c_ringbuffer.h"
+
+
+#define RINGBUFFER(v)	((mrbc_ringbuffer *)((v)->instance->data))
+
+
+//================================================================
+/*! check the instance is RingBuffer.
+*/
+static int is_ringbuffer(const mrbc_value *v)
+{
+  if( v->tt != MRBC_TT_OBJECT ) return 0;
+
+  const mrbc_class *cls = v->instance->cls;
+  while( cls ) {
+    if( cls == mrbc_class_ringbuffer ) return 1;
+    cls = cls->super;
+  }
+  return 0;
+}
+
+
+//================================================================
+/*! pointer to the i'th data from the head. (0 <= i < capacity)
+*/
+static inline mrbc_value *ringbuffer_at(const mrbc_ringbuffer *rb, int i)
+{
+  i += rb->head;
+  if( i >= rb->capacity ) i -= rb->capacity;
+  return &rb->data[i];
+}
+
+
+//================================================================
+/*! make room for one data.
+
+  @return	mrbc_error_code
+*/
+static int ringbuffer_make_room(struct VM *vm, mrbc_ringbuffer *rb, int at_head)
+{
+  if( rb->n_stored < rb->capacity ) return 0;
+
+  if( rb->flag_overwrite ) {
+    // drop the data at the other end.
+    if( at_head ) {
+      mrbc_release( ringbuffer_at(rb, rb->n_stored - 1) );
+    } else {
+      mrbc_release( &rb->data[rb->head] );
+      if( ++rb->head >= rb->capacity ) rb->head = 0;
+    }
+    rb->n_stored--;
+    return 0;
+  }
+
+  // grow, and unwrap the data.
+  int size = rb->capacity * 2;
+  if( size > UINT16_MAX ) size = UINT16_MAX;
+  if( size == rb->capacity ) return E_INDEX_ERROR;
+
+  mrbc_value *data = mrbc_alloc(vm, sizeof(mrbc_value) * size);
+  if( !data ) return E_NOMEMORY_ERROR;		// ENOMEM
+
+  int n1 = rb->capacity - rb->head;
+  memcpy( data, rb->data + rb->head, sizeof(mrbc_value) * n1 );
+  memcpy( data + n1, rb->data, sizeof(mrbc_value) * rb->head );
+  mrbc_raw_free( rb->data );
+
+  rb->data = data;
+  rb->capacity = size;
+  rb->head = 0;
+
+  return 0;
+}
+
+
+//================================================================
+/*! release all data. (called from mrbc_instance_delete)
+
+  @param  v	pointer to instance.
+*/
+void mrbc_ringbuffer_instance_clear(mrbc_value *v)
+{
+  if( !is_ringbuffer(v) ) return;
+
+  mrbc_ringbuffer *rb = RINGBUFFER(v);
+  if( !rb->data ) return;
+
+  int i;
+  for( i = 0; i < rb->n_stored; i++ ) {
+    mrbc_release( ringbuffer_at(rb, i) );
+  }
+  mrbc_raw_free( rb->data );
+  rb->data = NULL;
+}
+
+
+//================================================================
+/*! (class method) new
+
+  RingBuffer.new( capacity = 8, overwrite = false )
+*/
+static void c_ringbuffer_new(struct VM *vm, mrbc_value v[], int argc)
+{
+  int capacity = 8;
+  if( argc >= 1 ) {
+    if( v[1].tt != MRBC_TT_FIXNUM || v[1].i <= 0 || v[1].i > UINT16_MAX ) {
+      console_printf("ArgumentError: invalid capacity\n");
+      SET_NIL_RETURN();
+      return;
+    }
+    capacity = v[1].i;
+  }
+
+  mrbc_value ret = mrbc_instance_new(vm, v->cls, sizeof(mrbc_ringbuffer));
+  if( !ret.instance ) goto RETURN_NIL;		// ENOMEM
+
+  mrbc_ringbuffer *rb = RINGBUFFER(&ret);
+  rb->capacity = capacity;
+  rb->head = 0;
+  rb->n_stored = 0;
+  rb->flag_overwrite = (argc >= 2 && v[2].tt > MRBC_TT_FALSE);
+  rb->data = mrbc_alloc(vm, sizeof(mrbc_value) * capacity);
+  if( !rb->data ) {				// ENOMEM
+    mrbc_release( &ret );
+    goto RETURN_NIL;
+  }
+
+  SET_RETURN( ret );
+  return;
+
+ RETURN_NIL:
+  SET_NIL_RETURN();
+}
+
+
+//================================================================
+/*! (method) push, <<
+*/
+static void c_ringbuffer_push(struct VM *vm, mrbc_value v[], int argc)
+{
+  mrbc_ringbuffer *rb = RINGBUFFER(v);
+
+  if( argc != 1 || ringbuffer_make_room( vm, rb, 0 ) != 0 ) {
+    console_printf("Can't push to RingBuffer.\n");
+    return;
+  }
+
+  *ringbuffer_at(rb, rb->n_stored++) = v[1];
+  v[1].tt = MRBC_TT_EMPTY;
+}
+
+
+//================================================================
+/*! (method) unshift
+*/
+static void c_ringbuffer_unshift(struct VM *vm, mrbc_value v[], int argc)
+{
+  mrbc_ringbuffer *rb = RINGBUFFER(v);
+
+  if( argc != 1 || ringbuffer_make_room( vm, rb, 1 ) != 0 ) {
+    console_printf("Can't unshift to RingBuffer.\n");
+    return;
+  }
+
+  rb->head = (rb->head == 0) ? rb->capacity - 1 : rb->head - 1;
+  rb->data[rb->head] = v[1];
+  rb->n_stored++;
+  v[1].tt = MRBC_TT_EMPTY;
+}
+
+
+//================================================================
+/*! (method) shift
+*/
+static void c_ringbuffer_shift(struct VM *vm, mrbc_value v[], int argc)
+{
+  mrbc_ringbuffer *rb = RINGBUFFER(v);
+
+  if( rb->n_stored == 0 ) {
+    SET_NIL_RETURN();
+    return;
+  }
+
+  mrbc_value ret = rb->data[rb->head];
+  if( ++rb->head >= rb->capacity ) rb->head = 0;
+  rb->n_stored--;
+
+  SET_RETURN( ret );
+}
+
+
+//================================================================
+/*! (method) pop
+*/
+static void c_ringbuffer_pop(struct VM *vm, mrbc_value v[], int argc)
+{
+  mrbc_ringbuffer *rb = RINGBUFFER(v);
+
+  if( rb->n_stored == 0 ) {
+    SET_NIL_RETURN();
+    return;
+  }
+
+  mrbc_value ret = *ringbuffer_at(rb, --rb->n_stored);
+  SET_RETURN( ret );
+}
+
+
+//================================================================
+/*! (method) []
+*/
+static void c_ringbuffer_get(struct VM *vm, mrbc_value v[], int argc)
+{
+  mrbc_ringbuffer *rb = RINGBUFFER(v);
+
+  if( argc != 1 || v[1].tt != MRBC_TT_FIXNUM ) {
+    console_printf("ArgumentError\n");
+    SET_NIL_RETURN();
+    return;
+  }
+
+  int idx = v[1].i;
+  if( idx < 0 ) idx += rb->n_stored;
+  if( idx < 0 || idx >= rb->n_stored ) {
+    SET_NIL_RETURN();
+    return;
+  }
+
+  mrbc_value ret = *ringbuffer_at(rb, idx);
+  mrbc_dup( &ret );
+  SET_RETURN( ret );
+}
+
+
+//================================================================
+/*! (method) []=
+*/
+static void c_ringbuffer_set(struct VM *vm, mrbc_value v[], int argc)
+{
+  mrbc_ringbuffer *rb = RINGBUFFER(v);
+
+  int idx = (argc == 2 && v[1].tt == MRBC_TT_FIXNUM) ? v[1].i : rb->n_stored;
+  if( idx < 0 ) idx += rb->n_stored;
+  if( idx < 0 || idx >= rb->n_stored ) {
+    console_printf("IndexError\n");
+    return;
+  }
+
+  mrbc_value *p = ringbuffer_at(rb, idx);
+  mrbc_release( p );
+  *p = v[2];
+  v[2].tt = MRBC_TT_EMPTY;
+}
+
+
+//================================================================
+/*! (method) first
+*/
+static void c_ringbuffer_first(struct VM *vm, mrbc_value v[], int argc)
+{
+  mrbc_ringbuffer *rb = RINGBUFFER(v);
+  mrbc_value ret = rb->n_stored ? rb->data[rb->head] : mrbc_nil_value();
+
+  mrbc_dup( &ret );
+  SET_RETURN( ret );
+}
+
+
+//================================================================
+/*! (method) last
+*/
+static void c_ringbuffer_last(struct VM *vm, mrbc_value v[], int argc)
+{
+  mrbc_ringbuffer *rb = RINGBUFFER(v);
+  mrbc_value ret = rb->n_stored ? *ringbuffer_at(rb, rb->n_stored - 1)
+				: mrbc_nil_value();
+  mrbc_dup( &ret );
+  SET_RETURN( ret );
+}
+
+
+//================================================================
+/*! (method) size, length
+*/
+static void c_ringbuffer_size(struct VM *vm, mrbc_value v[], int argc)
+{
+  SET_INT_RETURN( RINGBUFFER(v)->n_stored );
+}
+
+
+//================================================================
+/*! (method) capacity
+*/
+static void c_ringbuffer_capacity(struct VM *vm, mrbc_value v[], int argc)
+{
+  SET_INT_RETURN( RINGBUFFER(v)->capacity );
+}
+
+
+//================================================================
+/*! (method) empty?
+*/
+static void c_ringbuffer_empty(struct VM *vm, mrbc_value v[], int argc)
+{
+  SET_BOOL_RETURN( RINGBUFFER(v)->n_stored == 0 );
+}
+
+
+//================================================================
+/*! (method) full?
+*/
+static void c_ringbuffer_full(struct VM *vm, mrbc_value v[], int argc)
+{
+  mrbc_ringbuffer *rb = RINGBUFFER(v);
+  SET_BOOL_RETURN( rb->n_stored == rb->capacity );
+}
+
+
+//================================================================
+/*! (method) clear
+*/
+static void c_ringbuffer_clear(struct VM *vm, mrbc_value v[], int argc)
+{
+  mrbc_ringbuffer *rb = RINGBUFFER(v);
+
+  int i;
+  for( i = 0; i < rb->n_stored; i++ ) {
+    mrbc_release( ringbuffer_at(rb, i) );
+  }
+  rb->head = 0;
+  rb->n_stored = 0;
+}
+
+
+//================================================================
+/*! (method) to_a
+*/
+static void c_ringbuffer_to_a(struct VM *vm, mrbc_value v[], int argc)
+{
+  mrbc_ringbuffer *rb = RINGBUFFER(v);
+
+  mrbc_value ret = mrbc_array_new(vm, rb->n_stored);
+  if( !ret.array ) {				// ENOMEM
+    SET_NIL_RETURN();
+    return;
+  }
+
+  int i;
+  for( i = 0; i < rb->n_stored; i++ ) {
+    mrbc_value *p = ringbuffer_at(rb, i);
+    mrbc_dup( p );
+    ret.array->data[i] = *p;
+  }
+  ret.array->n_stored = rb->n_stored;
+
+  SET_RETURN( ret );
+}
+
+
+//================================================================
+/*! (method) each
+*/
+static void c_ringbuffer_each(struct VM *vm, mrbc_value v[], int argc)
+{
+  mrbc_ringbuffer *rb = RINGBUFFER(v);
+  if( v[argc+1].tt != MRBC_TT_PROC ) return;
+
+  int i;
+  for( i = 0; i < rb->n_stored; i++ ) {
+    mrbc_value ret = mrbc_call_block( vm, &v[argc+1], 1, ringbuffer_at(rb, i) );
+    mrbc_release( &ret );
+    if( vm->flag_raised ) return;
+  }
+}
+
+
+//================================================================
+/*! (method) dup
+*/
+static void c_ringbuffer_dup(struct VM *vm, mrbc_value v[], int argc)
+{
+  mrbc_ringbuffer *rb = RINGBUFFER(v);
+
+  mrbc_value ret = mrbc_instance_new(vm, v->instance->cls, sizeof(mrbc_ringbuffer));
+  if( !ret.instance ) return;			// ENOMEM
+
+  mrbc_ringbuffer *rb2 = RINGBUFFER(&ret);
+  *rb2 = *rb;
+  rb2->head = 0;
+  rb2->data = mrbc_alloc(vm, sizeof(mrbc_value) * rb->capacity);
+  if( !rb2->data ) {				// ENOMEM
+    mrbc_release( &ret );
+    return;
+  }
+
+  int i;
+  for( i = 0; i < rb->n_stored; i++ ) {
+    rb2->data[i] = *ringbuffer_at(rb, i);
+    mrbc_dup( &rb2->data[i] );
+  }
+
+  SET_RETURN( ret );
+}
+
+
+//================================================================
+/*! initialize
+*/
+void mrbc_init_class_ringbuffer(struct VM *vm)
+{
+  mrbc_class_ringbuffer = mrbc_define_class(vm, "RingBuffer", mrbc_class_object);
+#if MRBC_USE_INSTANCE_POOL
+  mrbc_class_ringbuffer->data_size = sizeof(mrbc_ringbuffer);
+#endif
+
+  mrbc_define_method(vm, mrbc_class_ringbuffer, "new", c_ringbuffer_new);
+  mrbc_define_method(vm, mrbc_class_ringbuffer, "push", c_ringbuffer_push);
+  mrbc_define_method(vm, mrbc_class_ringbuffer, "<<", c_ringbuffer_push);
+  mrbc_define_method(vm, mrbc_class_ringbuffer, "unshift", c_ringbuffer_unshift);
+  mrbc_define_method(vm, mrbc_class_ringbuffer, "shift", c_ringbuffer_shift);
+  mrbc_define_method(vm, mrbc_class_ringbuffer, "pop", c_ringbuffer_pop);
+  mrbc_define_method(vm, mrbc_class_ringbuffer, "[]", c_ringbuffer_get);
+  mrbc_define_method(vm, mrbc_class_ringbuffer, "[]=", c_ringbuffer_set);
+  mrbc_define_method(vm, mrbc_class_ringbuffer, "first", c_ringbuffer_first);
+  mrbc_define_method(vm, mrbc_class_ringbuffer, "last", c_ringbuffer_last);
+  mrbc_define_method(vm, mrbc_class_ringbuffer, "size", c_ringbuffer_size);
+  mrbc_define_method(vm, mrbc_class_ringbuffer, "length", c_ringbuffer_size);
+  mrbc_define_method(vm, mrbc_class_ringbuffer, "capacity", c_ringbuffer_capacity);
+  mrbc_define_method(vm, mrbc_class_ringbuffer, "empty?", c_ringbuffer_empty);
+  mrbc_define_method(vm, mrbc_class_ringbuffer, "full?", c_ringbuffer_full);
+  mrbc_define_method(vm, mrbc_class_ringbuffer, "clear", c_ringbuffer_clear);
+  mrbc_define_method(vm, mrbc_class_ringbuffer, "to_a", c_ringbuffer_to_a);
+  mrbc_define_method(vm, mrbc_class_ringbuffer, "each", c_ringbuffer_each);
+  mrbc_define_method(vm, mrbc_class_ringbuffer, "dup", c_ringbuffer_dup);
+}
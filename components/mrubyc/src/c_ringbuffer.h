@@ -0,0 +1,46 @@
+/*! @file
+  @brief
+  mruby/c RingBuffer class
+
+  <pre>
+  Copyright (C) 2015-2020 Kyushu Institute of Technology.
+  Copyright (C) 2015-2020 Shimane IT Open-Innovation Center.
+
+  This file is distributed under BSD 3-Clause License.
+
+  </pre>
+*/
+
+#ifndef MRBC_SRC_C_RINGBUFFER_H_
+#define MRBC_SRC_C_RINGBUFFER_H_
+
+#include <stdint.h>
+#include "value.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+//================================================================
+/*!@brief
+  RingBuffer. (in the data area of mrbc_instance)
+*/
+typedef struct RRingBuffer {
+  uint16_t capacity;		//!< data buffer size.
+  uint16_t head;		//!< index of the first data.
+  uint16_t n_stored;		//!< # of stored.
+  uint8_t flag_overwrite;	//!< drop the data at the other end if full.
+  mrbc_value *data;		//!< pointer to allocated memory.
+
+} mrbc_ringbuffer;
+
+
+void mrbc_ringbuffer_instance_clear(mrbc_value *v);
+void mrbc_init_class_ringbuffer(struct VM *vm);
+
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -26,6 +26,7 @@
 #include "c_array.h"
 #include "c_string.h"
 #include "console.h"
+#include "objspace.h"
 
 
 #if MRBC_USE_STRING
@@ -76,6 +77,7 @@ mrbc_value mrbc_string_new(struct VM *vm, const void *src, int len)
   h->tt = MRBC_TT_STRING;	// TODO: for DEBUG
   h->size = len;
   h->data = str;
+  mrbc_objspace_new( MRBC_TT_STRING );
 
   /*
     Copy a source string.
@@ -128,6 +130,7 @@ mrbc_value mrbc_string_new_alloc(struct VM *vm, void *buf, int len)
   h->tt = MRBC_TT_STRING;	// TODO: for DEBUG
   h->size = len;
   h->data = buf;
+  mrbc_objspace_new( MRBC_TT_STRING );
 
   value.string = h;
   return value;
@@ -141,6 +144,7 @@ mrbc_value mrbc_string_new_alloc(struct VM *vm, void *buf, int len)
 */
 void mrbc_string_delete(mrbc_value *str)
 {
+  mrbc_objspace_delete( MRBC_TT_STRING );
   mrbc_raw_free(str->string->data);
   mrbc_raw_free(str->string);
 }
@@ -435,7 +439,7 @@ static void c_string_to_i(struct VM *vm, mrbc_value v[], int argc)
 */
 static void c_string_to_f(struct VM *vm, mrbc_value v[], int argc)
 {
-  mrbc_float d = atof(mrbc_string_cstr(v));
+  mrbc_float d = mrbc_atof(mrbc_string_cstr(v));
 
   SET_FLOAT_RETURN( d );
 }
@@ -865,7 +869,7 @@ static void c_object_sprintf(struct VM *vm, mrbc_value v[], int argc)
 	ret = mrbc_printf_int( &pf, (mrbc_int)v[i].d, 10);
 #endif
       } else if( v[i].tt == MRBC_TT_STRING ) {
-	mrbc_int ival = atol(mrbc_string_cstr(&v[i]));
+	mrbc_int ival = mrbc_atoi(mrbc_string_cstr(&v[i]), 10);
 	ret = mrbc_printf_int( &pf, ival, 10 );
       }
       break;
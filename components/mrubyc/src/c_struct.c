@@ -0,0 +1,590 @@
+/*! @file
+  @brief
+  mruby/c Struct class
+
+  <pre>
+  Copyright (C) 2015-2020 Kyushu Institute of Technology.
+  Copyright (C) 2015-2020 Shimane IT Open-Innovation Center.
+
+  This file is distributed under BSD 3-Clause License.
+
+  (usage)
+  Point = Struct.new(:x, :y)
+  pt = Point.new(1, 2)
+  pt.x += 10
+
+  The class made by Struct.new knows its members, and its instances
+  hold the values in a fixed slot array instead of instance variables.
+  The accessor methods are C functions which read or write the slot
+  of the fixed index, so no symbol lookup occurs at access time.
+
+  (restrictions)
+   - Struct.new can't take a block or keyword_init.
+   - A class made by Struct.new is never freed, like other classes.
+  </pre>
+*/
+
+#include "vm_config.h"
+#include <string.h>
+
+#include "value.h"
+#include "alloc.h"
+#include "static.h"
+#include "class.h"
+#include "symbol.h"
+#include "keyvalue.h"
+#include "console.h"
+#include "c_string.h"
+#include "c_array.h"
+#include "c_hash.h"
+#include "c_struct.h"
+
+
+#define STRUCT_SLOTS(v)	((mrbc_value *)((v)->instance->data))
+
+
+//================================================================
+/*! get the Struct.new made class of the class.
+
+  @param  cls	pointer to class.
+  @return	pointer to struct class, or NULL if not a struct.
+*/
+const mrbc_struct_class *mrbc_struct_class_of(const mrbc_class *cls)
+{
+  /*
+    The class made by Struct.new is the direct subclass of Struct,
+    and named "Struct" itself. (class Foo < Struct is not)
+  */
+  while( cls && cls != mrbc_class_struct ) {
+    if( cls->super == mrbc_class_struct ) {
+      if( cls->sym_id != mrbc_class_struct->sym_id ) break;
+      return (const mrbc_struct_class *)cls;
+    }
+    cls = cls->super;
+  }
+
+  return NULL;
+}
+
+
+//================================================================
+/*! get the struct class from receiver.
+*/
+static const mrbc_struct_class *struct_class(const mrbc_value *v)
+{
+  if( v->tt == MRBC_TT_OBJECT ) return mrbc_struct_class_of( v->instance->cls );
+  if( v->tt == MRBC_TT_CLASS ) return mrbc_struct_class_of( v->cls );
+  return NULL;
+}
+
+
+//================================================================
+/*! constructor
+
+  @param  vm	pointer to VM.
+  @param  scls	pointer to struct class.
+  @param  cls	class of the instance. scls or its subclass.
+  @return	new instance. all members are nil.
+*/
+mrbc_value mrbc_struct_instance_new(struct VM *vm, const mrbc_struct_class *scls, mrbc_class *cls)
+{
+  mrbc_value v = mrbc_instance_new(vm, cls,
+				   sizeof(mrbc_value) * scls->n_members);
+  if( v.instance == NULL ) return v;	// ENOMEM
+
+  mrbc_value *slot = STRUCT_SLOTS(&v);
+  int i;
+  for( i = 0; i < scls->n_members; i++ ) {
+    slot[i] = mrbc_nil_value();
+  }
+
+  return v;
+}
+
+
+//================================================================
+/*! release all members. (called from mrbc_instance_delete)
+
+  @param  v	pointer to instance.
+*/
+void mrbc_struct_instance_clear(mrbc_value *v)
+{
+  const mrbc_struct_class *scls = mrbc_struct_class_of( v->instance->cls );
+  if( !scls ) return;
+
+  mrbc_value *slot = STRUCT_SLOTS(v);
+  int i;
+  for( i = 0; i < scls->n_members; i++ ) {
+    mrbc_release( &slot[i] );
+  }
+}
+
+
+//================================================================
+/*! find member index by symbol or integer.
+
+  @return	index, or -1 if not found.
+*/
+static int struct_index(const mrbc_struct_class *scls, const mrbc_value *key)
+{
+  if( key->tt == MRBC_TT_FIXNUM ) {
+    int idx = key->i;
+    if( idx < 0 ) idx += scls->n_members;
+    if( idx < 0 || idx >= scls->n_members ) return -1;
+    return idx;
+  }
+
+  if( key->tt == MRBC_TT_SYMBOL ) {
+    int i;
+    for( i = 0; i < scls->n_members; i++ ) {
+      if( scls->members[i] == key->i ) return i;
+    }
+  }
+
+  return -1;
+}
+
+
+//================================================================
+/*! accessors for each slot index.
+*/
+static void struct_get(struct VM *vm, mrbc_value v[], int idx)
+{
+  mrbc_value ret = STRUCT_SLOTS(v)[idx];
+  mrbc_dup( &ret );
+  SET_RETURN( ret );
+}
+
+static void struct_set(struct VM *vm, mrbc_value v[], int argc, int idx)
+{
+  if( argc != 1 ) return;
+
+  mrbc_value *slot = &STRUCT_SLOTS(v)[idx];
+  mrbc_release( slot );
+  *slot = v[1];
+  v[1].tt = MRBC_TT_EMPTY;
+}
+
+#define STRUCT_ACCESSOR(n)						\
+  static void c_struct_get_##n(struct VM *vm, mrbc_value v[], int argc)	\
+  { struct_get( vm, v, n ); }						\
+  static void c_struct_set_##n(struct VM *vm, mrbc_value v[], int argc)	\
+  { struct_set( vm, v, argc, n ); }
+
+STRUCT_ACCESSOR(0)
+STRUCT_ACCESSOR(1)
+STRUCT_ACCESSOR(2)
+STRUCT_ACCESSOR(3)
+STRUCT_ACCESSOR(4)
+STRUCT_ACCESSOR(5)
+STRUCT_ACCESSOR(6)
+STRUCT_ACCESSOR(7)
+STRUCT_ACCESSOR(8)
+STRUCT_ACCESSOR(9)
+STRUCT_ACCESSOR(10)
+STRUCT_ACCESSOR(11)
+STRUCT_ACCESSOR(12)
+STRUCT_ACCESSOR(13)
+STRUCT_ACCESSOR(14)
+STRUCT_ACCESSOR(15)
+
+static const mrbc_func_t struct_getter[MRBC_STRUCT_MAX_MEMBERS] = {
+  c_struct_get_0,  c_struct_get_1,  c_struct_get_2,  c_struct_get_3,
+  c_struct_get_4,  c_struct_get_5,  c_struct_get_6,  c_struct_get_7,
+  c_struct_get_8,  c_struct_get_9,  c_struct_get_10, c_struct_get_11,
+  c_struct_get_12, c_struct_get_13, c_struct_get_14, c_struct_get_15,
+};
+static const mrbc_func_t struct_setter[MRBC_STRUCT_MAX_MEMBERS] = {
+  c_struct_set_0,  c_struct_set_1,  c_struct_set_2,  c_struct_set_3,
+  c_struct_set_4,  c_struct_set_5,  c_struct_set_6,  c_struct_set_7,
+  c_struct_set_8,  c_struct_set_9,  c_struct_set_10, c_struct_set_11,
+  c_struct_set_12, c_struct_set_13, c_struct_set_14, c_struct_set_15,
+};
+
+
+//================================================================
+/*! make setter method name "xxx=".
+    symbol table holds the pointer, so the new name is never freed.
+
+  @param  sym_id	member name.
+  @return		setter name, or NULL if ENOMEM.
+*/
+static const char *setter_name(mrbc_sym sym_id)
+{
+  const char *name = symid_to_str( sym_id );
+  int len = strlen( name );
+  char buf[len + 2];
+
+  memcpy( buf, name, len );
+  buf[len] = '=';
+  buf[len+1] = '\0';
+
+  mrbc_sym setter_id = mrbc_search_symid( buf );
+  if( setter_id >= 0 ) return symid_to_str( setter_id );
+
+  char *p = mrbc_raw_alloc_no_free( len + 2 );
+  if( p ) memcpy( p, buf, len + 2 );
+
+  return p;
+}
+
+
+//================================================================
+/*! make a new struct class.
+*/
+static void struct_define(struct VM *vm, mrbc_value v[], int argc)
+{
+  if( argc > MRBC_STRUCT_MAX_MEMBERS ) {
+    console_printf("ArgumentError: too many struct members (max %d)\n",
+		   MRBC_STRUCT_MAX_MEMBERS);
+    goto RETURN_NIL;
+  }
+
+  int i, j;
+  for( i = 1; i <= argc; i++ ) {
+    if( v[i].tt != MRBC_TT_SYMBOL ) {
+      console_printf("TypeError: struct member is not a symbol\n");
+      goto RETURN_NIL;
+    }
+    for( j = 1; j < i; j++ ) {
+      if( v[j].i == v[i].i ) {
+	console_printf("ArgumentError: duplicate member: %s\n",
+		       symid_to_str(v[i].i));
+	goto RETURN_NIL;
+      }
+    }
+  }
+
+  mrbc_struct_class *scls = mrbc_raw_alloc_no_free( sizeof(mrbc_struct_class) +
+						    sizeof(mrbc_sym) * argc );
+  if( !scls ) goto RETURN_NIL;		// ENOMEM
+
+  scls->cls.sym_id = mrbc_class_struct->sym_id;
+#ifdef MRBC_DEBUG
+  scls->cls.names = "Struct";	// for debug; delete soon.
+#endif
+  scls->cls.super = mrbc_class_struct;
+  scls->cls.procs = 0;
+#if MRBC_USE_OBJSPACE
+  scls->cls.n_live = 0;
+  scls->cls.n_watch = 0;
+#endif
+#if MRBC_USE_INSTANCE_POOL
+  scls->cls.data_size = sizeof(mrbc_value) * argc;
+#endif
+  scls->n_members = argc;
+
+  for( i = 0; i < argc; i++ ) {
+    mrbc_sym sym_id = v[i+1].i;
+    const char *name = setter_name( sym_id );
+    if( !name ) goto RETURN_NIL;	// ENOMEM
+
+    scls->members[i] = sym_id;
+    mrbc_define_method( vm, &scls->cls, symid_to_str(sym_id), struct_getter[i] );
+    mrbc_define_method( vm, &scls->cls, name, struct_setter[i] );
+  }
+
+  mrbc_value ret = {.tt = MRBC_TT_CLASS};
+  ret.cls = &scls->cls;
+  SET_RETURN( ret );
+  return;
+
+ RETURN_NIL:
+  SET_NIL_RETURN();
+}
+
+
+//================================================================
+/*! (class method) new
+
+  Struct.new(:a, :b)	-> new class.
+  XXX.new(1, 2)		-> new instance of XXX.
+*/
+static void c_struct_new(struct VM *vm, mrbc_value v[], int argc)
+{
+  if( v[0].tt == MRBC_TT_CLASS && v[0].cls == mrbc_class_struct ) {
+    struct_define( vm, v, argc );
+    return;
+  }
+
+  const mrbc_struct_class *scls = struct_class( &v[0] );
+  if( !scls ) {
+    console_printf("TypeError: not a struct class\n");
+    SET_NIL_RETURN();
+    return;
+  }
+
+  mrbc_value new_obj = mrbc_struct_instance_new( vm, scls, v[0].cls );
+  if( new_obj.instance == NULL ) {	// ENOMEM
+    SET_NIL_RETURN();
+    return;
+  }
+
+  mrbc_instance_initialize( vm, v, argc, new_obj );
+}
+
+
+//================================================================
+/*! (method) initialize
+*/
+static void c_struct_initialize(struct VM *vm, mrbc_value v[], int argc)
+{
+  const mrbc_struct_class *scls = struct_class( &v[0] );
+  if( !scls ) return;
+
+  if( argc > scls->n_members ) {
+    console_printf("ArgumentError: struct size differs\n");
+    return;
+  }
+
+  mrbc_value *slot = STRUCT_SLOTS(v);
+  int i;
+  for( i = 0; i < argc; i++ ) {
+    mrbc_release( &slot[i] );
+    slot[i] = v[i+1];
+    mrbc_dup( &slot[i] );
+  }
+}
+
+
+//================================================================
+/*! (method) members
+*/
+static void c_struct_members(struct VM *vm, mrbc_value v[], int argc)
+{
+  const mrbc_struct_class *scls = struct_class( &v[0] );
+  if( !scls ) {
+    SET_NIL_RETURN();
+    return;
+  }
+
+  mrbc_value ret = mrbc_array_new( vm, scls->n_members );
+  if( !ret.array ) {			// ENOMEM
+    SET_NIL_RETURN();
+    return;
+  }
+
+  int i;
+  for( i = 0; i < scls->n_members; i++ ) {
+    mrbc_value sym = {.tt = MRBC_TT_SYMBOL};
+    sym.i = scls->members[i];
+    mrbc_array_push( &ret, &sym );
+  }
+
+  SET_RETURN( ret );
+}
+
+
+//================================================================
+/*! (method) to_a
+*/
+static void c_struct_to_a(struct VM *vm, mrbc_value v[], int argc)
+{
+  const mrbc_struct_class *scls = struct_class( &v[0] );
+  if( !scls || v[0].tt != MRBC_TT_OBJECT ) {
+    SET_NIL_RETURN();
+    return;
+  }
+
+  mrbc_value ret = mrbc_array_new( vm, scls->n_members );
+  if( !ret.array ) {			// ENOMEM
+    SET_NIL_RETURN();
+    return;
+  }
+
+  mrbc_value *slot = STRUCT_SLOTS(v);
+  int i;
+  for( i = 0; i < scls->n_members; i++ ) {
+    mrbc_dup( &slot[i] );
+    mrbc_array_push( &ret, &slot[i] );
+  }
+
+  SET_RETURN( ret );
+}
+
+
+//================================================================
+/*! (method) to_h
+*/
+static void c_struct_to_h(struct VM *vm, mrbc_value v[], int argc)
+{
+  const mrbc_struct_class *scls = struct_class( &v[0] );
+  if( !scls || v[0].tt != MRBC_TT_OBJECT ) {
+    SET_NIL_RETURN();
+    return;
+  }
+
+  mrbc_value ret = mrbc_hash_new( vm, scls->n_members );
+  if( !ret.hash ) {			// ENOMEM
+    SET_NIL_RETURN();
+    return;
+  }
+
+  mrbc_value *slot = STRUCT_SLOTS(v);
+  int i;
+  for( i = 0; i < scls->n_members; i++ ) {
+    mrbc_value key = {.tt = MRBC_TT_SYMBOL};
+    key.i = scls->members[i];
+    mrbc_dup( &slot[i] );
+    mrbc_hash_set( &ret, &key, &slot[i] );
+  }
+
+  SET_RETURN( ret );
+}
+
+
+//================================================================
+/*! (method) size
+*/
+static void c_struct_size(struct VM *vm, mrbc_value v[], int argc)
+{
+  const mrbc_struct_class *scls = struct_class( &v[0] );
+  SET_INT_RETURN( scls ? scls->n_members : 0 );
+}
+
+
+//================================================================
+/*! (method) []
+*/
+static void c_struct_get(struct VM *vm, mrbc_value v[], int argc)
+{
+  const mrbc_struct_class *scls = struct_class( &v[0] );
+  int idx;
+  if( !scls || v[0].tt != MRBC_TT_OBJECT || argc != 1 ||
+      (idx = struct_index( scls, &v[1] )) < 0 ) {
+    console_printf("IndexError: no member in struct\n");
+    SET_NIL_RETURN();
+    return;
+  }
+
+  struct_get( vm, v, idx );
+}
+
+
+//================================================================
+/*! (method) []=
+*/
+static void c_struct_set(struct VM *vm, mrbc_value v[], int argc)
+{
+  const mrbc_struct_class *scls = struct_class( &v[0] );
+  int idx;
+  if( !scls || v[0].tt != MRBC_TT_OBJECT || argc != 2 ||
+      (idx = struct_index( scls, &v[1] )) < 0 ) {
+    console_printf("IndexError: no member in struct\n");
+    return;
+  }
+
+  mrbc_value *slot = &STRUCT_SLOTS(v)[idx];
+  mrbc_release( slot );
+  *slot = v[2];
+  v[2].tt = MRBC_TT_EMPTY;
+}
+
+
+//================================================================
+/*! (operator) ==
+*/
+static void c_struct_equal(struct VM *vm, mrbc_value v[], int argc)
+{
+  const mrbc_struct_class *scls = struct_class( &v[0] );
+  int result = 0;
+
+  if( scls && v[0].tt == MRBC_TT_OBJECT && v[1].tt == MRBC_TT_OBJECT &&
+      v[0].instance->cls == v[1].instance->cls ) {
+    mrbc_value *slot0 = STRUCT_SLOTS(&v[0]);
+    mrbc_value *slot1 = STRUCT_SLOTS(&v[1]);
+    int i;
+    for( i = 0; i < scls->n_members; i++ ) {
+      if( mrbc_compare( &slot0[i], &slot1[i] ) != 0 ) break;
+    }
+    result = (i == scls->n_members);
+  }
+
+  SET_BOOL_RETURN( result );
+}
+
+
+//================================================================
+/*! (method) dup
+*/
+static void c_struct_dup(struct VM *vm, mrbc_value v[], int argc)
+{
+  const mrbc_struct_class *scls = struct_class( &v[0] );
+  if( !scls || v[0].tt != MRBC_TT_OBJECT ) return;
+
+  mrbc_value new_obj = mrbc_struct_instance_new( vm, scls, v[0].instance->cls );
+  if( new_obj.instance == NULL ) return;	// ENOMEM
+
+  mrbc_kv_dup( &v[0].instance->ivar, &new_obj.instance->ivar );
+
+  mrbc_value *src = STRUCT_SLOTS(&v[0]);
+  mrbc_value *dst = STRUCT_SLOTS(&new_obj);
+  int i;
+  for( i = 0; i < scls->n_members; i++ ) {
+    dst[i] = src[i];
+    mrbc_dup( &dst[i] );
+  }
+
+  SET_RETURN( new_obj );
+}
+
+
+#if MRBC_USE_STRING
+//================================================================
+/*! (method) inspect, to_s
+*/
+static void c_struct_inspect(struct VM *vm, mrbc_value v[], int argc)
+{
+  const mrbc_struct_class *scls = struct_class( &v[0] );
+  if( !scls || v[0].tt != MRBC_TT_OBJECT ) goto RETURN_NIL;
+
+  mrbc_value ret = mrbc_string_new_cstr(vm, "#<struct ");
+  if( !ret.string ) goto RETURN_NIL;		// ENOMEM
+
+  mrbc_value *slot = STRUCT_SLOTS(v);
+  int i;
+  for( i = 0; i < scls->n_members; i++ ) {
+    if( i != 0 ) mrbc_string_append_cstr( &ret, ", " );
+    mrbc_string_append_cstr( &ret, symid_to_str(scls->members[i]) );
+    mrbc_string_append_cstr( &ret, "=" );
+
+    mrbc_value s1 = mrbc_send( vm, v, argc, &slot[i], "inspect", 0 );
+    mrbc_string_append( &ret, &s1 );
+    mrbc_string_delete( &s1 );
+  }
+
+  mrbc_string_append_cstr( &ret, ">" );
+
+  SET_RETURN(ret);
+  return;
+
+ RETURN_NIL:
+  SET_NIL_RETURN();
+}
+#endif
+
+
+//================================================================
+/*! initialize
+*/
+void mrbc_init_class_struct(struct VM *vm)
+{
+  mrbc_class_struct = mrbc_define_class(vm, "Struct", mrbc_class_object);
+
+  mrbc_define_method(vm, mrbc_class_struct, "new", c_struct_new);
+  mrbc_define_method(vm, mrbc_class_struct, "initialize", c_struct_initialize);
+  mrbc_define_method(vm, mrbc_class_struct, "members", c_struct_members);
+  mrbc_define_method(vm, mrbc_class_struct, "to_a", c_struct_to_a);
+  mrbc_define_method(vm, mrbc_class_struct, "values", c_struct_to_a);
+  mrbc_define_method(vm, mrbc_class_struct, "to_h", c_struct_to_h);
+  mrbc_define_method(vm, mrbc_class_struct, "size", c_struct_size);
+  mrbc_define_method(vm, mrbc_class_struct, "length", c_struct_size);
+  mrbc_define_method(vm, mrbc_class_struct, "[]", c_struct_get);
+  mrbc_define_method(vm, mrbc_class_struct, "[]=", c_struct_set);
+  mrbc_define_method(vm, mrbc_class_struct, "==", c_struct_equal);
+  mrbc_define_method(vm, mrbc_class_struct, "dup", c_struct_dup);
+#if MRBC_USE_STRING
+  mrbc_define_method(vm, mrbc_class_struct, "inspect", c_struct_inspect);
+  mrbc_define_method(vm, mrbc_class_struct, "to_s", c_struct_inspect);
+#endif
+}
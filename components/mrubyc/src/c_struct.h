@@ -0,0 +1,55 @@
+/*! @file
+  @brief
+  mruby/c Struct class
+
+  <pre>
+  Copyright (C) 2015-2020 Kyushu Institute of Technology.
+  Copyright (C) 2015-2020 Shimane IT Open-Innovation Center.
+
+  This file is distributed under BSD 3-Clause License.
+
+  </pre>
+*/
+
+#ifndef MRBC_SRC_C_STRUCT_H_
+#define MRBC_SRC_C_STRUCT_H_
+
+#include <stdint.h>
+#include "value.h"
+#include "class.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//! max number of members. (accessor functions are made for each slot)
+#define MRBC_STRUCT_MAX_MEMBERS 16
+
+
+//================================================================
+/*!@brief
+  Class made by Struct.new
+
+  <pre>
+  The members are held in the data area of the instance (mrbc_instance),
+  as the array of mrbc_value in the order of members.
+  </pre>
+*/
+typedef struct RStructClass {
+  mrbc_class cls;
+  uint8_t n_members;
+  mrbc_sym members[];
+
+} mrbc_struct_class;
+
+
+const mrbc_struct_class *mrbc_struct_class_of(const mrbc_class *cls);
+mrbc_value mrbc_struct_instance_new(struct VM *vm, const mrbc_struct_class *scls, mrbc_class *cls);
+void mrbc_struct_instance_clear(mrbc_value *v);
+void mrbc_init_class_struct(struct VM *vm);
+
+
+#ifdef __cplusplus
+}
+#endif
+#endif
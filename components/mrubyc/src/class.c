@@ -28,6 +28,8 @@
 #include "opcode.h"
 #include "load.h"
 #include "error.h"
+#include "hotswap.h"
+#include "pool.h"
 
 #include "c_array.h"
 #include "c_hash.h"
@@ -35,8 +37,19 @@
 #include "c_math.h"
 #include "c_string.h"
 #include "c_range.h"
+#include "c_struct.h"
+#include "c_ringbuffer.h"
+#include "c_log.h"
+#include "profiler.h"
+#include "c_benchmark.h"
+#include "metrics.h"
+#include "objspace.h"
+#include "c_fixed.h"
 
 
+// counts up when a method is defined. the method handles resolve again.
+uint32_t mrbc_method_generation;
+
 
 //================================================================
 /*! Check the class is the class of object.
@@ -68,6 +81,14 @@ int mrbc_obj_is_kind_of( const mrbc_value *obj, const mrb_class *cls )
 mrbc_value mrbc_instance_new(struct VM *vm, mrbc_class *cls, int size)
 {
   mrbc_value v = {.tt = MRBC_TT_OBJECT};
+#if MRBC_USE_INSTANCE_POOL
+  v.instance = mrbc_instance_pool_get(vm, cls, size);
+  if( v.instance ) {
+    mrbc_objspace_new_instance( cls );
+    return v;
+  }
+#endif
+
   v.instance = (mrbc_instance *)mrbc_alloc(vm, sizeof(mrbc_instance) + size);
   if( v.instance == NULL ) return v;	// ENOMEM
 
@@ -80,6 +101,10 @@ mrbc_value mrbc_instance_new(struct VM *vm, mrbc_class *cls, int size)
   v.instance->ref_count = 1;
   v.instance->tt = MRBC_TT_OBJECT;	// for debug only.
   v.instance->cls = cls;
+#if MRBC_USE_INSTANCE_POOL
+  v.instance->data_size = size;
+#endif
+  mrbc_objspace_new_instance( cls );
 
   return v;
 }
@@ -93,6 +118,16 @@ mrbc_value mrbc_instance_new(struct VM *vm, mrbc_class *cls, int size)
 */
 void mrbc_instance_delete(mrbc_value *v)
 {
+  mrbc_objspace_delete_instance( v->instance->cls );
+#if MRBC_USE_STRUCT
+  mrbc_struct_instance_clear( v );
+#endif
+#if MRBC_USE_RINGBUFFER
+  mrbc_ringbuffer_instance_clear( v );
+#endif
+#if MRBC_USE_INSTANCE_POOL
+  if( mrbc_instance_pool_put( v->instance ) == 0 ) return;
+#endif
   mrbc_kv_delete_data( &v->instance->ivar );
   mrbc_raw_free( v->instance );
 }
@@ -149,6 +184,7 @@ mrbc_class *find_class_by_object(struct VM *vm, const mrbc_object *obj)
   case MRBC_TT_NIL:	cls = mrbc_class_nil;		break;
   case MRBC_TT_FIXNUM:	cls = mrbc_class_fixnum;	break;
   case MRBC_TT_FLOAT:	cls = mrbc_class_float; 	break;
+  case MRBC_TT_FIXED:	cls = mrbc_class_fixed; 	break;
   case MRBC_TT_SYMBOL:	cls = mrbc_class_symbol;	break;
 
   case MRBC_TT_OBJECT:	cls = obj->instance->cls;       break;
@@ -234,6 +270,13 @@ mrbc_class * mrbc_define_class(struct VM *vm, const char *name, mrbc_class *supe
 #endif
     cls->super = (super == NULL) ? mrbc_class_object : super;
     cls->procs = 0;
+#if MRBC_USE_OBJSPACE
+    cls->n_live = 0;
+    cls->n_watch = 0;
+#endif
+#if MRBC_USE_INSTANCE_POOL
+    cls->data_size = 0;
+#endif
 
     // register to global constant.
     mrbc_set_const( sym_id, &(mrb_value){.tt = MRBC_TT_CLASS, .cls = cls} );
@@ -291,6 +334,7 @@ void mrbc_define_method(struct VM *vm, mrbc_class *cls, const char *name, mrbc_f
   proc->func = cfunc;
 
   cls->procs = proc;
+  mrbc_method_generation++;
 }
 
 
@@ -330,6 +374,87 @@ void mrbc_funcall(struct VM *vm, const char *name, mrbc_value *v, int argc)
 
 
 
+//================================================================
+/*! run the Ruby method (or block) synchronously.
+
+  @param  vm		pointer to vm.
+  @param  regs		regs[0]: receiver, regs[1..argc]: params, regs[argc+1]: block.
+  @param  irep		method body.
+  @param  sym_id	method name.
+  @param  cls		class which owns the method.
+  @param  argc		num of params.
+  @note   return value is set to regs[0], and params are released.
+	  If an exception is not rescued, regs[0] is nil and vm->exc remains,
+	  the running VM unwinds it after the current instruction.
+*/
+static void run_method( struct VM *vm, mrbc_value *regs, mrbc_irep *irep,
+			mrbc_sym sym_id, mrbc_class *cls, int argc )
+{
+  mrbc_irep *pc_irep = vm->pc_irep;
+  uint8_t *inst = vm->inst;
+  mrbc_value *current_regs = vm->current_regs;
+  mrbc_class *target_class = vm->target_class;
+  mrbc_callinfo *callinfo_tail = vm->callinfo_tail;
+
+  // OP_RETURN of the method returns to mrbc_nested_stop_code, and exit mrbc_vm_run.
+  vm->inst = mrbc_nested_stop_code;
+  mrbc_callinfo *callinfo = mrbc_push_callinfo(vm, sym_id, 0, argc);
+  if( !callinfo ) {	// ENOMEM
+    vm->inst = inst;
+    return;
+  }
+  callinfo->own_class = cls;
+
+  vm->pc_irep = irep;
+  vm->inst = irep->code;
+  vm->current_regs = regs;
+
+  // preemption does not stop the nested call.
+  do {
+    mrbc_vm_run( vm );
+  } while( vm->callinfo_tail != callinfo_tail );
+
+  vm->pc_irep = pc_irep;
+  vm->inst = inst;
+  vm->current_regs = current_regs;
+  vm->target_class = target_class;
+
+  // not rescued. the caller unwinds after the current instruction.
+  if( vm->flag_raised ) {
+    int i;
+    for( i = 0; i < irep->nregs || i <= argc + 1; i++ ) {
+      mrbc_release( &regs[i] );
+    }
+    regs[0] = mrbc_nil_value();
+    vm->flag_preemption = 1;
+  }
+}
+
+
+//================================================================
+/*! get free registers above the current frame.
+
+  @param  vm		pointer to vm.
+  @param  size		num of registers.
+  @return		pointer to regs, or NULL if overflow.
+*/
+static mrbc_value * call_frame( struct VM *vm, int size )
+{
+  mrbc_value *regs = vm->regs;
+
+  // +1 is block register of OP_SEND.
+  if( vm->pc_irep && vm->current_regs ) {
+    regs = vm->current_regs + vm->pc_irep->nregs + 1;
+  }
+  if( regs + size > vm->regs + MAX_REGS_SIZE ) {
+    console_printf("Error: Register overflow in nested call.\n");
+    return NULL;
+  }
+
+  return regs;
+}
+
+
 //================================================================
 /*! (BETA) Call any method of the object, but written by C.
 
@@ -354,16 +479,13 @@ mrbc_value mrbc_send( struct VM *vm, mrbc_value *v, int reg_ofs,
 		     mrbc_value *recv, const char *method, int argc, ... )
 {
   mrbc_sym sym_id = str_to_symid(method);
-  mrbc_proc *m = find_method(vm, recv, sym_id);
+  mrbc_class *cls = find_class_by_object(vm, recv);
+  mrbc_proc *m = find_method_by_class(&cls, cls, sym_id);
 
   if( m == 0 ) {
     console_printf("No method. vtype=%d method='%s'\n", recv->tt, method );
     goto ERROR;
   }
-  if( !m->c_func ) {
-    console_printf("Method %s is not C function\n", method );
-    goto ERROR;
-  }
 
   // create call stack.
   mrbc_value *regs = v + reg_ofs + 2;
@@ -383,7 +505,15 @@ mrbc_value mrbc_send( struct VM *vm, mrbc_value *v, int reg_ofs,
   va_end(ap);
 
   // call method.
-  m->func(vm, regs, argc);
+  if( m->c_func ) {
+    m->func(vm, regs, argc);
+  } else {
+    int j;
+    for( j = 1; j <= argc; j++ ) {
+      mrbc_dup( &regs[j] );	// released by OP_RETURN.
+    }
+    run_method( vm, regs, m->irep, sym_id, cls, argc );
+  }
   mrbc_value ret = regs[0];
 
   for(; i >= 0; i-- ) {
@@ -397,6 +527,193 @@ mrbc_value mrbc_send( struct VM *vm, mrbc_value *v, int reg_ofs,
 }
 
 
+//================================================================
+/*! find the method of the handle.
+*/
+static int method_handle_resolve( mrbc_method_handle *h )
+{
+  h->cls = h->base;
+  h->method = find_method_by_class(&h->cls, h->base, h->sym_id);
+  h->generation = mrbc_method_generation;
+
+  return h->method ? 0 : -1;
+}
+
+
+//================================================================
+/*! resolve the method for mrbc_call()
+
+  The handle resolves the method again when any method is redefined.
+
+  @param  h		pointer to handle.
+  @param  cls		class of the receiver.
+  @param  method	method name.
+  @return int		zero if no error.
+*/
+int mrbc_method_handle_init( mrbc_method_handle *h, mrbc_class *cls, const char *method )
+{
+  if( cls == NULL ) cls = mrbc_class_object;	// set default to Object.
+
+  h->sym_id = str_to_symid(method);
+  h->base = cls;
+  if( method_handle_resolve( h ) != 0 ) {
+    console_printf("No method. class=%s method='%s'\n",
+		   symid_to_str(cls->sym_id), method );
+    return -1;
+  }
+
+  return 0;
+}
+
+
+//================================================================
+/*! finish the call from outside of the running VM.
+
+  No one unwinds the exception, so report it as in the top level,
+  and restore the flags for the next run of the task.
+*/
+static void end_outer_call( struct VM *vm, int8_t flag_preemption )
+{
+  if( vm->flag_raised ) {
+    if( vm->exc ) {
+      console_printf("Exception: %s\n", symid_to_str( vm->exc->sym_id ));
+    }
+    vm->flag_raised = 0;
+    vm->exc = 0;
+    mrbc_release( &vm->exc_message );
+    vm->exc_message = mrbc_nil_value();
+  }
+  vm->flag_preemption = flag_preemption;
+}
+
+
+//================================================================
+/*! set the receiver (or proc) and params to regs.
+*/
+static void set_call_params( mrbc_value *regs, const mrbc_value *recv,
+			     int argc, const mrbc_value argv[] )
+{
+  mrbc_release( &regs[0] );
+  regs[0] = *recv;
+  mrbc_dup( &regs[0] );
+
+  int i;
+  for( i = 0; i < argc; i++ ) {
+    mrbc_release( &regs[i+1] );
+    regs[i+1] = argv[i];
+    mrbc_dup( &regs[i+1] );
+  }
+  mrbc_release( &regs[argc+1] );
+  regs[argc+1] = mrbc_nil_value();
+}
+
+
+//================================================================
+/*! call the method synchronously.
+
+  Ruby method runs in nested mrbc_vm_run() until it returns, so it
+  can be used in C methods and callbacks of the drivers.
+  The method must not switch the task (sleep, pass, etc.) and
+  the blocks given by it must not break out.
+  Called from outside of the running VM, the exception which is not
+  rescued is reported and cleared here.
+
+  @param  vm		pointer to vm. (running task)
+  @param  h		method handle. see mrbc_method_handle_init()
+  @param  recv		pointer to receiver.
+  @param  argc		num of params.
+  @param  argv		params.
+  @return		return value of the method.
+
+  @example
+  static mrbc_method_handle on_recv;
+  mrbc_method_handle_init( &on_recv, mrbc_get_class_by_name("Uart"), "on_recv" );
+  ...
+  mrbc_value data = mrbc_fixnum_value(ch);
+  mrbc_value ret = mrbc_call( vm, &on_recv, &uart, 1, &data );
+  mrbc_release( &ret );
+*/
+mrbc_value mrbc_call( struct VM *vm, mrbc_method_handle *h,
+		      const mrbc_value *recv, int argc, const mrbc_value argv[] )
+{
+  if( h->generation != mrbc_method_generation || !h->method ) {
+    if( method_handle_resolve( h ) != 0 ) {
+      console_printf("No method. class=%s method='%s'\n",
+		     symid_to_str(h->base->sym_id), symid_to_str(h->sym_id) );
+      return mrbc_nil_value();
+    }
+  }
+
+  mrbc_proc *m = h->method;
+  if( m->c_func && m->func == c_proc_call ) {
+    return mrbc_call_block( vm, recv, argc, argv );
+  }
+
+  int size = argc + 2;
+  if( !m->c_func && m->irep->nregs + 1 > size ) size = m->irep->nregs + 1;
+  mrbc_value *regs = call_frame( vm, size );
+  if( !regs ) return mrbc_nil_value();
+
+  set_call_params( regs, recv, argc, argv );
+  int8_t flag_preemption = vm->flag_preemption;
+
+  if( m->c_func ) {
+    m->func(vm, regs, argc);
+
+    int i;
+    for( i = 1; i <= argc + 1; i++ ) {
+      mrbc_release( &regs[i] );
+    }
+  } else {
+    run_method( vm, regs, m->irep, h->sym_id, h->cls, argc );
+  }
+  if( vm->run_nest == 0 ) end_outer_call( vm, flag_preemption );
+
+  mrbc_value ret = regs[0];
+  regs[0].tt = MRBC_TT_EMPTY;
+  return ret;
+}
+
+
+//================================================================
+/*! call the block (Proc object) synchronously.
+
+  @param  vm		pointer to vm. (running task)
+  @param  proc		pointer to Proc object.
+  @param  argc		num of params.
+  @param  argv		params.
+  @return		return value of the block.
+  @see    mrbc_call()
+*/
+mrbc_value mrbc_call_block( struct VM *vm, const mrbc_value *proc,
+			    int argc, const mrbc_value argv[] )
+{
+  if( proc->tt != MRBC_TT_PROC || proc->proc->c_func ) {
+    console_printf("Error: Not a block.\n");
+    return mrbc_nil_value();
+  }
+
+  mrbc_irep *irep = proc->proc->irep;
+  int size = argc + 2;
+  if( irep->nregs + 1 > size ) size = irep->nregs + 1;
+  mrbc_value *regs = call_frame( vm, size );
+  if( !regs ) return mrbc_nil_value();
+
+  set_call_params( regs, proc, argc, argv );
+  int8_t flag_preemption = vm->flag_preemption;
+
+  mrbc_callinfo *callinfo_self = proc->proc->callinfo_self;
+  run_method( vm, regs, irep,
+	      callinfo_self ? callinfo_self->method_id : 0,
+	      callinfo_self ? callinfo_self->own_class : 0, argc );
+  if( vm->run_nest == 0 ) end_outer_call( vm, flag_preemption );
+
+  mrbc_value ret = regs[0];
+  regs[0].tt = MRBC_TT_EMPTY;
+  return ret;
+}
+
+
 
 //================================================================
 /*! p - sub function
@@ -472,6 +789,12 @@ int mrbc_print_sub(const mrbc_value *v)
   case MRBC_TT_FIXNUM:	console_printf("%D", v->i);	break;
 #if MRBC_USE_FLOAT
   case MRBC_TT_FLOAT:	console_printf("%g", v->d);	break;
+#endif
+#if MRBC_USE_FIXED
+  case MRBC_TT_FIXED: {
+    char buf[16];
+    console_print( mrbc_fixed_to_cstr( v->fx, buf ) );
+  } break;
 #endif
   case MRBC_TT_SYMBOL:
     console_print(mrbc_symbol_cstr(v));
@@ -667,58 +990,35 @@ static void c_object_class(struct VM *vm, mrbc_value v[], int argc)
 
 
 //================================================================
-/*! (method) new
- */
-static void c_object_new(struct VM *vm, mrbc_value v[], int argc)
-{
-  mrbc_value new_obj = mrbc_instance_new(vm, v->cls, 0);
+/*! call initialize method of the new instance and return it.
+    (common part of Object.new and Struct.new)
 
-  char syms[]="______initialize";
-  mrbc_sym sym_id = str_to_symid(&syms[6]);
-  mrbc_proc *m = find_method(vm, &v[0], sym_id);
+  @param  vm		pointer to vm.
+  @param  v		receiver (class) and params.
+  @param  argc		num of params.
+  @param  new_obj	new instance.
+*/
+void mrbc_instance_initialize(struct VM *vm, mrbc_value v[], int argc, mrbc_value new_obj)
+{
+  mrbc_sym sym_id = str_to_symid("initialize");
+  mrbc_class *cls = v->cls;
+  mrbc_class *own_class;
+  mrbc_proc *m = find_method_by_class(&own_class, cls, sym_id);
   if( m==0 ){
     SET_RETURN(new_obj);
     return;
   }
-  uint32_to_bin( 1,(uint8_t*)&syms[0]);
-  uint16_to_bin(10,(uint8_t*)&syms[4]);
-
-  uint8_t code[] = {
-    OP_SEND, 0, 0, argc,
-    OP_ABORT,
-  };
-  mrbc_irep irep = {
-    0,     // nlocals
-    0,     // nregs
-    0,     // rlen
-    sizeof(code)/sizeof(uint8_t),     // ilen
-    0,     // plen
-    (uint8_t *)code,   // code
-    NULL,  // pools
-    (uint8_t *)syms,  // ptr_to_sym
-    NULL,  // reps
-  };
-
-  mrbc_class *cls = v->cls;
 
   mrbc_release(&v[0]);
   v[0] = new_obj;
   mrbc_dup(&new_obj);
 
-  mrbc_irep *org_pc_irep = vm->pc_irep;
-  mrbc_value* org_regs = vm->current_regs;
-  uint8_t *org_inst = vm->inst;
-
-  vm->pc_irep = &irep;
-  vm->current_regs = v;
-  vm->inst = irep.code;
-
-  while( mrbc_vm_run(vm) == 0 )
-    ;
-
-  vm->pc_irep = org_pc_irep;
-  vm->inst = org_inst;
-  vm->current_regs = org_regs;
+  if( m->c_func ) {
+    m->func(vm, v, argc);
+  } else {
+    run_method(vm, v, m->irep, sym_id, own_class, argc);
+  }
+  mrbc_release(&v[0]);
 
   new_obj.instance->cls = cls;
 
@@ -728,6 +1028,15 @@ static void c_object_new(struct VM *vm, mrbc_value v[], int argc)
 }
 
 
+//================================================================
+/*! (method) new
+ */
+static void c_object_new(struct VM *vm, mrbc_value v[], int argc)
+{
+  mrbc_instance_initialize( vm, v, argc, mrbc_instance_new(vm, v->cls, 0) );
+}
+
+
 //================================================================
 /*! (method) dup
  */
@@ -820,6 +1129,33 @@ static void c_object_attr_accessor(struct VM *vm, mrbc_value v[], int argc)
 }
 
 
+#if MRBC_USE_INSTANCE_POOL
+//================================================================
+/*! (class method) instance_pool
+
+  instance_pool(max)	recycle up to max freed instances. 0 to stop.
+ */
+static void c_object_instance_pool(struct VM *vm, mrbc_value v[], int argc)
+{
+  if( v[0].tt != MRBC_TT_CLASS || argc != 1 || v[1].tt != MRBC_TT_FIXNUM ) {
+    console_printf("ArgumentError: instance_pool(max)\n");
+    return;
+  }
+
+  // the classes backed by C data tell the size, and the subclasses inherit.
+  int data_size = 0;
+  const mrbc_class *cls;
+  for( cls = v[0].cls; cls && !data_size; cls = cls->super ) {
+    data_size = cls->data_size;
+  }
+
+  if( mrbc_define_instance_pool( v[0].cls, v[1].i, data_size ) != 0 ) {
+    console_printf("Can't make instance pool.\n");
+  }
+}
+#endif
+
+
 //================================================================
 /*! (method) is_a, kind_of
  */
@@ -881,6 +1217,7 @@ static void c_object_raise(struct VM *vm, mrbc_value v[], int argc)
 {
   if( !vm->exc ){
     // raise exception
+    mrbc_release( &vm->exc_message );
     if( argc == 0 ){
       // 1. raise
       vm->exc = mrbc_class_runtimeerror;
@@ -907,48 +1244,8 @@ static void c_object_raise(struct VM *vm, mrbc_value v[], int argc)
     // in exception
   }
 
-  // do nothing if no rescue, no ensure
-  if( vm->exception_tail == NULL ){
-    return;
-  }
-
-  // NOT to return to OP_SEND
-  mrbc_pop_callinfo(vm);
-
-  mrbc_callinfo *callinfo = vm->exception_tail;
-  if( callinfo != NULL ){
-    if( callinfo->method_id == 0x7fff ){
-      // "rescue"
-      // jump to rescue
-      vm->exception_tail = callinfo->prev;
-      vm->current_regs = callinfo->current_regs;
-      vm->pc_irep = callinfo->pc_irep;
-      vm->inst = callinfo->inst;
-      vm->target_class = callinfo->target_class;
-      mrbc_free(vm, callinfo);
-      callinfo = vm->exception_tail;
-    } else {
-      // "ensure"
-      // jump to ensure
-      vm->exception_tail = callinfo->prev;
-      vm->current_regs = callinfo->current_regs;
-      vm->pc_irep = callinfo->pc_irep;
-      vm->inst = callinfo->inst;
-      vm->target_class = callinfo->target_class;
-      mrbc_free(vm, callinfo);
-      //
-      callinfo = vm->exception_tail;
-      if( callinfo != NULL ){
-	vm->exception_tail = callinfo->prev;
-	callinfo->prev = vm->callinfo_tail;
-	vm->callinfo_tail = callinfo;
-      }
-    }
-  }
-  if( callinfo == NULL ){
-    vm->exc_pending = vm->exc;
-    vm->exc = 0;
-  }
+  // unwind to rescue or ensure after this method.
+  mrbc_vm_raise( vm );
 }
 
 
@@ -1089,6 +1386,9 @@ static void mrbc_init_class_object(struct VM *vm)
   mrbc_define_method(vm, mrbc_class_object, "dup", c_object_dup);
   mrbc_define_method(vm, mrbc_class_object, "attr_reader", c_object_attr_reader);
   mrbc_define_method(vm, mrbc_class_object, "attr_accessor", c_object_attr_accessor);
+#if MRBC_USE_INSTANCE_POOL
+  mrbc_define_method(vm, mrbc_class_object, "instance_pool", c_object_instance_pool);
+#endif
   mrbc_define_method(vm, mrbc_class_object, "is_a?", c_object_kind_of);
   mrbc_define_method(vm, mrbc_class_object, "kind_of?", c_object_kind_of);
   mrbc_define_method(vm, mrbc_class_object, "nil?", c_object_nil);
@@ -1144,6 +1444,7 @@ mrbc_value mrbc_proc_new(struct VM *vm, void *irep )
   }
 
   val.proc->irep = irep;
+  mrbc_objspace_new( MRBC_TT_PROC );
 
   return val;
 }
@@ -1156,6 +1457,7 @@ mrbc_value mrbc_proc_new(struct VM *vm, void *irep )
 */
 void mrbc_proc_delete(mrbc_value *val)
 {
+  mrbc_objspace_delete( MRBC_TT_PROC );
   mrbc_raw_free(val->proc);
 }
 
@@ -1404,9 +1706,13 @@ void mrbc_run_mrblib(const uint8_t bytecode[])
   if( !vm ) return;	// ENOMEM
   memset(vm, 0, sizeof(mrbc_vm));
 
-  mrbc_load_mrb(vm, bytecode);
-  mrbc_vm_begin(vm);
-  mrbc_vm_run(vm);
+  if( mrbc_load_mrb(vm, bytecode) == 0 ) {
+    mrbc_vm_begin(vm);
+    mrbc_vm_run(vm);
+#if MRBC_USE_HOT_SWAP
+    mrbc_hotswap_register_mrblib(bytecode, vm->irep);
+#endif
+  }
 
   // not necessary to call mrbc_vm_end()
 
@@ -1438,12 +1744,36 @@ void mrbc_init_class(void)
   mrbc_init_class_math(0);
 #endif
 #endif
+#if MRBC_USE_FIXED
+  mrbc_init_class_fixed(0);
+#endif
 #if MRBC_USE_STRING
   mrbc_init_class_string(0);
 #endif
   mrbc_init_class_array(0);
   mrbc_init_class_range(0);
   mrbc_init_class_hash(0);
+#if MRBC_USE_STRUCT
+  mrbc_init_class_struct(0);
+#endif
+#if MRBC_USE_RINGBUFFER
+  mrbc_init_class_ringbuffer(0);
+#endif
+#if MRBC_USE_LOG
+  mrbc_init_class_log(0);
+#endif
+#if MRBC_USE_PROFILER
+  mrbc_init_class_profiler(0);
+#endif
+#if MRBC_USE_BENCHMARK
+  mrbc_init_class_benchmark(0);
+#endif
+#if MRBC_USE_METRICS
+  mrbc_init_class_metrics(0);
+#endif
+#if MRBC_USE_OBJSPACE
+  mrbc_init_class_objspace(0);
+#endif
 
   mrbc_init_class_exception(0);
 
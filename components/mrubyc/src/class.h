@@ -33,6 +33,13 @@ typedef struct RClass {
 #endif
   struct RClass *super;	// mrbc_class[super]
   struct RProc *procs;	// mrbc_proc[rprocs], linked list
+#if MRBC_USE_OBJSPACE
+  uint16_t n_live;	// # of live instances.
+  uint16_t n_watch;	// n_live at ObjectSpace.watch
+#endif
+#if MRBC_USE_INSTANCE_POOL
+  uint16_t data_size;	// size of data[] of the instances. 0 if inherited.
+#endif
 
 } mrbc_class;
 typedef struct RClass mrb_class;
@@ -46,6 +53,9 @@ typedef struct RInstance {
 
   struct RClass *cls;
   struct RKeyValueHandle ivar;
+#if MRBC_USE_INSTANCE_POOL
+  uint16_t data_size;	// size of data[].
+#endif
   uint8_t data[];
 
 } mrbc_instance;
@@ -73,9 +83,24 @@ typedef struct RProc {
 typedef struct RProc mrb_proc;
 
 
+//================================================================
+/*! method handle for mrbc_call()
+*/
+typedef struct RMethodHandle {
+  mrbc_class *base;	// class of the receiver.
+  mrbc_class *cls;	// class which owns the method.
+  mrbc_proc *method;
+  mrbc_sym sym_id;
+  uint32_t generation;	// mrbc_method_generation when resolved.
+} mrbc_method_handle;
+
+extern uint32_t mrbc_method_generation;
+
+
 int mrbc_obj_is_kind_of(const mrbc_value *obj, const mrb_class *cls);
 mrbc_value mrbc_instance_new(struct VM *vm, mrbc_class *cls, int size);
 void mrbc_instance_delete(mrbc_value *v);
+void mrbc_instance_initialize(struct VM *vm, mrbc_value v[], int argc, mrbc_value new_obj);
 void mrbc_instance_setiv(mrbc_object *obj, mrbc_sym sym_id, mrbc_value *v);
 mrbc_value mrbc_instance_getiv(mrbc_object *obj, mrbc_sym sym_id);
 mrbc_class *find_class_by_object(struct VM *vm, const mrbc_object *obj);
@@ -86,6 +111,9 @@ mrbc_class *mrbc_get_class_by_name(const char *name);
 void mrbc_define_method(struct VM *vm, mrbc_class *cls, const char *name, mrbc_func_t cfunc);
 void mrbc_funcall(struct VM *vm, const char *name, mrbc_value *v, int argc);
 mrbc_value mrbc_send(struct VM *vm, mrbc_value *v, int reg_ofs, mrbc_value *recv, const char *method, int argc, ...);
+int mrbc_method_handle_init(mrbc_method_handle *h, mrbc_class *cls, const char *method);
+mrbc_value mrbc_call(struct VM *vm, mrbc_method_handle *h, const mrbc_value *recv, int argc, const mrbc_value argv[]);
+mrbc_value mrbc_call_block(struct VM *vm, const mrbc_value *proc, int argc, const mrbc_value argv[]);
 int mrbc_p_sub(const mrbc_value *v);
 int mrbc_print_sub(const mrbc_value *v);
 int mrbc_puts_sub(const mrbc_value *v);
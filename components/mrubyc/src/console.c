@@ -24,6 +24,155 @@
 #include "console.h"
 
 
+// unsigned type of the same width as mrbc_int.
+#if MRBC_INT64
+typedef uint64_t mrbc_uint;
+#else
+typedef uint32_t mrbc_uint;
+#endif
+
+#if MRBC_CONSOLE_BUFFER_SIZE
+#if MRBC_CONSOLE_BUFFER_SIZE > 0xffff
+#error "MRBC_CONSOLE_BUFFER_SIZE must be 65535 or less."
+#endif
+
+/*
+  Output ring buffer.
+  Writers put the data under hal_disable_irq(), and the flush writes
+  it out by hal_write() outside the critical section.
+*/
+static struct {
+  uint16_t head;		//!< write position.
+  uint16_t tail;		//!< read (flush) position.
+  uint16_t used;		//!< bytes in the buffer.
+  uint8_t flushing;		//!< flush in progress.
+  uint32_t last_flush_tick;
+  mrbc_console_statistics stat;
+  char buf[MRBC_CONSOLE_BUFFER_SIZE];
+} cbuf;
+
+
+//================================================================
+/*! write out all buffered data.
+*/
+void mrbc_console_flush(void)
+{
+  hal_disable_irq();
+  if( cbuf.flushing || cbuf.used == 0 ) {
+    hal_enable_irq();
+    return;
+  }
+  cbuf.flushing = 1;
+  cbuf.stat.n_flush++;
+
+  while( cbuf.used ) {
+    // write out the contiguous region from the tail.
+    int n = MRBC_CONSOLE_BUFFER_SIZE - cbuf.tail;
+    if( n > cbuf.used ) n = cbuf.used;
+    const char *p = cbuf.buf + cbuf.tail;
+    hal_enable_irq();
+
+    hal_write(1, p, n);
+
+    hal_disable_irq();
+    cbuf.tail += n;
+    if( cbuf.tail == MRBC_CONSOLE_BUFFER_SIZE ) cbuf.tail = 0;
+    cbuf.used -= n;
+  }
+
+  cbuf.flushing = 0;
+  hal_enable_irq();
+}
+
+
+//================================================================
+/*! write data into the output buffer.
+
+  @param  buf		pointer to data.
+  @param  nbytes	data length.
+*/
+void mrbc_console_write(const void *buf, int nbytes)
+{
+  const char *s = buf;
+  int flag_flush = 0;
+
+  while( nbytes > 0 ) {
+    hal_disable_irq();
+    int n = MRBC_CONSOLE_BUFFER_SIZE - cbuf.used;
+    if( n == 0 ) {
+#if MRBC_CONSOLE_DROP_WHEN_FULL
+      cbuf.stat.n_dropped += nbytes;
+      hal_enable_irq();
+      return;
+#else
+      cbuf.stat.n_stall++;
+      hal_enable_irq();
+      mrbc_console_flush();
+      continue;
+#endif
+    }
+    if( n > nbytes ) n = nbytes;
+    if( n > MRBC_CONSOLE_BUFFER_SIZE - cbuf.head ) {
+      n = MRBC_CONSOLE_BUFFER_SIZE - cbuf.head;
+    }
+
+    memcpy( cbuf.buf + cbuf.head, s, n );
+    cbuf.head += n;
+    if( cbuf.head == MRBC_CONSOLE_BUFFER_SIZE ) cbuf.head = 0;
+    cbuf.used += n;
+    cbuf.stat.n_written += n;
+    if( cbuf.used > cbuf.stat.max_used ) cbuf.stat.max_used = cbuf.used;
+    if( cbuf.used >= MRBC_CONSOLE_FLUSH_SIZE ) flag_flush = 1;
+    hal_enable_irq();
+
+#if MRBC_CONSOLE_FLUSH_NEWLINE
+    if( memchr( s, '\n', n ) ) flag_flush = 1;
+#endif
+    s += n;
+    nbytes -= n;
+  }
+
+  if( flag_flush ) mrbc_console_flush();
+}
+
+
+//================================================================
+/*! flush the output buffer by time policy. (called from the scheduler)
+
+  @param  tick	current tick count.
+*/
+void mrbc_console_poll(uint32_t tick)
+{
+  if( cbuf.used == 0 ) {
+    cbuf.last_flush_tick = tick;
+    return;
+  }
+  if( (tick - cbuf.last_flush_tick) * MRBC_TICK_UNIT < MRBC_CONSOLE_FLUSH_MS ) return;
+
+  cbuf.last_flush_tick = tick;
+  mrbc_console_flush();
+}
+#endif  // MRBC_CONSOLE_BUFFER_SIZE
+
+
+//================================================================
+/*! get the console output buffer statistics.
+
+  @param  stat	pointer to the result.
+*/
+void mrbc_console_get_statistics(mrbc_console_statistics *stat)
+{
+#if MRBC_CONSOLE_BUFFER_SIZE
+  hal_disable_irq();
+  *stat = cbuf.stat;
+  stat->used = cbuf.used;
+  hal_enable_irq();
+#else
+  *stat = (mrbc_console_statistics){0};
+#endif
+}
+
+
 //================================================================
 /*! output formatted string
 
@@ -42,7 +191,7 @@ void console_printf(const char *fstr, ...)
   while( 1 ) {
     ret = mrbc_printf_main( &pf );
     if( mrbc_printf_len( &pf ) ) {
-      hal_write(1, buf, mrbc_printf_len( &pf ));
+      mrbc_console_write(buf, mrbc_printf_len( &pf ));
       mrbc_printf_clear( &pf );
     }
     if( ret == 0 ) break;
@@ -59,10 +208,13 @@ void console_printf(const char *fstr, ...)
 
       case 'd':
       case 'i':
-      case 'u':
 	ret = mrbc_printf_int( &pf, va_arg(ap, int), 10);
 	break;
 
+      case 'u':
+	ret = mrbc_printf_uint( &pf, va_arg(ap, unsigned int), 10);
+	break;
+
       case 'D':	// for mrbc_int (see mrbc_print_sub in class.c)
 	ret = mrbc_printf_int( &pf, va_arg(ap, mrbc_int), 10);
 	break;
@@ -91,7 +243,7 @@ void console_printf(const char *fstr, ...)
 	break;
       }
 
-      hal_write(1, buf, mrbc_printf_len( &pf ));
+      mrbc_console_write(buf, mrbc_printf_len( &pf ));
       mrbc_printf_clear( &pf );
     }
   }
@@ -247,35 +399,24 @@ int mrbc_printf_bstr( mrbc_printf *pf, const char *str, int len, int pad )
 
 
 //================================================================
-/*! sprintf subcontract function for integer '%d', '%u'
+/*! sprintf subcontract function for integer, common part.
 
   @param  pf	pointer to mrbc_printf.
-  @param  value	output value.
+  @param  v	absolute value.
+  @param  sign	sign character or 0.
   @param  base	n base.
   @retval 0	done.
   @retval -1	buffer full.
   @note		not terminate ('\0') buffer tail.
 */
-int mrbc_printf_int( mrbc_printf *pf, mrbc_int value, int base )
+static int mrbc_printf_int_sub( mrbc_printf *pf, mrbc_uint v, int sign, int base )
 {
-  int sign = 0;
-  mrbc_int v = value;
-
-  if( value < 0 ) {
-    sign = '-';
-    v = -value;
-  } else if( pf->fmt.flag_plus ) {
-    sign = '+';
-  } else if( pf->fmt.flag_space ) {
-    sign = ' ';
-  }
-
   if( pf->fmt.flag_minus || pf->fmt.width == 0 ) {
     pf->fmt.flag_zero = 0; // disable zero padding if left align or width zero.
   }
 
   // create string to allocated buffer
-  int alloc_size = 32+2;	// int32 + terminate + 1
+  int alloc_size = sizeof(mrbc_int) * 8 + 2;	// binary digits + terminate + 1
   if( alloc_size < pf->fmt.precision + 1 ) alloc_size = pf->fmt.precision + 1;
   assert( sizeof(mrbc_int) * 8 < alloc_size );
 
@@ -324,6 +465,52 @@ int mrbc_printf_int( mrbc_printf *pf, mrbc_int value, int base )
 
 
 
+//================================================================
+/*! sprintf subcontract function for integer '%d'
+
+  @param  pf	pointer to mrbc_printf.
+  @param  value	output value.
+  @param  base	n base.
+  @retval 0	done.
+  @retval -1	buffer full.
+  @note		not terminate ('\0') buffer tail.
+*/
+int mrbc_printf_int( mrbc_printf *pf, mrbc_int value, int base )
+{
+  int sign = 0;
+  mrbc_uint v = value;
+
+  if( value < 0 ) {
+    sign = '-';
+    v = -v;		// not to overflow MIN.
+  } else if( pf->fmt.flag_plus ) {
+    sign = '+';
+  } else if( pf->fmt.flag_space ) {
+    sign = ' ';
+  }
+
+  return mrbc_printf_int_sub( pf, v, sign, base );
+}
+
+
+
+//================================================================
+/*! sprintf subcontract function for unsigned integer '%u'
+
+  @param  pf	pointer to mrbc_printf.
+  @param  value	output value.
+  @param  base	n base.
+  @retval 0	done.
+  @retval -1	buffer full.
+  @note		not terminate ('\0') buffer tail.
+*/
+int mrbc_printf_uint( mrbc_printf *pf, unsigned int value, int base )
+{
+  return mrbc_printf_int_sub( pf, value, 0, base );
+}
+
+
+
 //================================================================
 /*! sprintf subcontract function for '%x', '%o', '%b'
 
@@ -351,7 +538,7 @@ int mrbc_printf_bit( mrbc_printf *pf, mrbc_int value, int bit )
   int mchar = mask + ((mask < 10)? '0' : offset_a);
 
   // create string to local buffer
-  char buf[40];	// > int32(bit) + '..f\0'
+  char buf[sizeof(mrbc_int) * 8 + 8];	// > int(bit) + '..f\0'
   assert( sizeof(buf) > (sizeof(mrbc_int) * 8 + 4) );
   char *p = buf + sizeof(buf) - 1;
   *p = '\0';
@@ -3,8 +3,8 @@
   console output module. (not yet input)
 
   <pre>
-  Copyright (C) 2015-2018 Kyushu Institute of Technology.
-  Copyright (C) 2015-2018 Shimane IT Open-Innovation Center.
+  Copyright (C) 2015-2020 Kyushu Institute of Technology.
+  Copyright (C) 2015-2020 Shimane IT Open-Innovation Center.
 
   This file is distributed under BSD 3-Clause License.
 
@@ -46,16 +46,46 @@ typedef struct RPrintf {
 } mrbc_printf;
 
 
+//================================================================
+/*! console output buffer statistics.
+*/
+typedef struct CONSOLE_STATISTICS {
+  uint32_t n_written;		//!< bytes written into the buffer.
+  uint32_t n_flush;		//!< number of flushes.
+  uint32_t n_stall;		//!< writes waited for the flush. (buffer full)
+  uint32_t n_dropped;		//!< bytes dropped. (buffer full)
+  uint16_t used;		//!< bytes in the buffer now.
+  uint16_t max_used;		//!< high-water mark.
+} mrbc_console_statistics;
+
+
+#if MRBC_CONSOLE_BUFFER_SIZE
+void mrbc_console_write(const void *buf, int nbytes);
+void mrbc_console_flush(void);
+void mrbc_console_poll(uint32_t tick);
+#endif
+void mrbc_console_get_statistics(mrbc_console_statistics *stat);
 void console_printf(const char *fstr, ...);
 int mrbc_printf_main(mrbc_printf *pf);
 int mrbc_printf_char(mrbc_printf *pf, int ch);
 int mrbc_printf_bstr(mrbc_printf *pf, const char *str, int len, int pad);
 int mrbc_printf_int(mrbc_printf *pf, mrbc_int value, int base);
+int mrbc_printf_uint(mrbc_printf *pf, unsigned int value, int base);
 int mrbc_printf_bit(mrbc_printf *pf, mrbc_int value, int bit);
 int mrbc_printf_float(mrbc_printf *pf, double value);
 void mrbc_printf_replace_buffer(mrbc_printf *pf, char *buf, int size);
 
 
+#if !MRBC_CONSOLE_BUFFER_SIZE
+static inline void mrbc_console_write(const void *buf, int nbytes)
+{
+  hal_write(1, buf, nbytes);
+}
+static inline void mrbc_console_flush(void) {}
+static inline void mrbc_console_poll(uint32_t tick) {}
+#endif
+
+
 //================================================================
 /*! output a character
 
@@ -63,7 +93,7 @@ void mrbc_printf_replace_buffer(mrbc_printf *pf, char *buf, int size);
 */
 static inline void console_putchar(char c)
 {
-  hal_write(1, &c, 1);
+  mrbc_console_write(&c, 1);
 }
 
 
@@ -74,7 +104,7 @@ static inline void console_putchar(char c)
 */
 static inline void console_print(const char *str)
 {
-  hal_write(1, str, strlen(str));
+  mrbc_console_write(str, strlen(str));
 }
 
 
@@ -86,7 +116,7 @@ static inline void console_print(const char *str)
 */
 static inline void console_nprint(const char *str, int size)
 {
-  hal_write(1, str, size);
+  mrbc_console_write(str, size);
 }
 
 
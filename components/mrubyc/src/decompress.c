@@ -0,0 +1,180 @@
+/*! @file
+  @brief
+  Streaming decompressor for compressed bytecode (.mrbz) images.
+
+  <pre>
+  Copyright (C) 2015-2020 Kyushu Institute of Technology.
+  Copyright (C) 2015-2020 Shimane IT Open-Innovation Center.
+
+  This file is distributed under BSD 3-Clause License.
+
+  </pre>
+
+  <pre>
+  Structure (numbers are big endian)
+   "MRBZ"	identifier
+   00		window size in bits (4..15)
+   00		lookahead size in bits (3..window size - 1)
+   0000		reserved
+   0000_0000	size of original .mrb image
+   0000_0000	size of compressed stream
+   ...		compressed stream
+
+  Compressed stream is LZSS, same as heatshrink. (MSB first)
+   1 + 8 bits		literal byte.
+   0 + W + L bits	back reference. (index - 1, count - 1)
+
+  The output buffer is used as the sliding window, so this needs
+  no work memory other than mrbc_decompress.
+  tools/mrbz.rb makes this image, and mrbc_load_mrb() accepts it.
+  </pre>
+*/
+
+#include "vm_config.h"
+#include <stdint.h>
+#include <string.h>
+
+#include "vm.h"
+#include "decompress.h"
+
+
+enum {
+  STATE_TAG_BIT,
+  STATE_LITERAL,
+  STATE_BACKREF_INDEX,
+  STATE_BACKREF_COUNT,
+};
+
+
+//================================================================
+/*! get bits from input stream.
+
+  @param  d	pointer to decompressor.
+  @param  n	number of bits.
+  @param  src	pointer of pointer to input.
+  @param  end	end of input.
+  @return	value, or -1 if more input required.
+*/
+static int get_bits( mrbc_decompress *d, int n, const uint8_t **src, const uint8_t *end )
+{
+  while( d->n_acc < n ) {
+    if( d->n_bits == 0 ) {
+      if( *src == end ) return -1;
+      d->cur_byte = *(*src)++;
+      d->n_bits = 8;
+    }
+    d->acc = (d->acc << 1) | (d->cur_byte >> 7);
+    d->cur_byte <<= 1;
+    d->n_bits--;
+    d->n_acc++;
+  }
+
+  int ret = d->acc;
+  d->acc = 0;
+  d->n_acc = 0;
+  return ret;
+}
+
+
+//================================================================
+/*! parse .mrbz header.
+
+  @param  hdr		pointer to .mrbz image.
+  @param  size		returns original size.
+  @param  zsize		returns compressed stream size.
+  @param  window_sz2	returns window size in bits.
+  @param  lookahead_sz2	returns lookahead size in bits.
+  @return int		zero if no error.
+*/
+int mrbc_decompress_header( const uint8_t *hdr, uint32_t *size, uint32_t *zsize, int *window_sz2, int *lookahead_sz2 )
+{
+  if( !mrbc_is_compressed_image(hdr) ) return -1;
+  if( hdr[4] < 4 || hdr[4] > 15 ) return -1;
+  if( hdr[5] < 3 || hdr[5] >= hdr[4] ) return -1;
+
+  *window_sz2 = hdr[4];
+  *lookahead_sz2 = hdr[5];
+  *size = bin_to_uint32(hdr + 8);
+  *zsize = bin_to_uint32(hdr + 12);
+  return 0;
+}
+
+
+//================================================================
+/*! initialize decompressor.
+
+  @param  d		pointer to decompressor.
+  @param  dst		output buffer.
+  @param  dst_size	size of original image.
+  @param  window_sz2	window size in bits.
+  @param  lookahead_sz2	lookahead size in bits.
+*/
+void mrbc_decompress_init( mrbc_decompress *d, uint8_t *dst, uint32_t dst_size, int window_sz2, int lookahead_sz2 )
+{
+  memset( d, 0, sizeof(mrbc_decompress) );
+  d->dst = dst;
+  d->dst_size = dst_size;
+  d->window_sz2 = window_sz2;
+  d->lookahead_sz2 = lookahead_sz2;
+  d->state = STATE_TAG_BIT;
+}
+
+
+//================================================================
+/*! feed compressed data. (can be called with any chunk size)
+
+  @param  d	pointer to decompressor.
+  @param  src	compressed data.
+  @param  len	length of data.
+  @retval 1	completed.
+  @retval 0	need more input.
+  @retval -1	broken data.
+*/
+int mrbc_decompress_feed( mrbc_decompress *d, const uint8_t *src, uint32_t len )
+{
+  const uint8_t *end = src + len;
+  int v;
+
+  while( 1 ) {
+    switch( d->state ) {
+    case STATE_TAG_BIT:
+      if( d->dst_pos == d->dst_size ) return 1;
+      if( (v = get_bits(d, 1, &src, end)) < 0 ) return 0;
+      d->state = v ? STATE_LITERAL : STATE_BACKREF_INDEX;
+      break;
+
+    case STATE_LITERAL:
+      if( (v = get_bits(d, 8, &src, end)) < 0 ) return 0;
+      d->dst[d->dst_pos++] = v;
+      d->state = STATE_TAG_BIT;
+      break;
+
+    case STATE_BACKREF_INDEX:
+      if( (v = get_bits(d, d->window_sz2, &src, end)) < 0 ) return 0;
+      d->index = v + 1;
+      d->state = STATE_BACKREF_COUNT;
+      break;
+
+    case STATE_BACKREF_COUNT: {
+      if( (v = get_bits(d, d->lookahead_sz2, &src, end)) < 0 ) return 0;
+      uint32_t count = v + 1;
+      if( d->index > d->dst_pos || count > d->dst_size - d->dst_pos ) {
+	return -1;
+      }
+
+      // source and destination may overlap, copy each byte.
+      uint8_t *p = d->dst + d->dst_pos;
+      const uint8_t *s = p - d->index;
+      d->dst_pos += count;
+      while( count-- > 0 ) {
+	*p++ = *s++;
+      }
+      d->state = STATE_TAG_BIT;
+    } break;
+
+    default:
+      return -1;
+    }
+  }
+}
+
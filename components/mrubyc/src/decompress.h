@@ -0,0 +1,62 @@
+/*! @file
+  @brief
+  Streaming decompressor for compressed bytecode (.mrbz) images.
+
+  <pre>
+  Copyright (C) 2015-2020 Kyushu Institute of Technology.
+  Copyright (C) 2015-2020 Shimane IT Open-Innovation Center.
+
+  This file is distributed under BSD 3-Clause License.
+
+  </pre>
+*/
+
+#ifndef MRBC_SRC_DECOMPRESS_H_
+#define MRBC_SRC_DECOMPRESS_H_
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define MRBC_MRBZ_HEADER_SIZE 16
+
+//================================================================
+/*!@brief
+  Decompressor state.
+*/
+typedef struct MRBC_DECOMPRESS {
+  uint8_t *dst;			//!< output buffer. (also used as window)
+  uint32_t dst_size;		//!< size of output buffer.
+  uint32_t dst_pos;		//!< current output position.
+
+  uint8_t window_sz2;		//!< window size in bits.
+  uint8_t lookahead_sz2;	//!< lookahead size in bits.
+  uint8_t state;		//!< internal state.
+  uint8_t n_bits;		//!< remaining bits in cur_byte.
+  uint8_t cur_byte;		//!< current input byte.
+  uint8_t n_acc;		//!< number of bits in acc.
+  uint16_t acc;			//!< accumulated bits.
+  uint16_t index;		//!< back reference index.
+} mrbc_decompress;
+
+
+int mrbc_decompress_header(const uint8_t *hdr, uint32_t *size, uint32_t *zsize, int *window_sz2, int *lookahead_sz2);
+void mrbc_decompress_init(mrbc_decompress *d, uint8_t *dst, uint32_t dst_size, int window_sz2, int lookahead_sz2);
+int mrbc_decompress_feed(mrbc_decompress *d, const uint8_t *src, uint32_t len);
+
+
+//================================================================
+/*! check compressed image.
+*/
+static inline int mrbc_is_compressed_image(const uint8_t *p)
+{
+  return p[0] == 'M' && p[1] == 'R' && p[2] == 'B' && p[3] == 'Z';
+}
+
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -29,6 +29,7 @@ static void c_exception_message(struct VM *vm, mrbc_value v[], int argc)
     v[0] = mrbc_string_new(vm, "", 0);
   } else {
     v[0] = vm->exc_message;
+    mrbc_dup( &v[0] );
   }
 }
 
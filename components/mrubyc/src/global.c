@@ -86,6 +86,15 @@ mrbc_value * mrbc_get_global( mrbc_sym sym_id )
 }
 
 
+//================================================================
+/*! get the constant table handle. (for iteration)
+*/
+const mrbc_kv_handle * mrbc_get_const_handle(void)
+{
+  return &handle_const;
+}
+
+
 //================================================================
 /*! clear vm_id in global object for process terminated.
 */
@@ -15,6 +15,7 @@
 #define MRBC_SRC_GLOBAL_H_
 
 #include "value.h"
+#include "keyvalue.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -25,6 +26,7 @@ int mrbc_set_const(mrbc_sym sym_id, mrbc_value *v);
 mrbc_value *mrbc_get_const(mrbc_sym sym_id);
 int mrbc_set_global(mrbc_sym sym_id, mrbc_value *v);
 mrbc_value *mrbc_get_global(mrbc_sym sym_id);
+const mrbc_kv_handle *mrbc_get_const_handle(void);
 void mrbc_global_clear_vm_id(void);
 void mrbc_global_debug_dump(void);
 
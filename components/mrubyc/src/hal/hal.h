@@ -23,6 +23,8 @@ extern "C" {
 #include <unistd.h>
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
+#include "xtensa/hal.h"
+#include "esp_timer.h"
 
 
 /***** Local headers ********************************************************/
@@ -87,6 +89,19 @@ inline static int hal_write(int fd, const void *buf, int nbytes)
   return write(1, buf, nbytes);
 }
 
+//================================================================
+/*!@brief
+  CPU cycle counter. (for instrumentation)
+*/
+#define hal_cycle_count()  xthal_get_ccount()
+
+//================================================================
+/*!@brief
+  Monotonic clock in microseconds since boot. (for benchmarks)
+*/
+#define hal_time_us()  ((uint64_t)esp_timer_get_time())
+
+
 //================================================================
 /*!@brief
   Flush write baffer
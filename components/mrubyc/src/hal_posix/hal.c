@@ -0,0 +1,103 @@
+/*! @file
+  @brief
+  Hardware abstraction layer
+        for POSIX (host builds, benchmarks)
+
+  <pre>
+  Copyright (C) 2016-2020 Kyushu Institute of Technology.
+  Copyright (C) 2016-2020 Shimane IT Open-Innovation Center.
+
+  This file is distributed under BSD 3-Clause License.
+  </pre>
+*/
+
+/***** Feature test switches ************************************************/
+/***** System headers *******************************************************/
+#include <signal.h>
+#include <sys/time.h>
+
+
+/***** Local headers ********************************************************/
+#include "hal.h"
+
+
+/***** Constat values *******************************************************/
+/***** Macros ***************************************************************/
+/***** Typedefs *************************************************************/
+/***** Function prototypes **************************************************/
+/***** Local variables ******************************************************/
+#ifndef MRBC_NO_TIMER
+static sigset_t sigset_;	//!< SIGALRM only.
+static int irq_nest_;		//!< nesting level of hal_disable_irq.
+#endif
+
+
+/***** Global variables *****************************************************/
+/***** Signal catching functions ********************************************/
+#ifndef MRBC_NO_TIMER
+//================================================================
+/*!@brief
+  alarm signal handler
+
+*/
+static void sig_alarm(int dummy)
+{
+  mrbc_tick();
+}
+
+#endif
+
+
+/***** Local functions ******************************************************/
+/***** Global functions *****************************************************/
+#ifndef MRBC_NO_TIMER
+
+//================================================================
+/*!@brief
+  initialize
+
+*/
+void hal_init(void)
+{
+  sigemptyset(&sigset_);
+  sigaddset(&sigset_, SIGALRM);
+
+  // ticks by SIGALRM.
+  struct sigaction sa;
+  sa.sa_handler = sig_alarm;
+  sa.sa_flags   = SA_RESTART;
+  sa.sa_mask    = sigset_;
+  sigaction(SIGALRM, &sa, 0);
+
+  struct itimerval tval;
+  tval.it_interval.tv_sec  = 0;
+  tval.it_interval.tv_usec = MRBC_TICK_UNIT * 1000;
+  tval.it_value = tval.it_interval;
+  setitimer(ITIMER_REAL, &tval, 0);
+}
+
+
+//================================================================
+/*!@brief
+  enable interrupt
+
+*/
+void hal_enable_irq(void)
+{
+  if( --irq_nest_ == 0 ) sigprocmask(SIG_UNBLOCK, &sigset_, 0);
+}
+
+
+//================================================================
+/*!@brief
+  disable interrupt
+
+*/
+void hal_disable_irq(void)
+{
+  sigprocmask(SIG_BLOCK, &sigset_, 0);
+  irq_nest_++;
+}
+
+
+#endif /* ifndef MRBC_NO_TIMER */
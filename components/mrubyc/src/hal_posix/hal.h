@@ -0,0 +1,133 @@
+/*! @file
+  @brief
+  Hardware abstraction layer
+        for POSIX (host builds, benchmarks)
+
+  <pre>
+  Copyright (C) 2016-2020 Kyushu Institute of Technology.
+  Copyright (C) 2016-2020 Shimane IT Open-Innovation Center.
+
+  This file is distributed under BSD 3-Clause License.
+  </pre>
+*/
+
+#ifndef MRBC_SRC_HAL_H_
+#define MRBC_SRC_HAL_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/***** Feature test switches ************************************************/
+/***** System headers *******************************************************/
+#include <stdint.h>
+#include <unistd.h>
+#include <time.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+
+/***** Local headers ********************************************************/
+/***** Constant values ******************************************************/
+/***** Macros ***************************************************************/
+#ifndef MRBC_SCHEDULER_EXIT
+#define MRBC_SCHEDULER_EXIT 1
+#endif
+
+#if !defined(MRBC_TICK_UNIT)
+#define MRBC_TICK_UNIT_1_MS   1
+#define MRBC_TICK_UNIT_2_MS   2
+#define MRBC_TICK_UNIT_4_MS   4
+#define MRBC_TICK_UNIT_10_MS 10
+#define MRBC_TICK_UNIT MRBC_TICK_UNIT_1_MS
+// Substantial timeslice value (millisecond) will be
+// MRBC_TICK_UNIT * MRBC_TIMESLICE_TICK_COUNT (+ Jitter).
+// MRBC_TIMESLICE_TICK_COUNT must be natural number
+// (recommended value is from 1 to 10).
+#define MRBC_TIMESLICE_TICK_COUNT 10
+#endif
+
+
+/***** Typedefs *************************************************************/
+/***** Global variables *****************************************************/
+/***** Function prototypes **************************************************/
+void mrbc_tick(void);
+
+#ifndef MRBC_NO_TIMER
+void hal_init(void);
+void hal_enable_irq(void);
+void hal_disable_irq(void);
+                           // Note: sleep() returns on the next SIGALRM.
+# define hal_idle_cpu()    sleep(1)
+
+#else // MRBC_NO_TIMER
+# define hal_init()        ((void)0)
+# define hal_enable_irq()  ((void)0)
+# define hal_disable_irq() ((void)0)
+# define hal_idle_cpu()    (usleep(MRBC_TICK_UNIT * 1000), mrbc_tick())
+
+#endif
+
+
+/***** Inline functions *****************************************************/
+
+//================================================================
+/*!@brief
+  Write
+
+  @param  fd    dummy, but 1.
+  @param  buf   pointer of buffer.
+  @param  nbytes        output byte length.
+*/
+inline static int hal_write(int fd, const void *buf, int nbytes)
+{
+  return write(1, buf, nbytes);
+}
+
+//================================================================
+/*!@brief
+  Monotonic clock in microseconds. (for benchmarks)
+*/
+inline static uint64_t hal_time_us(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+//================================================================
+/*!@brief
+  CPU cycle counter. (for instrumentation)
+
+  TSC on x86, nanoseconds elsewhere.
+*/
+inline static uint32_t hal_cycle_count(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+  return (uint32_t)__rdtsc();
+#else
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint32_t)(ts.tv_sec * 1000000000ULL + ts.tv_nsec);
+#endif
+}
+#define hal_cycle_count hal_cycle_count	// for the check in opstat.h
+
+
+//================================================================
+/*!@brief
+  Flush write baffer
+
+  @param  fd    dummy, but 1.
+*/
+inline static int hal_flush(int fd)
+{
+  return fsync(1);
+}
+
+
+#ifdef __cplusplus
+}
+#endif
+#endif // ifndef MRBC_HAL_H_
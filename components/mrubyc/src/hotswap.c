@@ -0,0 +1,340 @@
+/*! @file
+  @brief
+  Hot code swap. (replace bytecode without restarting the scheduler)
+
+  <pre>
+  Copyright (C) 2015-2020 Kyushu Institute of Technology.
+  Copyright (C) 2015-2020 Shimane IT Open-Innovation Center.
+
+  This file is distributed under BSD 3-Clause License.
+
+  </pre>
+
+  <pre>
+  Replaced ireps are not freed at once. They are moved to the retired
+  list, and freed by mrbc_hotswap_collect() when no task (pc_irep,
+  callinfo, Proc in registers) and no method of any class refers them.
+
+  (NOTE)
+  Blocks saved in objects (instance variables, Array, etc.) are not
+  traced. Don't keep them across the swap.
+  Old image itself (ROM or RAM) must not be overwritten until the old
+  ireps are freed.
+  </pre>
+*/
+
+#include "vm_config.h"
+#include <stdint.h>
+#include <string.h>
+
+#include "vm.h"
+#include "alloc.h"
+#include "class.h"
+#include "global.h"
+#include "load.h"
+#include "console.h"
+#include "rrt0.h"
+#include "hotswap.h"
+
+#if MRBC_USE_HOT_SWAP
+
+//================================================================
+/*!@brief
+  loaded or retired irep tree.
+*/
+typedef struct IREP_ENTRY {
+  struct IREP_ENTRY *next;
+  const uint8_t *bytecode;	//!< loaded image. (NULL if retired)
+  mrbc_irep *irep;		//!< root irep.
+} irep_entry;
+
+static irep_entry *mrblib_list_;	//!< ireps loaded by mrbc_run_mrblib()
+static irep_entry *retired_list_;	//!< ireps waiting for release.
+
+
+//================================================================
+/*! check if the irep tree contains irep.
+*/
+static int irep_contains( const mrbc_irep *root, const mrbc_irep *irep )
+{
+  if( root == irep ) return 1;
+
+  int i;
+  for( i = 0; i < root->rlen; i++ ) {
+    if( irep_contains( root->reps[i], irep ) ) return 1;
+  }
+  return 0;
+}
+
+
+//================================================================
+/*! check if the task refers the irep tree.
+*/
+static int task_refers( const mrbc_tcb *tcb, const mrbc_irep *root )
+{
+  const mrbc_vm *vm = &tcb->vm;
+
+  if( irep_contains( root, vm->irep ) ) return 1;
+  if( tcb->state == TASKSTATE_DORMANT ) return 0;  // not running.
+
+  if( vm->pc_irep && irep_contains( root, vm->pc_irep ) ) return 1;
+
+  const mrbc_callinfo *ci;
+  for( ci = vm->callinfo_tail; ci != NULL; ci = ci->prev ) {
+    if( irep_contains( root, ci->pc_irep ) ) return 1;
+  }
+
+  int i;
+  for( i = 0; i < MAX_REGS_SIZE; i++ ) {
+    const mrbc_value *v = &vm->regs[i];
+    if( v->tt != MRBC_TT_PROC || v->proc->c_func ) continue;
+    if( irep_contains( root, v->proc->irep ) ) return 1;
+  }
+
+  return 0;
+}
+
+
+//================================================================
+/*! check if any method refers the irep tree.
+*/
+static int method_refers( const mrbc_irep *root )
+{
+  mrbc_kv_iterator ite = mrbc_kv_iterator_new( mrbc_get_const_handle() );
+
+  while( mrbc_kv_i_has_next( &ite ) ) {
+    const mrbc_kv *kv = mrbc_kv_i_next( &ite );
+    if( kv->value.tt != MRBC_TT_CLASS ) continue;
+
+    const mrbc_proc *proc;
+    for( proc = kv->value.cls->procs; proc != NULL; proc = proc->next ) {
+      if( !proc->c_func && irep_contains( root, proc->irep ) ) return 1;
+    }
+  }
+
+  return 0;
+}
+
+
+//================================================================
+/*! move the irep tree to retired list.
+*/
+static void retire_irep( mrbc_irep *irep )
+{
+  irep_entry *e = mrbc_raw_alloc( sizeof(irep_entry) );
+  if( !e ) return;	// ENOMEM. leak it, safer than free.
+
+  e->bytecode = NULL;
+  e->irep = irep;
+  e->next = retired_list_;
+  retired_list_ = e;
+}
+
+
+//================================================================
+/*! release all objects and call frames of the task.
+
+  Like OP_STOP, but also for the task which is stopped in a method.
+  mrbc_vm_end() doesn't free them, unless MRBC_ALLOC_VMID is defined.
+*/
+static void release_task_objects( mrbc_vm *vm )
+{
+  int i;
+
+  while( vm->callinfo_tail != NULL ) {
+    mrbc_pop_callinfo( vm );
+  }
+
+  // all call frames are in regs[], and they are released here.
+  for( i = 0; i < MAX_REGS_SIZE; i++ ) {
+    mrbc_release( &vm->regs[i] );
+  }
+  mrbc_release( &vm->exc_message );
+  vm->exc_message = mrbc_nil_value();
+}
+
+
+//================================================================
+/*! check if the task owns or waits for a Mutex.
+
+  The restarted task would never unlock it, and the other tasks
+  which use the Mutex would wait forever.
+*/
+static int task_uses_mutex( const mrbc_tcb *tcb )
+{
+  if( tcb->state == TASKSTATE_WAITING && tcb->reason == TASKREASON_MUTEX ) {
+    return 1;
+  }
+  return tcb->n_mutex != 0;
+}
+
+
+//================================================================
+/*! replace the program of the task. (must be at safe point)
+*/
+static int replace_task_sub( mrbc_tcb *tcb, const uint8_t *vm_code )
+{
+  mrbc_vm *vm = &tcb->vm;
+  mrbc_irep *old_irep = vm->irep;
+  const uint8_t *old_mrb = vm->mrb;
+
+  vm->irep = NULL;
+  if( mrbc_load_mrb( vm, vm_code ) != 0 ) {
+    console_printf("Error: Illegal bytecode.\n");
+    if( vm->irep ) mrbc_irep_free( vm->irep );	// loaded, but not verified.
+    vm->irep = old_irep;
+    vm->mrb = old_mrb;
+    return -1;
+  }
+
+  // dormant task has already finished, and mrbc_start_task() begins it.
+  if( tcb->state != TASKSTATE_DORMANT ) {
+    release_task_objects( vm );
+    mrbc_vm_end( vm );
+    mrbc_vm_begin( vm );
+  }
+
+  if( old_irep ) retire_irep( old_irep );
+  mrbc_hotswap_collect();
+
+  return 0;
+}
+
+
+//================================================================
+/*! replace the program of the task.
+
+  The task restarts at the top of new program.
+  If the task is running (called from itself), the swap is postponed
+  to the end of current time slice. If the task owns or waits for
+  a Mutex, it is postponed until the task unlocks all Mutexes.
+
+  @param  tcb		target task.
+  @param  vm_code	new bytecode (.mrb or .mrbz).
+  @return int		zero if no error.
+*/
+int mrbc_replace_task( mrbc_tcb *tcb, const uint8_t *vm_code )
+{
+  if( tcb->state == TASKSTATE_RUNNING ) {
+    tcb->pending_code = vm_code;
+    tcb->vm.flag_preemption = 1;
+    return 0;
+  }
+  if( task_uses_mutex( tcb ) ) {
+    tcb->pending_code = vm_code;
+    return 0;
+  }
+
+  return replace_task_sub( tcb, vm_code );
+}
+
+
+//================================================================
+/*! reload library. (replace method definitions)
+
+  Methods are redefined by running the new code. Methods that are
+  not defined in the new code keep the old definition.
+
+  @param  old_code	bytecode given to mrbc_run_mrblib() before.
+  @param  new_code	new bytecode. (must be another image)
+  @return int		zero if no error.
+*/
+int mrbc_reload_mrblib( const uint8_t *old_code, const uint8_t *new_code )
+{
+  irep_entry **pp = &mrblib_list_;
+  while( *pp != NULL && (*pp)->bytecode != old_code ) {
+    pp = &(*pp)->next;
+  }
+  if( *pp == NULL || old_code == new_code ) {
+    console_printf("Error: mrblib is not loaded.\n");
+    return -1;
+  }
+
+  irep_entry *old = *pp;
+  mrbc_irep *top = mrblib_list_ ? mrblib_list_->irep : NULL;
+  mrbc_run_mrblib( new_code );
+  if( mrblib_list_ == NULL || mrblib_list_->irep == top ) return -1;
+
+  // unchain old entry, and move to retired list.
+  pp = &mrblib_list_;
+  while( *pp != old ) pp = &(*pp)->next;
+  *pp = old->next;
+
+  old->bytecode = NULL;
+  old->next = retired_list_;
+  retired_list_ = old;
+
+  mrbc_hotswap_collect();
+  return 0;
+}
+
+
+//================================================================
+/*! register the irep tree loaded by mrbc_run_mrblib()
+
+  @param  bytecode	given bytecode.
+  @param  irep		root irep.
+*/
+void mrbc_hotswap_register_mrblib( const uint8_t *bytecode, mrbc_irep *irep )
+{
+  irep_entry *e = mrbc_raw_alloc( sizeof(irep_entry) );
+  if( !e ) return;	// ENOMEM
+
+  e->bytecode = bytecode;
+  e->irep = irep;
+  e->next = mrblib_list_;
+  mrblib_list_ = e;
+}
+
+
+//================================================================
+/*! safe point. (called by the scheduler after each time slice)
+
+  @param  tcb	task which ran.
+  @return int	zero if swapped. not zero if postponed or error.
+*/
+int mrbc_hotswap_safe_point( mrbc_tcb *tcb )
+{
+  if( task_uses_mutex( tcb ) ) return 1;	// at the next safe point.
+
+  const uint8_t *vm_code = tcb->pending_code;
+  tcb->pending_code = NULL;
+
+  return replace_task_sub( tcb, vm_code );
+}
+
+
+//================================================================
+/*! free retired ireps which are no longer referred.
+
+  @return int	number of ireps still retired.
+*/
+int mrbc_hotswap_collect( void )
+{
+  int n = 0;
+  irep_entry **pp = &retired_list_;
+
+  while( *pp != NULL ) {
+    irep_entry *e = *pp;
+    int referred = method_refers( e->irep );
+
+    mrbc_tcb *tcb;
+    for( tcb = mrbc_next_task(NULL); tcb && !referred; tcb = mrbc_next_task(tcb) ) {
+      referred = task_refers( tcb, e->irep );
+    }
+
+    if( referred ) {
+      pp = &e->next;
+      n++;
+      continue;
+    }
+
+    *pp = e->next;
+    mrbc_irep_free( e->irep );
+    mrbc_raw_free( e );
+  }
+
+  return n;
+}
+
+#endif // MRBC_USE_HOT_SWAP
@@ -0,0 +1,35 @@
+/*! @file
+  @brief
+  Hot code swap. (replace bytecode without restarting the scheduler)
+
+  <pre>
+  Copyright (C) 2015-2020 Kyushu Institute of Technology.
+  Copyright (C) 2015-2020 Shimane IT Open-Innovation Center.
+
+  This file is distributed under BSD 3-Clause License.
+
+  </pre>
+*/
+
+#ifndef MRBC_SRC_HOTSWAP_H_
+#define MRBC_SRC_HOTSWAP_H_
+
+#include <stdint.h>
+#include "vm.h"
+#include "rrt0.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+int mrbc_replace_task(mrbc_tcb *tcb, const uint8_t *vm_code);
+int mrbc_reload_mrblib(const uint8_t *old_code, const uint8_t *new_code);
+void mrbc_hotswap_register_mrblib(const uint8_t *bytecode, mrbc_irep *irep);
+int mrbc_hotswap_safe_point(mrbc_tcb *tcb);
+int mrbc_hotswap_collect(void);
+
+
+#ifdef __cplusplus
+}
+#endif
+#endif
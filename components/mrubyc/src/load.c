@@ -19,9 +19,12 @@
 
 #include "vm.h"
 #include "load.h"
+#include "opcode.h"
 #include "value.h"
 #include "alloc.h"
 #include "console.h"
+#include "decompress.h"
+#include "verify.h"
 
 //
 // This is a dummy code for raise
@@ -75,6 +78,182 @@ static int load_header(struct VM *vm, const uint8_t **pos)
 
 
 
+//================================================================
+/*! decode one instruction.
+
+  @param  irep	target irep.
+  @param  pc	position of the instruction.
+  @param  op	returns opcode.
+  @param  opr	returns operands.
+  @return	position of the next instruction, or -1 if error.
+*/
+static int decode_inst( const mrbc_irep *irep, int pc, int *op, uint32_t opr[3] )
+{
+  int ext = 0;
+
+  *op = irep->code[pc++];
+  if( OP_EXT1 <= *op && *op <= OP_EXT3 ) {
+    if( pc >= irep->ilen ) return -1;
+    ext = *op - OP_EXT1 + 1;
+    *op = irep->code[pc++];
+  }
+  if( *op > OP_ABORT ) return -1;
+
+  int len = mrbc_decode_operands( irep, pc, *op, ext, opr );
+  if( len < 0 ) return -1;
+
+  return pc + len;
+}
+
+
+//================================================================
+/*! find the end of the region protected by OP_EPUSH.
+
+  Follow the control flow from the beginning of the region, and it
+  ends at OP_EPOP which pops this ensure clause.
+
+  @param  irep	target irep.
+  @param  begin	beginning of the region.
+  @param  depth	work area. (irep->ilen bytes)
+  @param  stack	work area. (irep->ilen entries)
+  @return	end of the region, or -1 if error.
+*/
+static int ensure_region_end( const mrbc_irep *irep, int begin,
+			      uint8_t *depth, uint16_t *stack )
+{
+  int end = begin;
+  int sp = 0;
+  int pc, op;
+  uint32_t opr[3];
+
+  memset( depth, 0xff, irep->ilen );	// 0xff: not visited.
+  if( begin >= irep->ilen ) return -1;
+  depth[begin] = 0;			// # of inner ensure clauses.
+  stack[sp++] = begin;
+
+  while( sp > 0 ) {
+    pc = stack[--sp];
+    int d = depth[pc];
+
+    while( 1 ) {
+      int next = decode_inst( irep, pc, &op, opr );
+      if( next < 0 ) return -1;
+      if( end < next ) end = next;
+
+      int branch = -1;
+      switch( op ) {
+      case OP_EPUSH:
+	if( ++d >= 0xff ) return -1;
+	break;
+
+      case OP_EPOP:
+	if( opr[0] > d ) next = -1;	// pops this ensure clause.
+	else d -= opr[0];
+	break;
+
+      case OP_JMP:	next = opr[0]; break;
+      case OP_JMPIF:	// fall through
+      case OP_JMPNOT:	// fall through
+      case OP_JMPNIL:	branch = opr[1]; break;
+      case OP_ONERR:	branch = opr[0]; break;
+
+      case OP_RETURN:	// fall through
+      case OP_RETURN_BLK: // fall through
+      case OP_BREAK:	// fall through
+      case OP_RAISE:	// fall through
+      case OP_ERR:	// fall through
+      case OP_STOP:	// fall through
+      case OP_ABORT:	next = -1; break;
+      }
+
+      if( branch >= 0 ) {
+	if( branch >= irep->ilen ) return -1;
+	if( depth[branch] == 0xff ) {
+	  depth[branch] = d;
+	  stack[sp++] = branch;
+	}
+      }
+
+      if( next < 0 ) break;
+      if( next >= irep->ilen ) return -1;
+      if( depth[next] != 0xff ) break;
+      depth[next] = d;
+      pc = next;
+    }
+  }
+
+  return end;
+}
+
+
+//================================================================
+/*! make the exception handler table of irep.
+
+  <pre>
+  OP_ONERR  protects from the next instruction to the jump address,
+            where the rescue clause begins.
+  OP_EPUSH  protects from the next instruction to OP_EPOP which pops it.
+  </pre>
+
+  @param  irep	target irep.
+  @return	zero if no error.
+*/
+static int load_handlers( mrbc_irep *irep )
+{
+  int n = 0, n_ensure = 0;
+  int pc, op;
+  uint32_t opr[3];
+
+  for( pc = 0; pc < irep->ilen; ) {
+    pc = decode_inst( irep, pc, &op, opr );
+    if( pc < 0 ) return -1;
+    if( op == OP_ONERR ) n++;
+    if( op == OP_EPUSH ) { n++; n_ensure++; }
+  }
+  if( n == 0 ) return 0;
+  if( n > 0xff ) return -1;
+
+  irep->handlers = mrbc_alloc(0, sizeof(mrbc_irep_handler) * n);
+  if( irep->handlers == NULL ) return -1;
+  irep->hlen = n;
+
+  uint16_t *stack = NULL;
+  if( n_ensure ) {
+    stack = mrbc_alloc(0, (sizeof(uint16_t) + 1) * irep->ilen);
+    if( stack == NULL ) return -1;
+  }
+
+  int ret = 0;
+  mrbc_irep_handler *h = irep->handlers;
+  for( pc = 0; pc < irep->ilen; ) {
+    int next = decode_inst( irep, pc, &op, opr );
+
+    if( op == OP_ONERR ) {
+      h->type = MRBC_HANDLER_RESCUE;
+      h->begin = next;
+      h->end = opr[0];
+      h->target = opr[0];
+      if( h->end < h->begin || h->end > irep->ilen ) ret = -1;
+      h++;
+    }
+    if( op == OP_EPUSH ) {
+      int end = ensure_region_end( irep, next,
+				   (uint8_t *)(stack + irep->ilen), stack );
+      h->type = MRBC_HANDLER_ENSURE;
+      h->begin = next;
+      h->end = end;
+      h->target = opr[0];
+      if( end < 0 || opr[0] >= irep->rlen ) ret = -1;
+      h++;
+    }
+    pc = next;
+  }
+
+  if( stack ) mrbc_raw_free( stack );
+  return ret;
+}
+
+
 //================================================================
 /*! read one irep section.
 
@@ -137,6 +316,12 @@ static mrbc_irep * load_irep_1(struct VM *vm, const uint8_t **pos)
   irep->code = (uint8_t *)p;
   p += irep->ilen;
 
+  // exception handlers
+  if( load_handlers( irep ) != 0 ) {
+    mrbc_raise(vm, E_BYTECODE_ERROR, NULL);
+    return NULL;
+  }
+
   // POOL BLOCK
   irep->plen = bin_to_uint32(p);	p += 4;
   if( irep->plen ) {
@@ -167,8 +352,16 @@ static mrbc_irep * load_irep_1(struct VM *vm, const uint8_t **pos)
       char buf[obj_size+1];
       memcpy(buf, p, obj_size);
       buf[obj_size] = '\0';
+      long long n = strtoll(buf, NULL, 10);
+#if MRBC_USE_FLOAT
+      if( n < MRBC_INT_MIN || MRBC_INT_MAX < n ) {	// too large for Integer.
+	obj->tt = MRBC_TT_FLOAT;
+	obj->d = mrbc_atof(buf);
+	break;
+      }
+#endif
       obj->tt = MRBC_TT_FIXNUM;
-      obj->i = atol(buf);
+      obj->i = n;
     } break;
 #if MRBC_USE_FLOAT
     case 2: { // IREP_TT_FLOAT
@@ -176,7 +369,7 @@ static mrbc_irep * load_irep_1(struct VM *vm, const uint8_t **pos)
       memcpy(buf, p, obj_size);
       buf[obj_size] = '\0';
       obj->tt = MRBC_TT_FLOAT;
-      obj->d = atof(buf);
+      obj->d = mrbc_atof(buf);
     } break;
 #endif
     default:
@@ -276,6 +469,39 @@ static int load_lvar(struct VM *vm, const uint8_t **pos)
 }
 
 
+#if MRBC_USE_COMPRESSED_MRB
+//================================================================
+/*! decompress .mrbz image into RAM.
+
+  The returned image is owned by the root irep, and freed with the ireps.
+
+  @param  src	pointer to .mrbz image.
+  @return	pointer to .mrb image, or NULL if error.
+*/
+static uint8_t * load_compressed_image(const uint8_t *src)
+{
+  uint32_t size, zsize;
+  int window_sz2, lookahead_sz2;
+
+  if( mrbc_decompress_header( src, &size, &zsize, &window_sz2, &lookahead_sz2 ) != 0 ) {
+    return NULL;
+  }
+
+  uint8_t *dst = mrbc_raw_alloc( size );
+  if( !dst ) return NULL;	// ENOMEM
+
+  mrbc_decompress d;
+  mrbc_decompress_init( &d, dst, size, window_sz2, lookahead_sz2 );
+  if( mrbc_decompress_feed( &d, src + MRBC_MRBZ_HEADER_SIZE, zsize ) != 1 ) {
+    mrbc_raw_free( dst );
+    return NULL;
+  }
+
+  return dst;
+}
+#endif
+
+
 //================================================================
 /*! Load the VM bytecode.
 
@@ -286,6 +512,17 @@ static int load_lvar(struct VM *vm, const uint8_t **pos)
 int mrbc_load_mrb(struct VM *vm, const uint8_t *ptr)
 {
   int ret = -1;
+
+#if MRBC_USE_COMPRESSED_MRB
+  uint8_t *image = NULL;
+  if( mrbc_is_compressed_image(ptr) ) {
+    ptr = image = load_compressed_image(ptr);
+    if( !ptr ) {
+      mrbc_raise(vm, E_BYTECODE_ERROR, NULL);
+      return -1;
+    }
+  }
+#endif
   vm->mrb = ptr;
 
   ret = load_header(vm, &ptr);
@@ -301,5 +538,27 @@ int mrbc_load_mrb(struct VM *vm, const uint8_t *ptr)
     }
   }
 
+#if MRBC_USE_COMPRESSED_MRB
+  // the image lives as long as the ireps.
+  if( image ) {
+    if( ret == 0 && vm->irep ) {
+      vm->irep->image = image;
+    } else {
+      mrbc_raw_free( image );
+    }
+  }
+#endif
+
+#if MRBC_USE_VERIFIER
+  if( ret == 0 ) {
+    mrbc_verify_info info;
+    int code = mrbc_verify_irep( vm->irep, &info );
+    if( code != 0 ) {
+      mrbc_verify_print_error( &info, code );
+      ret = -1;
+    }
+  }
+#endif
+
   return ret;
 }
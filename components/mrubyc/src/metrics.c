@@ -0,0 +1,468 @@
+/*! @file
+  @brief
+  Runtime metrics registry. (counters, gauges and histograms)
+
+  <pre>
+  Copyright (C) 2015-2020 Kyushu Institute of Technology.
+  Copyright (C) 2015-2020 Shimane IT Open-Innovation Center.
+
+  This file is distributed under BSD 3-Clause License.
+
+  (usage)
+  // C
+  MRBC_METRIC_COUNTER( rx_frames, "uart.rx" );
+  mrbc_metric_register( &rx_frames );	// once, at init.
+  mrbc_metric_inc( &rx_frames );	// also from ISRs.
+
+  # Ruby
+  id = Metrics.counter("app.loops")
+  Metrics.histogram("app.loop_ms", [1, 10, 100])
+  Metrics.inc(id)
+  Metrics.observe("app.loop_ms", 7)
+  Metrics["uart.rx"]		# => 42
+  Metrics.snapshot		# print a snapshot line.
+
+  Snapshot line: "@M <tick> name=value ... name=count/sum/b0,b1,..,bn"
+  Metrics are registered once and never removed, so the ids are stable.
+  The VM, the allocator and the scheduler register built-in metrics
+  ("vm.*", "heap.*", "sched.*").
+  </pre>
+*/
+
+#include "vm_config.h"
+#include <stdint.h>
+#include <string.h>
+
+#include "value.h"
+#include "vm.h"
+#include "alloc.h"
+#include "static.h"
+#include "class.h"
+#include "symbol.h"
+#include "console.h"
+#include "rrt0.h"
+#include "hal/hal.h"
+#include "c_string.h"
+#include "c_array.h"
+#include "c_hash.h"
+#include "metrics.h"
+
+#if MRBC_USE_METRICS
+
+static mrbc_metric *registry[MRBC_METRICS_MAX];
+static int n_metrics;
+
+
+//================================================================
+/*! built-in metrics.
+*/
+MRBC_METRIC_GAUGE( mrbc_metric_vm_open, "vm.open" );
+MRBC_METRIC_COUNTER( mrbc_metric_vm_exceptions, "vm.exceptions" );
+MRBC_METRIC_COUNTER( mrbc_metric_sched_switches, "sched.switches" );
+MRBC_METRIC_COUNTER( mrbc_metric_sched_idle, "sched.idle" );
+
+#if MRBC_ALLOC_STATS && !defined(MRBC_ALLOC_LIBC)
+static int32_t read_heap_used(void) { return mrbc_alloc_counter.used; }
+static int32_t read_heap_peak(void) { return mrbc_alloc_counter.max_used; }
+static int32_t read_heap_allocs(void) { return mrbc_alloc_counter.n_alloc; }
+static int32_t read_heap_fails(void) { return mrbc_alloc_counter.n_fail; }
+#endif
+static int32_t read_sched_ticks(void) { return mrbc_get_tick(); }
+
+static int32_t read_sched_tasks(void)
+{
+  mrbc_tcb *tcb = NULL;
+  int n = 0;
+  while( (tcb = mrbc_next_task( tcb )) != NULL ) {
+    if( tcb->state != TASKSTATE_DORMANT ) n++;
+  }
+  return n;
+}
+
+static mrbc_metric builtin_sampled[] = {
+#if MRBC_ALLOC_STATS && !defined(MRBC_ALLOC_LIBC)
+  { .name = "heap.used", .type = MRBC_METRIC_GAUGE, .read = read_heap_used },
+  { .name = "heap.peak", .type = MRBC_METRIC_GAUGE, .read = read_heap_peak },
+  { .name = "heap.allocs", .type = MRBC_METRIC_COUNTER, .read = read_heap_allocs },
+  { .name = "heap.fails", .type = MRBC_METRIC_COUNTER, .read = read_heap_fails },
+#endif
+  { .name = "sched.ticks", .type = MRBC_METRIC_COUNTER, .read = read_sched_ticks },
+  { .name = "sched.tasks", .type = MRBC_METRIC_GAUGE, .read = read_sched_tasks },
+};
+
+
+//================================================================
+/*! register a metric.
+
+  @param  m	metric. (static storage)
+  @return	id, or -1 if the registry is full.
+*/
+int mrbc_metric_register(mrbc_metric *m)
+{
+  int id;
+
+  hal_disable_irq();
+  for( id = 0; id < n_metrics; id++ ) {
+    if( registry[id] == m ) goto DONE;
+  }
+  if( n_metrics == MRBC_METRICS_MAX ) {
+    id = -1;
+    goto DONE;
+  }
+  registry[n_metrics++] = m;
+
+ DONE:
+  hal_enable_irq();
+  if( id < 0 ) console_printf("Error: too many metrics. (%s)\n", m->name);
+  return id;
+}
+
+
+//================================================================
+/*! find the id of a metric by name.
+
+  @return	id, or -1 if not found.
+*/
+static int find_id(const char *name)
+{
+  int i;
+  for( i = 0; i < n_metrics; i++ ) {
+    if( strcmp( registry[i]->name, name ) == 0 ) return i;
+  }
+  return -1;
+}
+
+
+//================================================================
+/*! find a metric by name.
+*/
+mrbc_metric *mrbc_metric_find(const char *name)
+{
+  int id = find_id( name );
+  return id < 0 ? NULL : registry[id];
+}
+
+
+//================================================================
+/*! get a metric by id.
+*/
+mrbc_metric *mrbc_metric_get(int id)
+{
+  return (id >= 0 && id < n_metrics) ? registry[id] : NULL;
+}
+
+
+//================================================================
+/*! current value. (sum for a histogram)
+*/
+int32_t mrbc_metric_value(const mrbc_metric *m)
+{
+  return m->read ? m->read() : m->value;
+}
+
+
+//================================================================
+/*! print a snapshot line of all metrics.
+*/
+void mrbc_metrics_snapshot(void)
+{
+  int i, j;
+
+  console_printf("@M %u", mrbc_get_tick());
+  for( i = 0; i < n_metrics; i++ ) {
+    const mrbc_metric *m = registry[i];
+    int32_t v = mrbc_metric_value( m );
+
+    switch( m->type ) {
+    case MRBC_METRIC_COUNTER:
+      console_printf(" %s=%u", m->name, (uint32_t)v);
+      break;
+
+    case MRBC_METRIC_GAUGE:
+      console_printf(" %s=%d", m->name, v);
+      break;
+
+    case MRBC_METRIC_HISTOGRAM: {
+      uint32_t count = 0;
+      for( j = 0; j <= m->n_bounds; j++ ) count += m->buckets[j];
+      console_printf(" %s=%u/%d/", m->name, count, v);
+      for( j = 0; j <= m->n_bounds; j++ ) {
+	console_printf(j ? ",%u" : "%u", m->buckets[j]);
+      }
+    } break;
+    }
+  }
+  console_printf("\n");
+}
+
+
+//================================================================
+/*! get the metric of a Ruby argument. (id, String or Symbol)
+*/
+static mrbc_metric *arg_metric(const mrbc_value *v)
+{
+  int id = -1;
+
+  switch( v->tt ) {
+  case MRBC_TT_FIXNUM:	id = v->i; break;
+  case MRBC_TT_SYMBOL:	id = find_id( mrbc_symbol_cstr( v ) ); break;
+#if MRBC_USE_STRING
+  case MRBC_TT_STRING:	id = find_id( mrbc_string_cstr( v ) ); break;
+#endif
+  default: break;
+  }
+
+  mrbc_metric *m = mrbc_metric_get( id );
+  if( !m ) console_printf("ArgumentError: no such metric\n");
+  return m;
+}
+
+
+//================================================================
+/*! create a metric from Ruby, or get the existing one.
+
+  @return	id, or -1 if error.
+*/
+static int new_metric(struct VM *vm, mrbc_value v[], int argc, int type)
+{
+  const char *name = NULL;
+  if( argc >= 1 && v[1].tt == MRBC_TT_SYMBOL ) name = mrbc_symbol_cstr( &v[1] );
+#if MRBC_USE_STRING
+  if( argc >= 1 && v[1].tt == MRBC_TT_STRING ) name = mrbc_string_cstr( &v[1] );
+#endif
+  if( !name ) {
+    console_printf("ArgumentError: metric name\n");
+    return -1;
+  }
+
+  int id = find_id( name );
+  if( id >= 0 ) {
+    if( registry[id]->type == type ) return id;
+    console_printf("ArgumentError: %s is another type of metric\n", name);
+    return -1;
+  }
+
+  // bounds of a histogram.
+  int n_bounds = 0;
+  if( type == MRBC_METRIC_HISTOGRAM ) {
+    if( argc < 2 || v[2].tt != MRBC_TT_ARRAY ) {
+      console_printf("ArgumentError: histogram needs bounds\n");
+      return -1;
+    }
+    n_bounds = mrbc_array_size( &v[2] );
+    if( n_bounds > UINT8_MAX ) n_bounds = UINT8_MAX;
+  }
+
+  // metric, name, bounds and buckets in one block. (never freed)
+  int name_len = strlen( name ) + 1;
+  int size = sizeof(mrbc_metric) + sizeof(int32_t) * (n_bounds * 2 + 1)
+    + name_len;
+  mrbc_metric *m = mrbc_raw_alloc( size );
+  if( !m ) return -1;
+  memset( m, 0, size );
+
+  int32_t *bounds = (int32_t *)(m + 1);
+  uint32_t *buckets = (uint32_t *)(bounds + n_bounds);
+  char *s = (char *)(buckets + n_bounds + 1);
+  int i;
+  for( i = 0; i < n_bounds; i++ ) {
+    mrbc_value b = mrbc_array_get( &v[2], i );
+    bounds[i] = (b.tt == MRBC_TT_FIXNUM) ? b.i : 0;
+  }
+  memcpy( s, name, name_len );
+
+  m->name = s;
+  m->type = type;
+  m->n_bounds = n_bounds;
+  m->bounds = bounds;
+  m->buckets = buckets;
+
+  id = mrbc_metric_register( m );
+  if( id < 0 ) mrbc_raw_free( m );
+  return id;
+}
+
+
+//================================================================
+/*! (method) Metrics.counter(name)	returns id.
+*/
+static void c_metrics_counter(struct VM *vm, mrbc_value v[], int argc)
+{
+  int id = new_metric( vm, v, argc, MRBC_METRIC_COUNTER );
+  if( id < 0 ) {
+    SET_NIL_RETURN();
+  } else {
+    SET_INT_RETURN( id );
+  }
+}
+
+
+//================================================================
+/*! (method) Metrics.gauge(name)	returns id.
+*/
+static void c_metrics_gauge(struct VM *vm, mrbc_value v[], int argc)
+{
+  int id = new_metric( vm, v, argc, MRBC_METRIC_GAUGE );
+  if( id < 0 ) {
+    SET_NIL_RETURN();
+  } else {
+    SET_INT_RETURN( id );
+  }
+}
+
+
+//================================================================
+/*! (method) Metrics.histogram(name, [bounds...])	returns id.
+*/
+static void c_metrics_histogram(struct VM *vm, mrbc_value v[], int argc)
+{
+  int id = new_metric( vm, v, argc, MRBC_METRIC_HISTOGRAM );
+  if( id < 0 ) {
+    SET_NIL_RETURN();
+  } else {
+    SET_INT_RETURN( id );
+  }
+}
+
+
+//================================================================
+/*! (method) Metrics.inc(metric, n = 1)	counter or gauge.
+*/
+static void c_metrics_inc(struct VM *vm, mrbc_value v[], int argc)
+{
+  mrbc_metric *m = argc >= 1 ? arg_metric( &v[1] ) : NULL;
+  int32_t n = (argc >= 2 && v[2].tt == MRBC_TT_FIXNUM) ? v[2].i : 1;
+
+  if( m && !m->read && m->type != MRBC_METRIC_HISTOGRAM ) {
+    mrbc_metric_add( m, n );
+  }
+  SET_NIL_RETURN();
+}
+
+
+//================================================================
+/*! (method) Metrics.set(metric, value)	gauge.
+*/
+static void c_metrics_set(struct VM *vm, mrbc_value v[], int argc)
+{
+  mrbc_metric *m = argc >= 1 ? arg_metric( &v[1] ) : NULL;
+
+  if( m && !m->read && m->type == MRBC_METRIC_GAUGE &&
+      argc >= 2 && v[2].tt == MRBC_TT_FIXNUM ) {
+    mrbc_metric_set( m, v[2].i );
+  }
+  SET_NIL_RETURN();
+}
+
+
+//================================================================
+/*! (method) Metrics.observe(metric, value)	histogram.
+*/
+static void c_metrics_observe(struct VM *vm, mrbc_value v[], int argc)
+{
+  mrbc_metric *m = argc >= 1 ? arg_metric( &v[1] ) : NULL;
+
+  if( m && m->type == MRBC_METRIC_HISTOGRAM &&
+      argc >= 2 && v[2].tt == MRBC_TT_FIXNUM ) {
+    mrbc_metric_observe( m, v[2].i );
+  }
+  SET_NIL_RETURN();
+}
+
+
+//================================================================
+/*! get the value for Ruby. (Array of bucket counts for a histogram)
+*/
+static mrbc_value metric_value(struct VM *vm, const mrbc_metric *m)
+{
+  if( m->type != MRBC_METRIC_HISTOGRAM ) {
+    return mrbc_fixnum_value( mrbc_metric_value( m ) );
+  }
+
+  mrbc_value ret = mrbc_array_new( vm, m->n_bounds + 1 );
+  int i;
+  for( i = 0; i <= m->n_bounds; i++ ) {
+    mrbc_value n = mrbc_fixnum_value( m->buckets[i] );
+    mrbc_array_push( &ret, &n );
+  }
+  return ret;
+}
+
+
+//================================================================
+/*! (method) Metrics[metric]
+*/
+static void c_metrics_get(struct VM *vm, mrbc_value v[], int argc)
+{
+  mrbc_metric *m = argc >= 1 ? arg_metric( &v[1] ) : NULL;
+
+  if( m ) {
+    SET_RETURN( metric_value( vm, m ) );
+  } else {
+    SET_NIL_RETURN();
+  }
+}
+
+
+//================================================================
+/*! (method) Metrics.to_h	{"name"=>value, ...}
+*/
+static void c_metrics_to_h(struct VM *vm, mrbc_value v[], int argc)
+{
+  mrbc_value ret = mrbc_hash_new( vm, n_metrics );
+  int i;
+
+  for( i = 0; i < n_metrics; i++ ) {
+#if MRBC_USE_STRING
+    mrbc_value key = mrbc_string_new_cstr( vm, registry[i]->name );
+#else
+    mrbc_value key = mrbc_fixnum_value( i );
+#endif
+    mrbc_value val = metric_value( vm, registry[i] );
+    mrbc_hash_set( &ret, &key, &val );
+  }
+
+  SET_RETURN( ret );
+}
+
+
+//================================================================
+/*! (method) Metrics.snapshot
+*/
+static void c_metrics_snapshot(struct VM *vm, mrbc_value v[], int argc)
+{
+  mrbc_metrics_snapshot();
+  SET_NIL_RETURN();
+}
+
+
+
+//================================================================
+/*! initialize, and register the built-in metrics.
+*/
+void mrbc_init_class_metrics(struct VM *vm)
+{
+  int i;
+
+  mrbc_metric_register( &mrbc_metric_vm_open );
+  mrbc_metric_register( &mrbc_metric_vm_exceptions );
+  mrbc_metric_register( &mrbc_metric_sched_switches );
+  mrbc_metric_register( &mrbc_metric_sched_idle );
+  for( i = 0; i < sizeof(builtin_sampled)/sizeof(builtin_sampled[0]); i++ ) {
+    mrbc_metric_register( &builtin_sampled[i] );
+  }
+
+  mrbc_class *cls = mrbc_define_class(vm, "Metrics", mrbc_class_object);
+
+  mrbc_define_method(vm, cls, "counter", c_metrics_counter);
+  mrbc_define_method(vm, cls, "gauge", c_metrics_gauge);
+  mrbc_define_method(vm, cls, "histogram", c_metrics_histogram);
+  mrbc_define_method(vm, cls, "inc", c_metrics_inc);
+  mrbc_define_method(vm, cls, "set", c_metrics_set);
+  mrbc_define_method(vm, cls, "observe", c_metrics_observe);
+  mrbc_define_method(vm, cls, "[]", c_metrics_get);
+  mrbc_define_method(vm, cls, "to_h", c_metrics_to_h);
+  mrbc_define_method(vm, cls, "snapshot", c_metrics_snapshot);
+}
+
+#endif  // MRBC_USE_METRICS
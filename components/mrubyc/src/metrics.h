@@ -0,0 +1,124 @@
+/*! @file
+  @brief
+  Runtime metrics registry. (counters, gauges and histograms)
+
+  <pre>
+  Copyright (C) 2015-2020 Kyushu Institute of Technology.
+  Copyright (C) 2015-2020 Shimane IT Open-Innovation Center.
+
+  This file is distributed under BSD 3-Clause License.
+
+  </pre>
+*/
+
+#ifndef MRBC_SRC_METRICS_H_
+#define MRBC_SRC_METRICS_H_
+
+#include <stdint.h>
+#include "vm_config.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#if MRBC_USE_METRICS
+
+struct VM;
+
+enum MrbcMetricType {
+  MRBC_METRIC_COUNTER = 0,
+  MRBC_METRIC_GAUGE,
+  MRBC_METRIC_HISTOGRAM,
+};
+
+
+//================================================================
+/*!@brief
+  Metric.
+
+  Updates are single atomic operations on 32-bit words, so they may be
+  done from ISRs and tasks without a lock. A histogram counts the values
+  v <= bounds[i] in buckets[i], and the others in buckets[n_bounds].
+*/
+typedef struct METRIC {
+  const char *name;
+  uint8_t type;			//!< enum MrbcMetricType
+  uint8_t n_bounds;		//!< # of bounds of a histogram.
+  volatile int32_t value;	//!< count, gauge value, or sum of a histogram.
+  const int32_t *bounds;	//!< upper bounds of the buckets, ascending.
+  volatile uint32_t *buckets;	//!< n_bounds + 1 counts.
+  int32_t (*read)(void);	//!< sampled at snapshot, if not NULL.
+} mrbc_metric;
+
+
+//================================================================
+/*! define a metric in C. (register it with mrbc_metric_register)
+
+  MRBC_METRIC_COUNTER( rx_frames, "uart.rx" );
+  MRBC_METRIC_HISTOGRAM( latency, "uart.latency_us", 100, 1000, 10000 );
+*/
+#define MRBC_METRIC_COUNTER(var, name_)					\
+  mrbc_metric var = { .name = (name_), .type = MRBC_METRIC_COUNTER }
+
+#define MRBC_METRIC_GAUGE(var, name_)					\
+  mrbc_metric var = { .name = (name_), .type = MRBC_METRIC_GAUGE }
+
+#define MRBC_METRIC_HISTOGRAM(var, name_, ...)				\
+  static const int32_t var##_bounds_[] = { __VA_ARGS__ };		\
+  static uint32_t var##_buckets_[sizeof(var##_bounds_) / sizeof(int32_t) + 1]; \
+  mrbc_metric var = { .name = (name_), .type = MRBC_METRIC_HISTOGRAM,	\
+    .n_bounds = sizeof(var##_bounds_) / sizeof(int32_t),		\
+    .bounds = var##_bounds_, .buckets = var##_buckets_ }
+
+
+//================================================================
+/*! add to a counter or a gauge.
+*/
+static inline void mrbc_metric_add(mrbc_metric *m, int32_t n)
+{
+  __atomic_fetch_add( &m->value, n, __ATOMIC_RELAXED );
+}
+
+//================================================================
+/*! set a gauge.
+*/
+static inline void mrbc_metric_set(mrbc_metric *m, int32_t v)
+{
+  __atomic_store_n( &m->value, v, __ATOMIC_RELAXED );
+}
+
+//================================================================
+/*! count a value in a histogram.
+*/
+static inline void mrbc_metric_observe(mrbc_metric *m, int32_t v)
+{
+  int i;
+  for( i = 0; i < m->n_bounds && v > m->bounds[i]; i++ ) {
+  }
+  __atomic_fetch_add( &m->buckets[i], 1, __ATOMIC_RELAXED );
+  __atomic_fetch_add( &m->value, v, __ATOMIC_RELAXED );
+}
+
+#define mrbc_metric_inc(m)	mrbc_metric_add( (m), 1 )
+
+
+// built-in metrics.
+extern mrbc_metric mrbc_metric_vm_open;
+extern mrbc_metric mrbc_metric_vm_exceptions;
+extern mrbc_metric mrbc_metric_sched_switches;
+extern mrbc_metric mrbc_metric_sched_idle;
+
+int mrbc_metric_register(mrbc_metric *m);
+mrbc_metric *mrbc_metric_find(const char *name);
+mrbc_metric *mrbc_metric_get(int id);
+int32_t mrbc_metric_value(const mrbc_metric *m);
+void mrbc_metrics_snapshot(void);
+void mrbc_init_class_metrics(struct VM *vm);
+
+#endif  // MRBC_USE_METRICS
+
+
+#ifdef __cplusplus
+}
+#endif
+#endif
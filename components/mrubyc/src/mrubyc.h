@@ -28,9 +28,24 @@
 #include "c_numeric.h"
 #include "c_range.h"
 #include "c_string.h"
+#include "c_struct.h"
+#include "c_ringbuffer.h"
+#include "c_fixed.h"
+#include "c_log.h"
+#include "c_benchmark.h"
 
 #include "load.h"
 #include "console.h"
 #include "rrt0.h"
+#include "bundle.h"
+#include "hotswap.h"
+#include "verify.h"
+#include "opstat.h"
+#include "profiler.h"
+#include "metrics.h"
+#include "objspace.h"
+#include "analyze.h"
+#include "bind.h"
+#include "pool.h"
 
 #endif
@@ -0,0 +1,205 @@
+/*! @file
+  @brief
+  Live object counters by type and by class. (ObjectSpace)
+
+  <pre>
+  Copyright (C) 2015-2020 Kyushu Institute of Technology.
+  Copyright (C) 2015-2020 Shimane IT Open-Innovation Center.
+
+  This file is distributed under BSD 3-Clause License.
+
+  (usage)
+  ObjectSpace.count_objects	# {:T_OBJECT=>3, :T_STRING=>40, ..., :TOTAL=>60}
+  ObjectSpace.count_objects_by_class	# {Foo=>2, Bar=>1}
+
+  ObjectSpace.watch		# take a snapshot of the counts.
+  run_something
+  ObjectSpace.report		# print the growth from the snapshot.
+  # ObjectSpace: String +12 (40 -> 52)
+  # ObjectSpace: Foo +1 (2 -> 3)
+
+  The constructors and the destructors count the objects, one increment
+  or decrement each, so the counts are always current and nothing walks
+  the heap. Tasks switch only between instructions, so no lock is needed.
+  Instances are counted by class too. (Struct classes are not listed,
+  because they have no name of their own)
+  The objects which are left when a VM ends are freed at once by
+  mrbc_free_all, and stay in the counts.
+  </pre>
+*/
+
+#include "vm_config.h"
+#include <stdint.h>
+
+#include "value.h"
+#include "vm.h"
+#include "alloc.h"
+#include "static.h"
+#include "class.h"
+#include "symbol.h"
+#include "global.h"
+#include "keyvalue.h"
+#include "console.h"
+#include "c_hash.h"
+#include "objspace.h"
+
+#if MRBC_USE_OBJSPACE
+
+uint32_t mrbc_objspace_live[MRBC_OBJSPACE_N_TYPES];
+static uint32_t objspace_watch[MRBC_OBJSPACE_N_TYPES];
+
+static const char * const type_names[MRBC_OBJSPACE_N_TYPES] = {
+  "Object", "Proc", "Array", "String", "Range", "Hash",
+};
+static const char * const type_keys[MRBC_OBJSPACE_N_TYPES] = {
+  "T_OBJECT", "T_PROC", "T_ARRAY", "T_STRING", "T_RANGE", "T_HASH",
+};
+
+
+//================================================================
+/*! get the next class which has a name, in the constant table.
+
+  @param  ite	iterator of the constant table.
+  @return	pointer to class, or NULL if no more.
+*/
+static mrbc_class * next_class( mrbc_kv_iterator *ite )
+{
+  while( mrbc_kv_i_has_next( ite ) ) {
+    const mrbc_kv *kv = mrbc_kv_i_next( ite );
+    if( kv->value.tt != MRBC_TT_CLASS ) continue;
+    if( kv->value.cls->sym_id != kv->sym_id ) continue;	// alias.
+    return kv->value.cls;
+  }
+  return NULL;
+}
+
+
+//================================================================
+/*! take a snapshot of the counts, to be compared by mrbc_objspace_report.
+*/
+void mrbc_objspace_watch(void)
+{
+  mrbc_kv_iterator ite = mrbc_kv_iterator_new( mrbc_get_const_handle() );
+  mrbc_class *cls;
+  int i;
+
+  for( i = 0; i < MRBC_OBJSPACE_N_TYPES; i++ ) {
+    objspace_watch[i] = mrbc_objspace_live[i];
+  }
+  while( (cls = next_class( &ite )) != NULL ) {
+    cls->n_watch = cls->n_live;
+  }
+}
+
+
+//================================================================
+/*! print the types and the classes which grew from the snapshot.
+
+  @return	total growth of the objects.
+*/
+int mrbc_objspace_report(void)
+{
+  mrbc_kv_iterator ite = mrbc_kv_iterator_new( mrbc_get_const_handle() );
+  mrbc_class *cls;
+  int total = 0;
+  int i;
+
+  for( i = 0; i < MRBC_OBJSPACE_N_TYPES; i++ ) {
+    int diff = (int)(mrbc_objspace_live[i] - objspace_watch[i]);
+    if( diff > 0 ) {
+      console_printf("ObjectSpace: %s +%d (%d -> %d)\n", type_names[i],
+		     diff, objspace_watch[i], mrbc_objspace_live[i]);
+    }
+    total += diff;
+  }
+
+  while( (cls = next_class( &ite )) != NULL ) {
+    int diff = cls->n_live - cls->n_watch;
+    if( diff > 0 ) {
+      console_printf("ObjectSpace: %s +%d (%d -> %d)\n",
+		     symid_to_str(cls->sym_id), diff, cls->n_watch, cls->n_live);
+    }
+  }
+
+  return total;
+}
+
+
+//================================================================
+/*! (method) ObjectSpace.count_objects
+*/
+static void c_objspace_count_objects(struct VM *vm, mrbc_value v[], int argc)
+{
+  mrbc_value ret = mrbc_hash_new( vm, MRBC_OBJSPACE_N_TYPES + 1 );
+  int total = 0;
+  int i;
+
+  for( i = 0; i < MRBC_OBJSPACE_N_TYPES; i++ ) {
+    mrbc_value key = mrbc_symbol_new( vm, type_keys[i] );
+    mrbc_value val = mrbc_fixnum_value( mrbc_objspace_live[i] );
+    mrbc_hash_set( &ret, &key, &val );
+    total += mrbc_objspace_live[i];
+  }
+
+  mrbc_value key = mrbc_symbol_new( vm, "TOTAL" );
+  mrbc_value val = mrbc_fixnum_value( total );
+  mrbc_hash_set( &ret, &key, &val );
+
+  SET_RETURN( ret );
+}
+
+
+//================================================================
+/*! (method) ObjectSpace.count_objects_by_class	{Class=>count, ...}
+*/
+static void c_objspace_count_objects_by_class(struct VM *vm, mrbc_value v[], int argc)
+{
+  mrbc_kv_iterator ite = mrbc_kv_iterator_new( mrbc_get_const_handle() );
+  mrbc_value ret = mrbc_hash_new( vm, 4 );
+  mrbc_class *cls;
+
+  while( (cls = next_class( &ite )) != NULL ) {
+    if( cls->n_live == 0 ) continue;
+    mrbc_value key = {.tt = MRBC_TT_CLASS, .cls = cls};
+    mrbc_value val = mrbc_fixnum_value( cls->n_live );
+    mrbc_hash_set( &ret, &key, &val );
+  }
+
+  SET_RETURN( ret );
+}
+
+
+//================================================================
+/*! (method) ObjectSpace.watch
+*/
+static void c_objspace_watch(struct VM *vm, mrbc_value v[], int argc)
+{
+  mrbc_objspace_watch();
+  SET_NIL_RETURN();
+}
+
+
+//================================================================
+/*! (method) ObjectSpace.report	total growth from ObjectSpace.watch
+*/
+static void c_objspace_report(struct VM *vm, mrbc_value v[], int argc)
+{
+  SET_INT_RETURN( mrbc_objspace_report() );
+}
+
+
+
+//================================================================
+/*! initialize
+*/
+void mrbc_init_class_objspace(struct VM *vm)
+{
+  mrbc_class *cls = mrbc_define_class(vm, "ObjectSpace", mrbc_class_object);
+
+  mrbc_define_method(vm, cls, "count_objects", c_objspace_count_objects);
+  mrbc_define_method(vm, cls, "count_objects_by_class", c_objspace_count_objects_by_class);
+  mrbc_define_method(vm, cls, "watch", c_objspace_watch);
+  mrbc_define_method(vm, cls, "report", c_objspace_report);
+}
+
+#endif  // MRBC_USE_OBJSPACE
@@ -0,0 +1,88 @@
+/*! @file
+  @brief
+  Live object counters by type and by class. (ObjectSpace)
+
+  <pre>
+  Copyright (C) 2015-2020 Kyushu Institute of Technology.
+  Copyright (C) 2015-2020 Shimane IT Open-Innovation Center.
+
+  This file is distributed under BSD 3-Clause License.
+
+  </pre>
+*/
+
+#ifndef MRBC_SRC_OBJSPACE_H_
+#define MRBC_SRC_OBJSPACE_H_
+
+#include <stdint.h>
+#include "vm_config.h"
+#include "value.h"
+#include "class.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define MRBC_OBJSPACE_N_TYPES	(MRBC_TT_HASH - MRBC_TT_OBJECT + 1)
+
+#if MRBC_USE_OBJSPACE
+extern uint32_t mrbc_objspace_live[MRBC_OBJSPACE_N_TYPES];
+#endif
+
+
+//================================================================
+/*! count a new object. (called from the constructors)
+
+  @param  tt	type of the object. (MRBC_TT_OBJECT .. MRBC_TT_HASH)
+*/
+static inline void mrbc_objspace_new(mrbc_vtype tt)
+{
+#if MRBC_USE_OBJSPACE
+  mrbc_objspace_live[tt - MRBC_TT_OBJECT]++;
+#endif
+}
+
+//================================================================
+/*! count a released object. (called from the destructors)
+*/
+static inline void mrbc_objspace_delete(mrbc_vtype tt)
+{
+#if MRBC_USE_OBJSPACE
+  mrbc_objspace_live[tt - MRBC_TT_OBJECT]--;
+#endif
+}
+
+//================================================================
+/*! count a new instance of the class.
+*/
+static inline void mrbc_objspace_new_instance(mrbc_class *cls)
+{
+#if MRBC_USE_OBJSPACE
+  mrbc_objspace_live[0]++;
+  cls->n_live++;
+#endif
+}
+
+//================================================================
+/*! count a released instance of the class.
+*/
+static inline void mrbc_objspace_delete_instance(mrbc_class *cls)
+{
+#if MRBC_USE_OBJSPACE
+  mrbc_objspace_live[0]--;
+  cls->n_live--;
+#endif
+}
+
+
+#if MRBC_USE_OBJSPACE
+void mrbc_objspace_watch(void);
+int mrbc_objspace_report(void);
+void mrbc_init_class_objspace(struct VM *vm);
+#endif
+
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -0,0 +1,252 @@
+/*! @file
+  @brief
+  Per-opcode execution counters. (instrumentation build)
+
+  <pre>
+  Copyright (C) 2015-2020 Kyushu Institute of Technology.
+  Copyright (C) 2015-2020 Shimane IT Open-Innovation Center.
+
+  This file is distributed under BSD 3-Clause License.
+
+  (usage)
+  #define MRBC_OPCODE_STATS 1	// count opcodes, ireps and methods.
+  #define MRBC_OPCODE_CYCLES 1	// and measure cycles of each handler.
+
+  VM.opcode_stats		# => {"SEND"=>1234, "ADDI"=>567, ...}
+  VM.method_stats		# => {:loop=>3000, :update=>1200, ...}
+  VM.opcode_stats_print		# print the tables to the console.
+  VM.opcode_stats_clear
+
+  The counters are shared by all VMs, except the counts of each irep.
+  Cycles include the dispatch overhead of one instruction, and the
+  time of the methods written in C called by OP_SEND.
+  </pre>
+*/
+
+#include "vm_config.h"
+#include <stdint.h>
+#include <string.h>
+
+#include "value.h"
+#include "vm.h"
+#include "alloc.h"
+#include "class.h"
+#include "symbol.h"
+#include "console.h"
+#include "c_string.h"
+#include "c_hash.h"
+#include "opstat.h"
+
+#if MRBC_OPCODE_STATS
+
+mrbc_opstat mrbc_opstat_data;
+
+
+//================================================================
+/*! clear the counters of the irep tree.
+*/
+static void clear_irep(mrbc_irep *irep)
+{
+  int i;
+  irep->n_exec = 0;
+  for( i = 0; i < irep->rlen; i++ ) {
+    clear_irep( irep->reps[i] );
+  }
+}
+
+
+//================================================================
+/*! clear all counters.
+
+  @param  vm	VM to clear the counters of ireps, or NULL.
+*/
+void mrbc_opstat_clear(const struct VM *vm)
+{
+  memset( &mrbc_opstat_data, 0, sizeof(mrbc_opstat_data) );
+  if( vm && vm->irep ) clear_irep( vm->irep );
+}
+
+
+//================================================================
+/*! print a count with percentage.
+*/
+static void print_count(uint32_t count, uint32_t total)
+{
+  uint32_t permil = total ? (uint64_t)count * 1000 / total : 0;
+  console_printf(" %10u %3u.%u%%", count, permil / 10, permil % 10);
+}
+
+
+//================================================================
+/*! print the counters of the irep tree. (pre-order index)
+*/
+static int print_irep(const mrbc_irep *irep, int idx, uint32_t total)
+{
+  int i;
+  if( irep->n_exec ) {
+    console_printf("%-12d", idx);
+    print_count( irep->n_exec, total );
+    console_printf("  ilen %d\n", irep->ilen);
+  }
+
+  idx++;
+  for( i = 0; i < irep->rlen; i++ ) {
+    idx = print_irep( irep->reps[i], idx, total );
+  }
+  return idx;
+}
+
+
+//================================================================
+/*! print the tables to the console.
+
+  @param  vm	VM to print the counts of ireps, or NULL.
+  @param  n_top	max lines of each table. (0: all)
+*/
+void mrbc_opstat_print(const struct VM *vm, int n_top)
+{
+  uint8_t order[MRBC_OPSTAT_N_OPCODES];
+  uint32_t total = 0;
+  int i, j, n = 0;
+
+  // sort opcodes by count.
+  for( i = 0; i < MRBC_OPSTAT_N_OPCODES; i++ ) {
+    uint32_t c = mrbc_opstat_data.count[i];
+    if( c == 0 ) continue;
+    total += c;
+    for( j = n++; j > 0 && mrbc_opstat_data.count[order[j-1]] < c; j-- ) {
+      order[j] = order[j-1];
+    }
+    order[j] = i;
+  }
+  if( n_top <= 0 ) n_top = MRBC_OPSTAT_N_OPCODES + MAX_SYMBOLS_COUNT;
+
+#if MRBC_OPCODE_CYCLES
+  console_printf("OPCODE            COUNT      %%   AVG.CYCLES  HISTOGRAM (2^n:count)\n");
+#else
+  console_printf("OPCODE            COUNT      %%\n");
+#endif
+  for( i = 0; i < n && i < n_top; i++ ) {
+    int op = order[i];
+    console_printf("%-12s", mrbc_opcode_name(op));
+    print_count( mrbc_opstat_data.count[op], total );
+#if MRBC_OPCODE_CYCLES
+    console_printf("  %10u ", mrbc_opstat_data.cycles[op] / mrbc_opstat_data.count[op]);
+    for( j = 0; j < MRBC_OPCODE_HIST_BUCKETS; j++ ) {
+      if( mrbc_opstat_data.hist[op][j] ) {
+	console_printf(" %d:%u", j, mrbc_opstat_data.hist[op][j]);
+      }
+    }
+#endif
+    console_printf("\n");
+  }
+  console_printf("%-12s %10u\n\n", "total", total);
+
+  // methods, in order of count.
+  console_printf("METHOD            COUNT      %%\n");
+  console_printf("%-12s", "(top level)");
+  print_count( mrbc_opstat_data.n_toplevel, total );
+  console_printf("\n");
+  uint32_t prev = UINT32_MAX;
+  for( i = 0; i < n_top; ) {
+    uint32_t max = 0;
+    for( j = 0; j < MAX_SYMBOLS_COUNT; j++ ) {
+      uint32_t c = mrbc_opstat_data.method_count[j];
+      if( c < prev && c > max ) max = c;
+    }
+    if( max == 0 ) break;
+    for( j = 0; j < MAX_SYMBOLS_COUNT && i < n_top; j++ ) {
+      if( mrbc_opstat_data.method_count[j] != max ) continue;
+      console_printf("%-12s", symid_to_str(j));
+      print_count( max, total );
+      console_printf("\n");
+      i++;
+    }
+    prev = max;
+  }
+
+  if( vm && vm->irep ) {
+    console_printf("\nIREP              COUNT      %%\n");
+    print_irep( vm->irep, 0, total );
+  }
+}
+
+
+//================================================================
+/*! (method) VM.opcode_stats
+*/
+static void c_vm_opcode_stats(struct VM *vm, mrbc_value v[], int argc)
+{
+  mrbc_value ret = mrbc_hash_new( vm, 0 );
+  int i;
+
+  for( i = 0; i < MRBC_OPSTAT_N_OPCODES; i++ ) {
+    if( mrbc_opstat_data.count[i] == 0 ) continue;
+#if MRBC_USE_STRING
+    mrbc_value key = mrbc_string_new_cstr( vm, mrbc_opcode_name(i) );
+#else
+    mrbc_value key = mrbc_fixnum_value( i );
+#endif
+    mrbc_value val = mrbc_fixnum_value( mrbc_opstat_data.count[i] );
+    mrbc_hash_set( &ret, &key, &val );
+  }
+
+  SET_RETURN( ret );
+}
+
+
+//================================================================
+/*! (method) VM.method_stats
+*/
+static void c_vm_method_stats(struct VM *vm, mrbc_value v[], int argc)
+{
+  mrbc_value ret = mrbc_hash_new( vm, 0 );
+  int i;
+
+  for( i = 0; i < MAX_SYMBOLS_COUNT; i++ ) {
+    if( mrbc_opstat_data.method_count[i] == 0 ) continue;
+    mrbc_value key = {.tt = MRBC_TT_SYMBOL};
+    key.i = i;
+    mrbc_value val = mrbc_fixnum_value( mrbc_opstat_data.method_count[i] );
+    mrbc_hash_set( &ret, &key, &val );
+  }
+
+  SET_RETURN( ret );
+}
+
+
+//================================================================
+/*! (method) VM.opcode_stats_print(n_top = 0)
+*/
+static void c_vm_opcode_stats_print(struct VM *vm, mrbc_value v[], int argc)
+{
+  int n_top = (argc >= 1 && v[1].tt == MRBC_TT_FIXNUM) ? v[1].i : 0;
+  mrbc_opstat_print( vm, n_top );
+  SET_NIL_RETURN();
+}
+
+
+//================================================================
+/*! (method) VM.opcode_stats_clear
+*/
+static void c_vm_opcode_stats_clear(struct VM *vm, mrbc_value v[], int argc)
+{
+  mrbc_opstat_clear( vm );
+  SET_NIL_RETURN();
+}
+
+
+//================================================================
+/*! initialize
+
+  @param  c_vm	VM class.
+*/
+void mrbc_init_class_opstat(mrbc_class *c_vm)
+{
+  mrbc_define_method(0, c_vm, "opcode_stats", c_vm_opcode_stats);
+  mrbc_define_method(0, c_vm, "method_stats", c_vm_method_stats);
+  mrbc_define_method(0, c_vm, "opcode_stats_print", c_vm_opcode_stats_print);
+  mrbc_define_method(0, c_vm, "opcode_stats_clear", c_vm_opcode_stats_clear);
+}
+
+#endif  // MRBC_OPCODE_STATS
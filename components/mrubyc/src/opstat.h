@@ -0,0 +1,93 @@
+/*! @file
+  @brief
+  Per-opcode execution counters. (instrumentation build)
+
+  <pre>
+  Copyright (C) 2015-2020 Kyushu Institute of Technology.
+  Copyright (C) 2015-2020 Shimane IT Open-Innovation Center.
+
+  This file is distributed under BSD 3-Clause License.
+
+  </pre>
+*/
+
+#ifndef MRBC_SRC_OPSTAT_H_
+#define MRBC_SRC_OPSTAT_H_
+
+#include <stdint.h>
+#include "vm_config.h"
+#include "vm.h"
+#include "opcode.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#if MRBC_OPCODE_STATS
+
+#if MRBC_OPCODE_CYCLES && !defined(hal_cycle_count)
+#error "MRBC_OPCODE_CYCLES needs hal_cycle_count() in HAL."
+#endif
+
+#define MRBC_OPSTAT_N_OPCODES	(OP_ABORT + 1)
+
+
+//================================================================
+/*!@brief
+  Execution counters.
+*/
+typedef struct OPCODE_STATISTICS {
+  uint32_t count[MRBC_OPSTAT_N_OPCODES];	//!< executions of each opcode.
+#if MRBC_OPCODE_CYCLES
+  uint32_t cycles[MRBC_OPSTAT_N_OPCODES];	//!< total cycles of each opcode.
+  uint32_t hist[MRBC_OPSTAT_N_OPCODES][MRBC_OPCODE_HIST_BUCKETS];
+						//!< log2 histogram of cycles.
+#endif
+  uint32_t n_toplevel;				//!< executions outside methods.
+  uint32_t method_count[MAX_SYMBOLS_COUNT];	//!< executions in each method.
+} mrbc_opstat;
+
+extern mrbc_opstat mrbc_opstat_data;
+
+
+//================================================================
+/*! count an instruction. (called from mrbc_vm_run)
+*/
+static inline void mrbc_opstat_count(struct VM *vm, int op)
+{
+  mrbc_opstat_data.count[op]++;
+  vm->pc_irep->n_exec++;
+  if( vm->callinfo_tail ) {
+    mrbc_opstat_data.method_count[vm->callinfo_tail->method_id]++;
+  } else {
+    mrbc_opstat_data.n_toplevel++;
+  }
+}
+
+
+#if MRBC_OPCODE_CYCLES
+//================================================================
+/*! add cycles of an instruction. (called from mrbc_vm_run)
+*/
+static inline void mrbc_opstat_cycles(int op, uint32_t cycles)
+{
+  int b = 31 - __builtin_clz( cycles | 1 );
+  if( b >= MRBC_OPCODE_HIST_BUCKETS ) b = MRBC_OPCODE_HIST_BUCKETS - 1;
+
+  mrbc_opstat_data.cycles[op] += cycles;
+  mrbc_opstat_data.hist[op][b]++;
+}
+#endif
+
+
+void mrbc_opstat_clear(const struct VM *vm);
+void mrbc_opstat_print(const struct VM *vm, int n_top);
+void mrbc_init_class_opstat(mrbc_class *c_vm);
+
+#endif  // MRBC_OPCODE_STATS
+
+
+#ifdef __cplusplus
+}
+#endif
+#endif
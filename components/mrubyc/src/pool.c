@@ -0,0 +1,192 @@
+/*! @file
+  @brief
+  Recycling pool of instances.
+
+  <pre>
+  Copyright (C) 2015-2020 Kyushu Institute of Technology.
+  Copyright (C) 2015-2020 Shimane IT Open-Innovation Center.
+
+  This file is distributed under BSD 3-Clause License.
+
+  (usage)
+  class Reading
+    instance_pool 8	# keep up to 8 freed instances.
+  end
+
+  mrbc_define_instance_pool( cls, 8, 0 );	// same in C.
+
+  Freed instances of the class are kept in the pool with their ivar
+  buffer, and Reading.new takes one from the pool without calling
+  the allocator. Pooled memory is not owned by any VM, so it survives
+  mrbc_vm_close(). Instances of the subclasses are not pooled.
+  </pre>
+*/
+
+#include "vm_config.h"
+#include <string.h>
+
+#include "value.h"
+#include "alloc.h"
+#include "vm.h"
+#include "class.h"
+#include "keyvalue.h"
+#include "pool.h"
+
+#if MRBC_USE_INSTANCE_POOL
+
+static mrbc_instance_pool instance_pools[MAX_INSTANCE_POOLS];
+static int n_pools;
+
+
+//================================================================
+/*! find the pool of the class.
+*/
+static mrbc_instance_pool *find_pool(const mrbc_class *cls)
+{
+  int i;
+  for( i = 0; i < MAX_INSTANCE_POOLS; i++ ) {
+    if( instance_pools[i].cls == cls ) return &instance_pools[i];
+  }
+
+  return NULL;
+}
+
+
+//================================================================
+/*! free the instance memory.
+*/
+static void free_instance(mrbc_instance *instance)
+{
+  mrbc_kv_delete_data( &instance->ivar );
+  mrbc_raw_free( instance );
+}
+
+
+//================================================================
+/*! define the instance pool of the class.
+
+  @param  cls		target class.
+  @param  max		max number of pooled instances. (1..255)
+  @param  data_size	size of additional data of the instance.
+  @return		0 if no error.
+*/
+int mrbc_define_instance_pool(mrbc_class *cls, int max, int data_size)
+{
+  mrbc_delete_instance_pool( cls );
+  if( max <= 0 ) return 0;
+  if( max > 255 ) max = 255;
+
+  mrbc_instance_pool *pool = find_pool( NULL );
+  if( !pool ) return -1;		// table full.
+
+  pool->free = mrbc_raw_alloc( sizeof(mrbc_instance *) * max );
+  if( !pool->free ) return -1;		// ENOMEM
+
+  pool->cls = cls;
+  pool->data_size = data_size;
+  pool->max = max;
+  pool->n_free = 0;
+  pool->n_hit = 0;
+  pool->n_miss = 0;
+  n_pools++;
+
+  return 0;
+}
+
+
+//================================================================
+/*! delete the instance pool of the class, and free pooled instances.
+
+  @param  cls		target class.
+*/
+void mrbc_delete_instance_pool(mrbc_class *cls)
+{
+  if( cls == NULL ) return;
+  mrbc_instance_pool *pool = find_pool( cls );
+  if( !pool ) return;
+
+  while( pool->n_free > 0 ) {
+    free_instance( pool->free[--pool->n_free] );
+  }
+  mrbc_raw_free( pool->free );
+
+  memset( pool, 0, sizeof(mrbc_instance_pool) );
+  n_pools--;
+}
+
+
+//================================================================
+/*! get the instance pool of the class. (for statistics)
+
+  @param  cls		target class.
+  @return		pointer to pool, or NULL if not pooled.
+*/
+const mrbc_instance_pool *mrbc_get_instance_pool(const mrbc_class *cls)
+{
+  if( n_pools == 0 || cls == NULL ) return NULL;
+  return find_pool( cls );
+}
+
+
+//================================================================
+/*! take an instance from the pool. (called from mrbc_instance_new)
+
+  @param  vm		pointer to VM.
+  @param  cls		class of the new instance.
+  @param  data_size	size of additional data.
+  @return		recycled instance, or NULL if not pooled.
+*/
+mrbc_instance *mrbc_instance_pool_get(struct VM *vm, mrbc_class *cls, int data_size)
+{
+  if( n_pools == 0 ) return NULL;
+
+  mrbc_instance_pool *pool = find_pool( cls );
+  if( !pool || pool->data_size != data_size ) return NULL;
+  if( pool->n_free == 0 ) {
+    pool->n_miss++;
+    return NULL;
+  }
+  pool->n_hit++;
+
+  mrbc_instance *instance = pool->free[--pool->n_free];
+  instance->ref_count = 1;
+
+  // the VM owns the memory again.
+  if( vm ) {
+    mrbc_set_vm_id( instance, vm->vm_id );
+    if( instance->ivar.data_size ) mrbc_set_vm_id( instance->ivar.data, vm->vm_id );
+  }
+  if( instance->ivar.data_size == 0 ) instance->ivar.vm = vm;
+
+  return instance;
+}
+
+
+//================================================================
+/*! put the freed instance into the pool. (called from mrbc_instance_delete)
+
+  @param  instance	instance which ref_count became 0.
+  @return		0 if pooled, otherwise the caller frees it.
+*/
+int mrbc_instance_pool_put(mrbc_instance *instance)
+{
+  if( n_pools == 0 ) return -1;
+
+  mrbc_instance_pool *pool = find_pool( instance->cls );
+  if( !pool ) return -1;
+
+  // get() never takes it, so the caller frees it.
+  if( instance->data_size != pool->data_size ) return -1;
+
+  // releasing ivars may put other instances, so do it first.
+  mrbc_kv_clear( &instance->ivar );
+  if( pool->n_free >= pool->max ) return -1;
+
+  mrbc_set_vm_id( instance, 0 );
+  if( instance->ivar.data_size ) mrbc_set_vm_id( instance->ivar.data, 0 );
+  pool->free[pool->n_free++] = instance;
+
+  return 0;
+}
+
+#endif  // MRBC_USE_INSTANCE_POOL
@@ -0,0 +1,52 @@
+/*! @file
+  @brief
+  Recycling pool of instances.
+
+  <pre>
+  Copyright (C) 2015-2020 Kyushu Institute of Technology.
+  Copyright (C) 2015-2020 Shimane IT Open-Innovation Center.
+
+  This file is distributed under BSD 3-Clause License.
+
+  </pre>
+*/
+
+#ifndef MRBC_SRC_POOL_H_
+#define MRBC_SRC_POOL_H_
+
+#include <stdint.h>
+#include "value.h"
+#include "class.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+//================================================================
+/*!@brief
+  Instance pool of a class.
+*/
+typedef struct RInstancePool {
+  mrbc_class *cls;		//!< target class. NULL is unused entry.
+  uint16_t data_size;		//!< size of mrbc_instance::data[].
+  uint8_t max;			//!< max number of pooled instances.
+  uint8_t n_free;		//!< number of pooled instances.
+  uint32_t n_hit;		//!< statistics. reused.
+  uint32_t n_miss;		//!< statistics. allocated.
+  mrbc_instance **free;		//!< pooled instances.
+
+} mrbc_instance_pool;
+
+
+int mrbc_define_instance_pool(mrbc_class *cls, int max, int data_size);
+void mrbc_delete_instance_pool(mrbc_class *cls);
+const mrbc_instance_pool *mrbc_get_instance_pool(const mrbc_class *cls);
+mrbc_instance *mrbc_instance_pool_get(struct VM *vm, mrbc_class *cls, int data_size);
+int mrbc_instance_pool_put(mrbc_instance *instance);
+
+
+#ifdef __cplusplus
+}
+#endif
+#endif
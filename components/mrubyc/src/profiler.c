@@ -0,0 +1,374 @@
+/*! @file
+  @brief
+  Sampling profiler of Ruby methods.
+
+  <pre>
+  Copyright (C) 2015-2020 Kyushu Institute of Technology.
+  Copyright (C) 2015-2020 Shimane IT Open-Innovation Center.
+
+  This file is distributed under BSD 3-Clause License.
+
+  (usage)
+  Profiler.start(1)	# sample every tick.
+  ...
+  Profiler.stop
+  Profiler.print	# flat profile and hot spots.
+  Profiler.folded	# call stacks in the folded format.
+
+  mrbc_tick() counts the interval, and the running VM takes the sample
+  at the next instruction boundary: the method of each callinfo, the
+  irep and the pc offset. Folded stacks ("vm1;<top>;loop;update 42")
+  are the input of flamegraph.pl. Without MRBC_USE_PROFILER, nothing
+  is added to the tick and the VM.
+  </pre>
+*/
+
+#include "vm_config.h"
+#include <stdint.h>
+#include <string.h>
+
+#include "value.h"
+#include "vm.h"
+#include "static.h"
+#include "class.h"
+#include "symbol.h"
+#include "console.h"
+#include "profiler.h"
+
+#if MRBC_USE_PROFILER
+
+#define PROFILER_TOP	((mrbc_sym)-1)	//!< method id of top level.
+
+
+//================================================================
+/*! sampled call stack.
+*/
+typedef struct PROFILER_STACK {
+  uint32_t count;
+  uint8_t vm_id;
+  uint8_t depth;
+  uint8_t truncated;
+  mrbc_sym method[MRBC_PROFILER_DEPTH];	//!< innermost first.
+} mrbc_profiler_stack;
+
+//================================================================
+/*! sampled pc.
+*/
+typedef struct PROFILER_PC {
+  uint32_t count;
+  const mrbc_irep *irep;
+  uint16_t pc;
+  mrbc_sym method_id;
+} mrbc_profiler_pc;
+
+//================================================================
+/*! method in the flat profile.
+*/
+typedef struct PROFILER_METHOD {
+  mrbc_sym method_id;
+  uint32_t self;
+  uint32_t total;
+} mrbc_profiler_method;
+
+
+mrbc_profiler_state mrbc_profiler;
+static mrbc_profiler_stack stacks[MRBC_PROFILER_STACKS];
+static mrbc_profiler_pc pcs[MRBC_PROFILER_STACKS];
+static mrbc_profiler_method methods[MRBC_PROFILER_STACKS * 2];
+
+
+//================================================================
+/*! start sampling.
+
+  @param  interval	sampling interval in ticks.
+*/
+void mrbc_profiler_start(int interval)
+{
+  if( interval < 1 ) interval = 1;
+  if( interval > UINT16_MAX ) interval = UINT16_MAX;
+
+  hal_disable_irq();
+  mrbc_profiler.interval = interval;
+  mrbc_profiler.countdown = interval;
+  mrbc_profiler.running = 1;
+  hal_enable_irq();
+}
+
+
+//================================================================
+/*! stop sampling.
+*/
+void mrbc_profiler_stop(void)
+{
+  mrbc_profiler.running = 0;
+  mrbc_profiler.requested = 0;
+}
+
+
+//================================================================
+/*! clear the samples.
+*/
+void mrbc_profiler_clear(void)
+{
+  hal_disable_irq();
+  mrbc_profiler.n_samples = 0;
+  mrbc_profiler.n_idle = 0;
+  mrbc_profiler.n_lost = 0;
+  hal_enable_irq();
+
+  memset( stacks, 0, sizeof(stacks) );
+  memset( pcs, 0, sizeof(pcs) );
+}
+
+
+//================================================================
+/*! take a sample. (called from mrbc_vm_run)
+
+  @param  vm	running VM.
+*/
+void mrbc_profiler_sample(const struct VM *vm)
+{
+  mrbc_profiler_stack s = { .count = 1, .vm_id = vm->vm_id };
+  const mrbc_callinfo *ci;
+  int i;
+
+  mrbc_profiler.requested = 0;
+  mrbc_profiler.n_samples++;
+
+  for( ci = vm->callinfo_tail; ci != NULL; ci = ci->prev ) {
+    if( s.depth == MRBC_PROFILER_DEPTH ) {
+      s.truncated = 1;
+      break;
+    }
+    s.method[s.depth++] = ci->method_id;
+  }
+
+  // call stack.
+  for( i = 0; i < MRBC_PROFILER_STACKS; i++ ) {
+    if( stacks[i].count == 0 ) {
+      stacks[i] = s;
+      break;
+    }
+    if( stacks[i].vm_id == s.vm_id && stacks[i].depth == s.depth &&
+	stacks[i].truncated == s.truncated &&
+	memcmp( stacks[i].method, s.method, sizeof(mrbc_sym) * s.depth ) == 0 ) {
+      stacks[i].count++;
+      break;
+    }
+  }
+  if( i == MRBC_PROFILER_STACKS ) mrbc_profiler.n_lost++;
+
+  // pc.
+  mrbc_sym method_id = s.depth ? s.method[0] : PROFILER_TOP;
+  uint16_t pc = vm->inst - vm->pc_irep->code;
+  for( i = 0; i < MRBC_PROFILER_STACKS; i++ ) {
+    if( pcs[i].count == 0 ) {
+      pcs[i] = (mrbc_profiler_pc){ .count = 1, .irep = vm->pc_irep,
+				   .pc = pc, .method_id = method_id };
+      break;
+    }
+    if( pcs[i].irep == vm->pc_irep && pcs[i].pc == pc ) {
+      pcs[i].count++;
+      break;
+    }
+  }
+}
+
+
+//================================================================
+/*! get the name of method.
+*/
+static const char *method_name(mrbc_sym method_id)
+{
+  if( method_id == PROFILER_TOP ) return "<top>";
+  return symid_to_str( method_id );
+}
+
+
+//================================================================
+/*! print a count with percentage.
+*/
+static void print_count(uint32_t count, uint32_t total)
+{
+  uint32_t permil = total ? (uint64_t)count * 1000 / total : 0;
+  console_printf("%8u %3u.%u%%", count, permil / 10, permil % 10);
+}
+
+
+//================================================================
+/*! add the samples of a method in the flat profile.
+*/
+static int add_method(int n, mrbc_sym method_id, uint32_t self, uint32_t total)
+{
+  int i;
+  for( i = 0; i < n; i++ ) {
+    if( methods[i].method_id == method_id ) break;
+  }
+  if( i == n ) {
+    if( n == sizeof(methods)/sizeof(methods[0]) ) return n;
+    methods[n++] = (mrbc_profiler_method){ .method_id = method_id };
+  }
+  methods[i].self += self;
+  methods[i].total += total;
+  return n;
+}
+
+
+//================================================================
+/*! print the flat profile and hot spots.
+*/
+void mrbc_profiler_print(void)
+{
+  uint32_t total = mrbc_profiler.n_samples;
+  int i, j, k, n = 0;
+
+  // flat profile. (total counts a method once in a stack)
+  for( i = 0; i < MRBC_PROFILER_STACKS && stacks[i].count; i++ ) {
+    const mrbc_profiler_stack *s = &stacks[i];
+    if( s->depth == 0 ) {
+      n = add_method( n, PROFILER_TOP, s->count, s->count );
+      continue;
+    }
+    n = add_method( n, s->method[0], s->count, 0 );
+    for( j = 0; j < s->depth; j++ ) {
+      for( k = 0; k < j; k++ ) {
+	if( s->method[k] == s->method[j] ) break;
+      }
+      if( k == j ) n = add_method( n, s->method[j], 0, s->count );
+    }
+    if( !s->truncated ) n = add_method( n, PROFILER_TOP, 0, s->count );
+  }
+  for( i = 1; i < n; i++ ) {
+    mrbc_profiler_method m = methods[i];
+    for( j = i; j > 0 && methods[j-1].self < m.self; j-- ) {
+      methods[j] = methods[j-1];
+    }
+    methods[j] = m;
+  }
+
+  console_printf("samples %u, idle %u, lost %u\n\n",
+		 total, mrbc_profiler.n_idle, mrbc_profiler.n_lost);
+  console_printf("    SELF      %%    TOTAL      %%  METHOD\n");
+  for( i = 0; i < n; i++ ) {
+    print_count( methods[i].self, total );
+    print_count( methods[i].total, total );
+    console_printf("  %s\n", method_name( methods[i].method_id ));
+  }
+
+  // hot spots.
+  console_printf("\n   COUNT      %%  METHOD+PC\n");
+  uint32_t prev = UINT32_MAX;
+  while( 1 ) {
+    uint32_t max = 0;
+    for( i = 0; i < MRBC_PROFILER_STACKS && pcs[i].count; i++ ) {
+      if( pcs[i].count < prev && pcs[i].count > max ) max = pcs[i].count;
+    }
+    if( max == 0 ) break;
+    for( i = 0; i < MRBC_PROFILER_STACKS && pcs[i].count; i++ ) {
+      if( pcs[i].count != max ) continue;
+      print_count( max, total );
+      console_printf("  %s+%d\n", method_name( pcs[i].method_id ), pcs[i].pc);
+    }
+    prev = max;
+  }
+}
+
+
+//================================================================
+/*! print the call stacks in the folded format. (for flamegraph.pl)
+*/
+void mrbc_profiler_print_folded(void)
+{
+  int i, j;
+
+  for( i = 0; i < MRBC_PROFILER_STACKS && stacks[i].count; i++ ) {
+    const mrbc_profiler_stack *s = &stacks[i];
+    console_printf("vm%d;%s", s->vm_id, s->truncated ? "..." : "<top>");
+    for( j = s->depth - 1; j >= 0; j-- ) {
+      console_printf(";%s", method_name( s->method[j] ));
+    }
+    console_printf(" %u\n", s->count);
+  }
+  if( mrbc_profiler.n_idle ) {
+    console_printf("idle %u\n", mrbc_profiler.n_idle);
+  }
+}
+
+
+//================================================================
+/*! (method) Profiler.start(interval = 1)
+*/
+static void c_profiler_start(struct VM *vm, mrbc_value v[], int argc)
+{
+  int interval = (argc >= 1 && v[1].tt == MRBC_TT_FIXNUM) ? v[1].i : 1;
+  mrbc_profiler_start( interval );
+  SET_NIL_RETURN();
+}
+
+
+//================================================================
+/*! (method) Profiler.stop
+*/
+static void c_profiler_stop(struct VM *vm, mrbc_value v[], int argc)
+{
+  mrbc_profiler_stop();
+  SET_NIL_RETURN();
+}
+
+
+//================================================================
+/*! (method) Profiler.clear
+*/
+static void c_profiler_clear(struct VM *vm, mrbc_value v[], int argc)
+{
+  mrbc_profiler_clear();
+  SET_NIL_RETURN();
+}
+
+
+//================================================================
+/*! (method) Profiler.print
+*/
+static void c_profiler_print(struct VM *vm, mrbc_value v[], int argc)
+{
+  mrbc_profiler_print();
+  SET_NIL_RETURN();
+}
+
+
+//================================================================
+/*! (method) Profiler.folded
+*/
+static void c_profiler_folded(struct VM *vm, mrbc_value v[], int argc)
+{
+  mrbc_profiler_print_folded();
+  SET_NIL_RETURN();
+}
+
+
+//================================================================
+/*! (method) Profiler.samples
+*/
+static void c_profiler_samples(struct VM *vm, mrbc_value v[], int argc)
+{
+  SET_INT_RETURN( mrbc_profiler.n_samples );
+}
+
+
+
+//================================================================
+/*! initialize
+*/
+void mrbc_init_class_profiler(struct VM *vm)
+{
+  mrbc_class *cls = mrbc_define_class(vm, "Profiler", mrbc_class_object);
+
+  mrbc_define_method(vm, cls, "start", c_profiler_start);
+  mrbc_define_method(vm, cls, "stop", c_profiler_stop);
+  mrbc_define_method(vm, cls, "clear", c_profiler_clear);
+  mrbc_define_method(vm, cls, "print", c_profiler_print);
+  mrbc_define_method(vm, cls, "folded", c_profiler_folded);
+  mrbc_define_method(vm, cls, "samples", c_profiler_samples);
+}
+
+#endif  // MRBC_USE_PROFILER
@@ -0,0 +1,79 @@
+/*! @file
+  @brief
+  Sampling profiler of Ruby methods.
+
+  <pre>
+  Copyright (C) 2015-2020 Kyushu Institute of Technology.
+  Copyright (C) 2015-2020 Shimane IT Open-Innovation Center.
+
+  This file is distributed under BSD 3-Clause License.
+
+  </pre>
+*/
+
+#ifndef MRBC_SRC_PROFILER_H_
+#define MRBC_SRC_PROFILER_H_
+
+#include <stdint.h>
+#include "vm_config.h"
+#include "vm.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#if MRBC_USE_PROFILER
+
+//================================================================
+/*!@brief
+  Sampling state. (changed by mrbc_tick)
+*/
+typedef struct PROFILER_STATE {
+  volatile uint8_t running;	//!< sampling enabled.
+  volatile uint8_t requested;	//!< a sample is due at the next safe point.
+  uint16_t interval;		//!< sampling interval in ticks.
+  uint16_t countdown;		//!< ticks to the next sample.
+  uint32_t n_samples;		//!< samples of Ruby code.
+  uint32_t n_idle;		//!< samples while no task was running.
+  uint32_t n_lost;		//!< samples not recorded. (table full)
+} mrbc_profiler_state;
+
+extern mrbc_profiler_state mrbc_profiler;
+
+
+//================================================================
+/*! count a tick. (called from mrbc_tick)
+
+  @param  vm	VM of the running task, or NULL if idle.
+*/
+static inline void mrbc_profiler_tick(struct VM *vm)
+{
+  if( !mrbc_profiler.running ) return;
+  if( --mrbc_profiler.countdown != 0 ) return;
+  mrbc_profiler.countdown = mrbc_profiler.interval;
+
+  if( vm ) {
+    // take the sample at the next instruction boundary. (see mrbc_vm_run)
+    mrbc_profiler.requested = 1;
+    vm->flag_preemption = 1;
+  } else {
+    mrbc_profiler.n_idle++;
+  }
+}
+
+
+void mrbc_profiler_start(int interval);
+void mrbc_profiler_stop(void);
+void mrbc_profiler_clear(void);
+void mrbc_profiler_sample(const struct VM *vm);
+void mrbc_profiler_print(void);
+void mrbc_profiler_print_folded(void);
+void mrbc_init_class_profiler(struct VM *vm);
+
+#endif  // MRBC_USE_PROFILER
+
+
+#ifdef __cplusplus
+}
+#endif
+#endif
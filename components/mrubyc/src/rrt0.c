@@ -27,6 +27,11 @@
 #include "vm.h"
 #include "console.h"
 #include "rrt0.h"
+#include "hotswap.h"
+#include "c_log.h"
+#include "opstat.h"
+#include "profiler.h"
+#include "metrics.h"
 #include "hal/hal.h"
 
 
@@ -324,6 +329,16 @@ static void c_vm_tick(mrbc_vm *vm, mrbc_value v[], int argc)
 
 /***** Global functions *****************************************************/
 
+//================================================================
+/*! get the tick count.
+
+*/
+uint32_t mrbc_get_tick(void)
+{
+  return tick_;
+}
+
+
 //================================================================
 /*! Tick timer interrupt handler.
 
@@ -344,6 +359,11 @@ void mrbc_tick(void)
     if( tcb->timeslice == 0 ) tcb->vm.flag_preemption = 1;
   }
 
+#if MRBC_USE_PROFILER
+  tcb = q_ready_;
+  mrbc_profiler_tick( (tcb && tcb->state == TASKSTATE_RUNNING) ? &tcb->vm : NULL );
+#endif
+
   // 待ちタスクキューから、ウェイクアップすべきタスクを探す
   tcb = q_waiting_;
   while( tcb != NULL ) {
@@ -394,6 +414,9 @@ void mrbc_init(uint8_t *ptr, unsigned int size )
 
   mrbc_class *c_mutex;
   c_mutex = mrbc_define_class(0, "Mutex", mrbc_class_object);
+#if MRBC_USE_INSTANCE_POOL
+  c_mutex->data_size = sizeof(mrbc_mutex);
+#endif
   mrbc_define_method(0, c_mutex, "new", c_mutex_new);
   mrbc_define_method(0, c_mutex, "lock", c_mutex_lock);
   mrbc_define_method(0, c_mutex, "unlock", c_mutex_unlock);
@@ -402,6 +425,9 @@ void mrbc_init(uint8_t *ptr, unsigned int size )
   mrbc_class *c_vm;
   c_vm = mrbc_define_class(0, "VM", mrbc_class_object);
   mrbc_define_method(0, c_vm, "tick", c_vm_tick);
+#if MRBC_OPCODE_STATS
+  mrbc_init_class_opstat(c_vm);
+#endif
 }
 
 
@@ -502,12 +528,22 @@ int mrbc_run(void)
     mrbc_tcb *tcb = q_ready_;
     if( tcb == NULL ) {
       // 実行すべきタスクなし
+#if MRBC_USE_LOG && MRBC_LOG_FLUSH_IDLE
+      mrbc_log_flush();
+#endif
+      mrbc_console_flush();
+#if MRBC_USE_METRICS
+      mrbc_metric_inc( &mrbc_metric_sched_idle );
+#endif
       hal_idle_cpu();
       continue;
     }
 
     // 実行開始
     tcb->state = TASKSTATE_RUNNING;
+#if MRBC_USE_METRICS
+    mrbc_metric_inc( &mrbc_metric_sched_switches );
+#endif
     int res = 0;
 
 #ifndef MRBC_NO_TIMER
@@ -525,6 +561,14 @@ int mrbc_run(void)
     mrbc_tick();
 #endif /* ifndef MRBC_NO_TIMER */
 
+#if MRBC_USE_HOT_SWAP
+    // safe point for hot swap.
+    if( tcb->pending_code && mrbc_hotswap_safe_point(tcb) == 0 ) {
+      res = 0;
+    }
+    mrbc_hotswap_collect();
+#endif
+
     // タスク終了？
     if( res < 0 ) {
       hal_disable_irq();
@@ -536,11 +580,16 @@ int mrbc_run(void)
 
 #if MRBC_SCHEDULER_EXIT
       if( q_ready_ == NULL && q_waiting_ == NULL &&
-          q_suspended_ == NULL ) return 0;
+          q_suspended_ == NULL ) {
+        mrbc_console_flush();
+        return 0;
+      }
 #endif
       continue;
     }
 
+    mrbc_console_poll( tick_ );
+
     // タスク切り替え
     hal_disable_irq();
     if( tcb->state == TASKSTATE_RUNNING ) {
@@ -559,6 +608,36 @@ int mrbc_run(void)
 }
 
 
+//================================================================
+/*! iterate all tasks.
+
+  @param  tcb	previous task, or NULL to get the first task.
+  @return	next task, or NULL if no more task.
+*/
+mrbc_tcb * mrbc_next_task(mrbc_tcb *tcb)
+{
+  mrbc_tcb **queues[] = { &q_dormant_, &q_ready_, &q_waiting_, &q_suspended_ };
+  int i = 0;
+
+  if( tcb != NULL ) {
+    if( tcb->next != NULL ) return tcb->next;
+
+    switch( tcb->state ) {
+    case TASKSTATE_DORMANT:	i = 1; break;
+    case TASKSTATE_READY:
+    case TASKSTATE_RUNNING:	i = 2; break;
+    case TASKSTATE_WAITING:	i = 3; break;
+    default:			i = 4; break;
+    }
+  }
+
+  for( ; i < 4; i++ ) {
+    if( *queues[i] != NULL ) return *queues[i];
+  }
+  return NULL;
+}
+
+
 //================================================================
 /*! 実行一時停止
 
@@ -673,6 +752,7 @@ int mrbc_mutex_lock( mrbc_mutex *mutex, mrbc_tcb *tcb )
   if( mutex->lock == 0 ) {      // a future does use TAS?
     mutex->lock = 1;
     mutex->tcb = tcb;
+    tcb->n_mutex++;
     MRBC_MUTEX_TRACE("  lock OK\n" );
     goto DONE;
   }
@@ -715,11 +795,13 @@ int mrbc_mutex_unlock( mrbc_mutex *mutex, mrbc_tcb *tcb )
   // wakeup ONE waiting task.
   int flag_preemption = 0;
   hal_disable_irq();
+  tcb->n_mutex--;
   tcb = q_waiting_;
   while( tcb != NULL ) {
     if( tcb->reason == TASKREASON_MUTEX && tcb->mutex == mutex ) {
       MRBC_MUTEX_TRACE("SW: TCB: %p\n", tcb );
       mutex->tcb = tcb;
+      tcb->n_mutex++;
       q_delete_task(tcb);
       tcb->state = TASKSTATE_READY;
       q_insert_task(tcb);
@@ -762,6 +844,7 @@ int mrbc_mutex_trylock( mrbc_mutex *mutex, mrbc_tcb *tcb )
   if( mutex->lock == 0 ) {
     mutex->lock = 1;
     mutex->tcb = tcb;
+    tcb->n_mutex++;
     ret = 0;
     MRBC_MUTEX_TRACE("  trylock OK\n" );
   }
@@ -60,11 +60,15 @@ typedef struct RTcb {
   uint8_t timeslice;
   uint8_t state;	//!< enum MrbcTaskState
   uint8_t reason;	//!< SLEEP, MUTEX
+  uint8_t n_mutex;	//!< number of Mutexes owned.
 
   union {
     uint32_t wakeup_tick;
     struct RMutex *mutex;
   };
+#if MRBC_USE_HOT_SWAP
+  const uint8_t *pending_code;	//!< new bytecode, swap at safe point.
+#endif
   struct VM vm;
 } mrbc_tcb;
 
@@ -85,11 +89,13 @@ typedef struct RMutex {
 /***** Global variables *****************************************************/
 /***** Function prototypes **************************************************/
 void mrbc_tick(void);
+uint32_t mrbc_get_tick(void);
 void mrbc_init(uint8_t *ptr, unsigned int size);
 void mrbc_init_tcb(mrbc_tcb *tcb);
 mrbc_tcb *mrbc_create_task(const uint8_t *vm_code, mrbc_tcb *tcb);
 int mrbc_start_task(mrbc_tcb *tcb);
 int mrbc_run(void);
+mrbc_tcb *mrbc_next_task(mrbc_tcb *tcb);
 void mrbc_sleep_ms(mrbc_tcb *tcb, uint32_t ms);
 void mrbc_relinquish(mrbc_tcb *tcb);
 void mrbc_change_priority(mrbc_tcb *tcb, int priority);
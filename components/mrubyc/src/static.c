@@ -22,12 +22,16 @@ struct RClass *mrbc_class_true;
 struct RClass *mrbc_class_symbol;
 struct RClass *mrbc_class_fixnum;
 struct RClass *mrbc_class_float;
+struct RClass *mrbc_class_fixed;
 struct RClass *mrbc_class_string;
 struct RClass *mrbc_class_array;
 struct RClass *mrbc_class_range;
 struct RClass *mrbc_class_hash;
 struct RClass *mrbc_class_proc;
 struct RClass *mrbc_class_math;
+struct RClass *mrbc_class_struct;
+struct RClass *mrbc_class_ringbuffer;
+struct RClass *mrbc_class_log;
 
 struct RClass *mrbc_class_exception;
 struct RClass *mrbc_class_standarderror;
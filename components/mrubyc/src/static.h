@@ -27,12 +27,16 @@ extern struct RClass *mrbc_class_true;
 extern struct RClass *mrbc_class_symbol;
 extern struct RClass *mrbc_class_fixnum;
 extern struct RClass *mrbc_class_float;
+extern struct RClass *mrbc_class_fixed;
 extern struct RClass *mrbc_class_string;
 extern struct RClass *mrbc_class_array;
 extern struct RClass *mrbc_class_range;
 extern struct RClass *mrbc_class_hash;
 extern struct RClass *mrbc_class_proc;
 extern struct RClass *mrbc_class_math;
+extern struct RClass *mrbc_class_struct;
+extern struct RClass *mrbc_class_ringbuffer;
+extern struct RClass *mrbc_class_log;
 
 extern struct RClass *mrbc_class_exception;
 extern struct RClass *mrbc_class_standarderror;
@@ -201,6 +201,18 @@ mrbc_sym str_to_symid(const char *str)
 }
 
 
+//================================================================
+/*! Search symbol. (don't add new symbol)
+
+  @param  str		Target string.
+  @return mrbc_sym	Symbol value, or -1 if not registered.
+*/
+mrbc_sym mrbc_search_symid(const char *str)
+{
+  return search_index( calc_hash(str), str );
+}
+
+
 //================================================================
 /*! Convert symbol value to string.
 
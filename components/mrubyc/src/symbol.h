@@ -24,6 +24,7 @@ extern "C" {
 void mrbc_cleanup_symbol(void);
 mrbc_value mrbc_symbol_new(struct VM *vm, const char *str);
 mrbc_sym str_to_symid(const char *str);
+mrbc_sym mrbc_search_symid(const char *str);
 const char *symid_to_str(mrbc_sym sym_id);
 void mrbc_init_class_symbol(struct VM *vm);
 void mrbc_symbol_statistics(int *total_used);
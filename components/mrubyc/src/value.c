@@ -23,6 +23,7 @@
 #include "c_range.h"
 #include "c_array.h"
 #include "c_hash.h"
+#include "c_fixed.h"
 
 
 //================================================================
@@ -40,6 +41,11 @@ int mrbc_compare(const mrbc_value *v1, const mrbc_value *v2)
 
   // if TT_XXX is different
   if( v1->tt != v2->tt ) {
+#if MRBC_USE_FIXED
+    if( v1->tt == MRBC_TT_FIXED || v2->tt == MRBC_TT_FIXED ) {
+      return mrbc_fixed_compare( v1, v2 );
+    }
+#endif
 #if MRBC_USE_FLOAT
     // but Numeric?
     if( v1->tt == MRBC_TT_FIXNUM && v2->tt == MRBC_TT_FLOAT ) {
@@ -71,7 +77,7 @@ int mrbc_compare(const mrbc_value *v1, const mrbc_value *v2)
 
   case MRBC_TT_FIXNUM:
   case MRBC_TT_SYMBOL:
-    return v1->i - v2->i;
+    return (v1->i > v2->i) - (v1->i < v2->i);
 
 #if MRBC_USE_FLOAT
   case MRBC_TT_FLOAT:
@@ -80,6 +86,11 @@ int mrbc_compare(const mrbc_value *v1, const mrbc_value *v2)
     goto CMP_FLOAT;
 #endif
 
+#if MRBC_USE_FIXED
+  case MRBC_TT_FIXED:
+    return (v1->fx > v2->fx) - (v1->fx < v2->fx);
+#endif
+
   case MRBC_TT_CLASS:
   case MRBC_TT_OBJECT:
   case MRBC_TT_PROC:
@@ -225,7 +236,7 @@ void mrbc_clear_vm_id(mrbc_value *v)
 */
 mrbc_int mrbc_atoi( const char *s, int base )
 {
-  int ret = 0;
+  mrbc_int ret = 0;
   int sign = 0;
 
  REDO:
@@ -31,8 +31,25 @@ struct RInstance;
 struct RProc;
 
 // mrbc types
+#if MRBC_INT64
+typedef int64_t mrbc_int;
+#define MRBC_INT_MAX		INT64_MAX
+#define MRBC_INT_MIN		INT64_MIN
+#else
 typedef int32_t mrbc_int;
+#define MRBC_INT_MAX		INT32_MAX
+#define MRBC_INT_MIN		INT32_MIN
+#endif
+#if MRBC_FLOAT_SINGLE
+typedef float mrbc_float;
+#define MRBC_FLOAT_FUNC(func)	func##f		// sinf(), sqrtf() ...
+#define mrbc_atof(s)		strtof((s), NULL)
+#else
 typedef double mrbc_float;
+#define MRBC_FLOAT_FUNC(func)	func
+#define mrbc_atof(s)		atof(s)
+#endif
+typedef int32_t mrbc_fixed;
 typedef int16_t mrbc_sym;
 typedef void (*mrbc_func_t)(struct VM *vm, struct RObject *v, int argc);
 
@@ -60,6 +77,7 @@ typedef enum {
   MRBC_TT_FLOAT,
   MRBC_TT_SYMBOL,
   MRBC_TT_CLASS,
+  MRBC_TT_FIXED,
 
   /* non-primitive */
   MRBC_TT_OBJECT = 20,
@@ -109,6 +127,9 @@ struct RObject {
     mrbc_int i;			// MRBC_TT_FIXNUM, SYMBOL
 #if MRBC_USE_FLOAT
     mrbc_float d;		// MRBC_TT_FLOAT
+#endif
+#if MRBC_USE_FIXED
+    mrbc_fixed fx;		// MRBC_TT_FIXED
 #endif
     struct RClass *cls;		// MRBC_TT_CLASS
     struct RObject *handle;	// handle to objects
@@ -145,6 +166,33 @@ typedef struct RObject mrbc_value;
 #define SET_FLOAT_RETURN(n)	do { mrbc_float nnn = (n); \
     mrbc_dec_ref_counter(v); v[0].tt = MRBC_TT_FLOAT; v[0].d = nnn; } while(0)
 
+/*
+  Integer operations with the overflow check.
+  ret = x op y, and if it overflows, ret becomes Float like mruby.
+  (wraps around without Float)
+*/
+#if MRBC_USE_FLOAT
+#define MRBC_INT_OVERFLOW_(ret, x, op, y, n)	\
+  ((ret)->tt = MRBC_TT_FLOAT, (ret)->d = (mrbc_float)(x) op (mrbc_float)(y))
+#else
+#define MRBC_INT_OVERFLOW_(ret, x, op, y, n)	((ret)->i = (n))
+#endif
+
+#define MRBC_INT_OP_(chk, ret, x, op, y)	do {		\
+    mrbc_int x_ = (x), y_ = (y), n_;				\
+    if( chk( x_, y_, &n_ ) ) {					\
+      MRBC_INT_OVERFLOW_( ret, x_, op, y_, n_ );			\
+    } else {							\
+      (ret)->tt = MRBC_TT_FIXNUM;					\
+      (ret)->i = n_;						\
+    }								\
+  } while(0)
+
+#define mrbc_int_add(ret, x, y)	MRBC_INT_OP_(__builtin_add_overflow, ret, x, +, y)
+#define mrbc_int_sub(ret, x, y)	MRBC_INT_OP_(__builtin_sub_overflow, ret, x, -, y)
+#define mrbc_int_mul(ret, x, y)	MRBC_INT_OP_(__builtin_mul_overflow, ret, x, *, y)
+
+
 #define GET_TT_ARG(n)		(v[(n)].tt)
 #define GET_INT_ARG(n)		(v[(n)].i)
 #define GET_ARY_ARG(n)		(v[(n)])
@@ -0,0 +1,434 @@
+/*! @file
+  @brief
+  mruby bytecode verifier.
+
+  <pre>
+  Copyright (C) 2015-2020 Kyushu Institute of Technology.
+  Copyright (C) 2015-2020 Shimane IT Open-Innovation Center.
+
+  This file is distributed under BSD 3-Clause License.
+
+  </pre>
+
+  <pre>
+  Checks all instructions in the irep tree at load time.
+   - known opcode, and the instruction does not overrun ISEQ.
+   - register operands are less than nregs.
+   - pool, symbol and child irep indexes are in range.
+   - jump targets are on instruction boundaries.
+   - upvar levels are in the static nesting, and the registers exist.
+   - register window of nested class bodies (OP_EXEC) fits MAX_REGS_SIZE.
+  The verified irep is marked MRBC_IREP_VERIFIED. mrbc_load_mrb() rejects
+  the irep which fails, so the VM has no run time checks of pools, child
+  ireps, jumps and upvars with the verifier.
+  The depth of method calls depends on dynamic dispatch, so it is not
+  computed here.
+  </pre>
+*/
+
+#include "vm_config.h"
+#include <stdint.h>
+#include <string.h>
+
+#include "vm.h"
+#include "alloc.h"
+#include "opcode.h"
+#include "console.h"
+#include "verify.h"
+
+
+//================================================================
+/*! operand types.
+*/
+enum {
+  OPR_Z, OPR_B, OPR_BB, OPR_BBB, OPR_BS, OPR_S, OPR_W,
+};
+
+//! operand type of each opcode.
+static const uint8_t operand_type[] = {
+  /* 0x00 */ OPR_Z,   OPR_BB,  OPR_BB,  OPR_BB,  OPR_BB,  OPR_B,   OPR_B,   OPR_B,
+  /* 0x08 */ OPR_B,   OPR_B,   OPR_B,   OPR_B,   OPR_B,   OPR_B,   OPR_BB,  OPR_B,
+  /* 0x10 */ OPR_B,   OPR_B,   OPR_B,   OPR_BB,  OPR_BB,  OPR_BB,  OPR_BB,  OPR_BB,
+  /* 0x18 */ OPR_BB,  OPR_BB,  OPR_BB,  OPR_BB,  OPR_BB,  OPR_BB,  OPR_BB,  OPR_BBB,
+  /* 0x20 */ OPR_BBB, OPR_S,   OPR_BS,  OPR_BS,  OPR_BS,  OPR_S,   OPR_B,   OPR_BB,
+  /* 0x28 */ OPR_B,   OPR_B,   OPR_B,   OPR_B,   OPR_BB,  OPR_BB,  OPR_BBB, OPR_BBB,
+  /* 0x30 */ OPR_Z,   OPR_BB,  OPR_BS,  OPR_W,   OPR_BB,  OPR_Z,   OPR_BB,  OPR_B,
+  /* 0x38 */ OPR_B,   OPR_B,   OPR_BS,  OPR_B,   OPR_BB,  OPR_B,   OPR_BB,  OPR_B,
+  /* 0x40 */ OPR_B,   OPR_B,   OPR_B,   OPR_B,   OPR_B,   OPR_B,   OPR_BB,  OPR_BBB,
+  /* 0x48 */ OPR_B,   OPR_B,   OPR_B,   OPR_BBB, OPR_BBB, OPR_BBB, OPR_B,   OPR_BB,
+  /* 0x50 */ OPR_B,   OPR_BB,  OPR_BB,  OPR_B,   OPR_BB,  OPR_BB,  OPR_BB,  OPR_B,
+  /* 0x58 */ OPR_B,   OPR_B,   OPR_BB,  OPR_BB,  OPR_BB,  OPR_BB,  OPR_BB,  OPR_B,
+  /* 0x60 */ OPR_B,   OPR_B,   OPR_BBB, OPR_B,   OPR_Z,   OPR_Z,   OPR_Z,   OPR_Z,
+  /* 0x68 */ OPR_Z,
+};
+
+//! error messages.
+static const char * const error_message[] = {
+  "no error",
+  "unknown opcode",
+  "instruction overrun",
+  "register out of range",
+  "pool index out of range",
+  "symbol index out of range",
+  "irep index out of range",
+  "illegal jump target",
+  "too many registers",
+  "upvar out of range",
+  "not enough memory",
+};
+
+enum {
+  VERIFY_OK,
+  VERIFY_E_OPCODE,
+  VERIFY_E_OVERRUN,
+  VERIFY_E_REGISTER,
+  VERIFY_E_POOL,
+  VERIFY_E_SYMBOL,
+  VERIFY_E_IREP,
+  VERIFY_E_JUMP,
+  VERIFY_E_NREGS,
+  VERIFY_E_UPVAR,
+  VERIFY_E_NOMEM,
+};
+
+//! size of the boundary bitmap on stack. (bits)
+#define BOUNDARY_MAP_STACK	512
+
+
+//================================================================
+/*!@brief
+  chain of the lexical parents, to check upvars.
+*/
+typedef struct IREP_CHAIN {
+  const mrbc_irep *irep;
+  const struct IREP_CHAIN *up;
+} irep_chain;
+
+
+//================================================================
+/*! decode operands of one instruction.
+
+  @param  irep	target irep.
+  @param  pc	position of operands. (next of opcode)
+  @param  op	opcode.
+  @param  ext	ext flag. (1..3 by OP_EXT1..3, or 0)
+  @param  opr	returns operands a,b,c.
+  @return	length of operands, or -1 if overrun.
+*/
+int mrbc_decode_operands( const mrbc_irep *irep, int pc, int op, int ext, uint32_t opr[3] )
+{
+  const uint8_t *p = irep->code + pc;
+  int len;
+
+  opr[0] = opr[1] = opr[2] = 0;
+  switch( operand_type[op] ) {
+  case OPR_Z:	len = 0; break;
+  case OPR_B:	len = 1 + (ext & 1); break;
+  case OPR_BB:	len = 2 + (ext & 1) + ((ext >> 1) & 1); break;
+  case OPR_BBB:	len = 3 + (ext & 1) + ((ext >> 1) & 1); break;
+  case OPR_BS:	len = 3 + (ext & 1); break;
+  case OPR_S:	len = 2; break;
+  case OPR_W:	len = 3; break;
+  default:	len = 0; break;
+  }
+  if( pc + len > irep->ilen ) return -1;
+
+  switch( operand_type[op] ) {
+  case OPR_BBB:
+  case OPR_BB:
+  case OPR_B:
+    if( ext & 1 ) { opr[0] = PEEK_S(p); p += 2; } else { opr[0] = *p++; }
+    if( operand_type[op] == OPR_B ) break;
+    if( ext & 2 ) { opr[1] = PEEK_S(p); p += 2; } else { opr[1] = *p++; }
+    if( operand_type[op] == OPR_BBB ) opr[2] = *p;
+    break;
+
+  case OPR_BS:
+    if( ext & 1 ) { opr[0] = PEEK_S(p); p += 2; } else { opr[0] = *p++; }
+    opr[1] = PEEK_S(p);
+    break;
+
+  case OPR_S:	opr[0] = PEEK_S(p); break;
+  case OPR_W:	opr[0] = PEEK_W(p); break;
+  }
+
+  return len;
+}
+
+
+//================================================================
+/*! mark instruction boundaries in the bitmap. (one forward pass)
+
+  Also checks opcodes and instruction overrun.
+
+  @param  irep	target irep.
+  @param  map	bitmap of ilen bits.
+  @param  info	returns error position.
+  @return	zero if no error.
+*/
+static int mark_boundaries( const mrbc_irep *irep, uint8_t *map, mrbc_verify_info *info )
+{
+  int pc = 0;
+  int ext = 0;
+  uint32_t opr[3];
+
+  memset( map, 0, (irep->ilen + 7) / 8 );
+  while( pc < irep->ilen ) {
+    info->error_pc = pc;
+    map[pc >> 3] |= 1 << (pc & 7);
+
+    int op = irep->code[pc++];
+    if( op > OP_ABORT ) return VERIFY_E_OPCODE;
+
+    int len = mrbc_decode_operands( irep, pc, op, ext, opr );
+    if( len < 0 ) return VERIFY_E_OVERRUN;
+    pc += len;
+    ext = (op >= OP_EXT1 && op <= OP_EXT3) ? op - OP_EXT1 + 1 : 0;
+  }
+
+  return VERIFY_OK;
+}
+
+
+//================================================================
+/*! calculate register window of nested class bodies. (OP_EXEC)
+
+  @param  irep	verified irep.
+  @return	size of register window.
+*/
+static int exec_window( const mrbc_irep *irep )
+{
+  int window = irep->nregs;
+  int pc = 0;
+  int ext = 0;
+  uint32_t opr[3];
+
+  while( pc < irep->ilen ) {
+    int op = irep->code[pc++];
+    pc += mrbc_decode_operands( irep, pc, op, ext, opr );
+    ext = (op >= OP_EXT1 && op <= OP_EXT3) ? op - OP_EXT1 + 1 : 0;
+
+    if( op == OP_EXEC ) {
+      int w = opr[0] + exec_window( irep->reps[opr[1]] );
+      if( w > window ) window = w;
+    }
+  }
+
+  return window;
+}
+
+
+//================================================================
+/*! verify one irep. (not recursive)
+
+  @param  irep	target irep.
+  @param  up	lexical parents.
+  @param  map	boundary bitmap made by mark_boundaries().
+  @param  info	returns error position.
+  @return	zero if no error.
+*/
+static int verify_irep_1( const mrbc_irep *irep, const irep_chain *up,
+			  const uint8_t *map, mrbc_verify_info *info )
+{
+  int n_syms = bin_to_uint32( irep->ptr_to_sym );
+  int pc = 0;
+  int ext = 0;
+  uint32_t opr[3];
+
+  while( pc < irep->ilen ) {
+    info->error_pc = pc;
+    int op = irep->code[pc++];
+    pc += mrbc_decode_operands( irep, pc, op, ext, opr );
+
+    uint32_t a = opr[0], b = opr[1], c = opr[2];
+    int reg_max = -1;	// max register index used.
+    int reg_limit = irep->nregs;
+    int sym = -1, sym2 = -1, pool = -1, rep = -1, jump = -1;
+    const irep_chain *outer = up;
+
+    switch( op ) {
+    case OP_EXT1:
+    case OP_EXT2:
+    case OP_EXT3:
+      ext = op - OP_EXT1 + 1;
+      continue;
+
+    case OP_MOVE:	reg_max = a > b ? a : b; break;
+    case OP_LOADL:	reg_max = a; pool = b; break;
+    case OP_LOADSYM:	reg_max = a; sym = b; break;
+
+    case OP_GETGV: case OP_SETGV: case OP_GETSV: case OP_SETSV:
+    case OP_GETIV: case OP_SETIV: case OP_GETCV: case OP_SETCV:
+    case OP_GETCONST: case OP_SETCONST: case OP_GETMCNST:
+    case OP_KEY_P: case OP_KARG:
+      reg_max = a; sym = b; break;
+    case OP_SETMCNST:	reg_max = a + 1; sym = b; break;
+
+    case OP_GETUPVAR: case OP_SETUPVAR:
+      // R(a), and register b of the outer scope at level c.
+      reg_max = a;
+      while( outer && c-- > 0 ) outer = outer->up;
+      if( !outer || b >= outer->irep->nregs ) return VERIFY_E_UPVAR;
+      break;
+
+    case OP_JMP:	jump = a; break;
+    case OP_ONERR:	jump = a; break;
+    case OP_JMPIF: case OP_JMPNOT: case OP_JMPNIL:
+      reg_max = a; jump = b; break;
+
+    case OP_EPUSH:	rep = a; break;
+    case OP_POPERR: case OP_EPOP:
+      break;
+    case OP_RESCUE:	reg_max = a > b ? a : b; break;
+
+    case OP_SENDV:	reg_max = a + 1; sym = b; break;
+    case OP_SENDVB:	reg_max = a + 2; sym = b; break;
+    case OP_SEND:
+    case OP_SENDB:
+      // block register R(a+c+1) is always written.
+      reg_max = a + (c == 127 ? 1 : c) + 1;
+      reg_limit++;
+      sym = b;
+      break;
+    case OP_SUPER:
+      reg_max = a + (b == 127 ? 1 : b) + 1;
+      reg_limit++;
+      break;
+    case OP_ARGARY:	reg_max = a + 1; break;
+    case OP_BLKPUSH:	reg_max = a; break;
+
+    case OP_ADD: case OP_SUB: case OP_MUL: case OP_DIV:
+    case OP_EQ: case OP_LT: case OP_LE: case OP_GT: case OP_GE:
+    case OP_ARYCAT: case OP_ARYPUSH: case OP_STRCAT: case OP_HASHCAT:
+    case OP_RANGE_INC: case OP_RANGE_EXC:
+      reg_max = a + 1; break;
+
+    case OP_ARRAY:	reg_max = a + (b ? b - 1 : 0); break;
+    case OP_ARRAY2:	reg_max = a > b + c ? a : b + c; break;
+    case OP_AREF:
+    case OP_ASET:	reg_max = a > b ? a : b; break;
+    case OP_APOST:	reg_max = a + c; break;
+    case OP_STRING:	reg_max = a; pool = b; break;
+    case OP_HASH:	reg_max = a + (b ? b * 2 - 1 : 0); break;
+    case OP_HASHADD:	reg_max = a + b * 2; break;
+
+    case OP_LAMBDA: case OP_BLOCK: case OP_METHOD:
+      reg_max = a; rep = b; break;
+    case OP_CLASS:	reg_max = a + 1; sym = b; break;
+    case OP_MODULE:	reg_max = a; sym = b; break;
+    case OP_EXEC:	reg_max = a; rep = b; break;
+    case OP_DEF:	reg_max = a + 1; sym = b; break;
+    case OP_ALIAS:	sym = a; sym2 = b; break;
+    case OP_UNDEF:	sym = a; break;
+    case OP_ERR:	pool = a; break;
+
+    case OP_NOP: case OP_CALL: case OP_ENTER: case OP_KEYEND:
+    case OP_DEBUG: case OP_STOP: case OP_ABORT:
+      break;
+
+    default:	// B type. R(a)
+      reg_max = a; break;
+    }
+    ext = 0;
+
+    if( reg_max >= reg_limit ) return VERIFY_E_REGISTER;
+    if( pool >= irep->plen ) return VERIFY_E_POOL;
+    if( sym >= n_syms || sym2 >= n_syms ) return VERIFY_E_SYMBOL;
+    if( rep >= irep->rlen ) return VERIFY_E_IREP;
+    if( jump >= irep->ilen ) return VERIFY_E_JUMP;
+    if( jump >= 0 && !(map[jump >> 3] & (1 << (jump & 7))) ) return VERIFY_E_JUMP;
+    if( op == OP_STRING &&
+	irep->pools[pool]->tt != MRBC_TT_STRING ) return VERIFY_E_POOL;
+  }
+
+  return VERIFY_OK;
+}
+
+
+//================================================================
+/*! verify irep tree recursively.
+
+  @param  irep	target irep.
+  @param  up	lexical parents, or NULL if top.
+  @param  info	returns result.
+  @param  depth	nesting depth. (top is 1)
+  @return	zero if no error.
+*/
+static int verify_irep_0( mrbc_irep *irep, const irep_chain *up,
+			  mrbc_verify_info *info, int depth )
+{
+  info->n_ireps++;
+  if( irep->nregs > info->max_nregs ) info->max_nregs = irep->nregs;
+  if( depth > info->max_nesting ) info->max_nesting = depth;
+
+  info->error_irep = irep;
+  if( irep->nregs > MAX_REGS_SIZE ) return VERIFY_E_NREGS;
+
+  uint8_t map_stack[BOUNDARY_MAP_STACK / 8];
+  uint8_t *map = map_stack;
+  if( irep->ilen > BOUNDARY_MAP_STACK ) {
+    map = mrbc_raw_alloc( (irep->ilen + 7) / 8 );
+    if( !map ) return VERIFY_E_NOMEM;
+  }
+
+  int ret = mark_boundaries( irep, map, info );
+  if( ret == VERIFY_OK ) ret = verify_irep_1( irep, up, map, info );
+  if( map != map_stack ) mrbc_raw_free( map );
+  if( ret != VERIFY_OK ) return ret;
+  info->error_irep = NULL;
+
+  irep_chain chain = { irep, up };
+  int i;
+  for( i = 0; i < irep->rlen; i++ ) {
+    ret = verify_irep_0( irep->reps[i], &chain, info, depth + 1 );
+    if( ret != VERIFY_OK ) return ret;
+  }
+
+  irep->flags |= MRBC_IREP_VERIFIED;
+  return VERIFY_OK;
+}
+
+
+//================================================================
+/*! verify irep tree.
+
+  @param  irep	top irep.
+  @param  info	returns result.
+  @return int	zero if no error.
+*/
+int mrbc_verify_irep( mrbc_irep *irep, mrbc_verify_info *info )
+{
+  info->n_ireps = 0;
+  info->max_nregs = 0;
+  info->max_nesting = 0;
+  info->max_exec_window = 0;
+  info->error_pc = 0;
+  info->error_irep = NULL;
+
+  int ret = verify_irep_0( irep, NULL, info, 1 );
+  if( ret != VERIFY_OK ) return ret;
+
+  info->max_exec_window = exec_window( irep );
+  if( info->max_exec_window > MAX_REGS_SIZE ) return VERIFY_E_NREGS;
+
+  return VERIFY_OK;
+}
+
+
+//================================================================
+/*! print error message.
+
+  @param  info	result of mrbc_verify_irep()
+  @param  code	return value of mrbc_verify_irep()
+*/
+void mrbc_verify_print_error( const mrbc_verify_info *info, int code )
+{
+  if( code <= 0 || code >= sizeof(error_message)/sizeof(char *) ) return;
+
+  console_printf("VerifyError: %s", error_message[code]);
+  if( info->error_irep ) {
+    console_printf(" at pc=%d (OP=%02x)", info->error_pc,
+		   info->error_irep->code[info->error_pc]);
+  }
+  console_printf(".\n");
+}
@@ -0,0 +1,47 @@
+/*! @file
+  @brief
+  mruby bytecode verifier.
+
+  <pre>
+  Copyright (C) 2015-2020 Kyushu Institute of Technology.
+  Copyright (C) 2015-2020 Shimane IT Open-Innovation Center.
+
+  This file is distributed under BSD 3-Clause License.
+
+  </pre>
+*/
+
+#ifndef MRBC_SRC_VERIFY_H_
+#define MRBC_SRC_VERIFY_H_
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct IREP;
+
+//================================================================
+/*!@brief
+  Result of verification.
+*/
+typedef struct MRBC_VERIFY_INFO {
+  uint16_t n_ireps;		//!< # of ireps in the tree.
+  uint16_t max_nregs;		//!< max nregs in the tree.
+  uint16_t max_nesting;		//!< max nesting depth of ireps. (top is 1)
+  uint16_t max_exec_window;	//!< max register window of class bodies. (OP_EXEC)
+  uint16_t error_pc;		//!< position of error instruction.
+  struct IREP *error_irep;	//!< irep that has error, or NULL.
+} mrbc_verify_info;
+
+
+int mrbc_decode_operands(const struct IREP *irep, int pc, int op, int ext, uint32_t opr[3]);
+int mrbc_verify_irep(struct IREP *irep, mrbc_verify_info *info);
+void mrbc_verify_print_error(const mrbc_verify_info *info, int code);
+
+
+#ifdef __cplusplus
+}
+#endif
+#endif
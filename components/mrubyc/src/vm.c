@@ -31,11 +31,29 @@
 #include "c_range.h"
 #include "c_array.h"
 #include "c_hash.h"
+#include "c_fixed.h"
+#include "opstat.h"
+#include "profiler.h"
+#include "metrics.h"
+#include "objspace.h"
 
 
 static uint16_t free_vm_bitmap[MAX_VM_COUNT / 16 + 1];
 
 
+//================================================================
+/*! true if the current irep is not verified, and needs the run time checks.
+
+  With MRBC_USE_VERIFIER, mrbc_load_mrb() rejects the irep which fails
+  mrbc_verify_irep(), so no instruction checks its operands at run time.
+*/
+#if MRBC_USE_VERIFIER
+#define IREP_UNVERIFIED(vm)	0
+#else
+#define IREP_UNVERIFIED(vm)	(!((vm)->pc_irep->flags & MRBC_IREP_VERIFIED))
+#endif
+
+
 //================================================================
 /*! get sym[n] from symbol table in irep
 
@@ -46,8 +64,10 @@ static uint16_t free_vm_bitmap[MAX_VM_COUNT / 16 + 1];
 static const char * mrbc_get_irep_symbol( struct VM *vm, int n )
 {
   const uint8_t *p = vm->pc_irep->ptr_to_sym;
-  int cnt = bin_to_uint32(p);
-  if( n >= cnt ) return 0;
+  if( IREP_UNVERIFIED(vm) ) {
+    int cnt = bin_to_uint32(p);
+    if( n >= cnt ) return 0;
+  }
   p += 4;
   while( n > 0 ) {
     uint16_t s = bin_to_uint16(p);
@@ -58,6 +78,20 @@ static const char * mrbc_get_irep_symbol( struct VM *vm, int n )
 }
 
 
+//================================================================
+/*! stop the VM by an illegal operand of the unverified irep.
+
+  @param  vm	Pointer to VM
+  @return	-1
+*/
+static int operand_error( struct VM *vm )
+{
+  console_printf("Error: Illegal operand in unverified bytecode.\n");
+  vm->flag_preemption = 1;
+  return -1;
+}
+
+
 //================================================================
 /*! display "not supported" message
 */
@@ -103,7 +137,6 @@ static int send_by_name( struct VM *vm, const char *method_name, mrbc_value *reg
   if( m->c_func ) {
     m->func(vm, regs + a, c);
     if( m->func == c_proc_call ) return 0;
-    if( vm->exc != NULL || vm->exc_pending != NULL ) return 0;
 
     int release_reg = a+1;
     while( release_reg <= bidx ) {
@@ -187,6 +220,14 @@ void mrbc_irep_free(mrbc_irep *irep)
   }
   if( irep->rlen ) mrbc_raw_free( irep->reps );
 
+  // release exception handler table.
+  if( irep->hlen ) mrbc_raw_free( irep->handlers );
+
+#if MRBC_USE_COMPRESSED_MRB
+  // release decompressed image, that the ireps point into.
+  if( irep->image ) mrbc_raw_free( irep->image );
+#endif
+
   mrbc_raw_free( irep );
 }
 
@@ -252,6 +293,171 @@ static mrbc_value * mrbc_get_self( struct VM *vm, mrbc_value *regs )
 }
 
 
+//================================================================
+/*! stop code for the nested run. see run_ensure() and mrbc_call()
+*/
+uint8_t mrbc_nested_stop_code[] = { OP_ABORT };
+
+//! stop code for the exception not rescued in top level.
+static uint8_t stop_code[] = { OP_STOP };
+
+
+//================================================================
+/*! find the exception handler which protects the position.
+
+  @param  irep	target irep.
+  @param  pc	position in irep->code.
+  @param  idx	search handlers[idx-1] to handlers[0].
+  @return	index of handler, or -1 if not found.
+  @note	the handlers are ordered by the position of OP_ONERR/OP_EPUSH,
+	so inner one is found first.
+*/
+static int find_handler( const mrbc_irep *irep, int pc, int idx )
+{
+  while( --idx >= 0 ) {
+    const mrbc_irep_handler *h = &irep->handlers[idx];
+    if( h->begin <= pc && pc < h->end ) break;
+  }
+
+  return idx;
+}
+
+
+//================================================================
+/*! run the ensure clause synchronously.
+
+  The clause runs on the registers above the current frame, with the
+  same self. vm->exc is cleared while it runs.
+
+  @param  vm	pointer of VM.
+  @param  irep	irep of the ensure clause.
+  @return	non-zero if an exception is raised out of the clause.
+*/
+static int run_ensure( mrbc_vm *vm, mrbc_irep *irep )
+{
+  mrbc_irep *pc_irep = vm->pc_irep;
+  uint8_t *inst = vm->inst;
+  mrbc_value *current_regs = vm->current_regs;
+  mrbc_class *target_class = vm->target_class;
+  mrbc_callinfo *callinfo_tail = vm->callinfo_tail;
+  mrbc_class *exc = vm->exc;
+  mrbc_value exc_message = vm->exc_message;
+
+  int reg_offset = pc_irep->nregs;
+  mrbc_value *regs = current_regs + reg_offset;
+  if( regs + irep->nregs > vm->regs + MAX_REGS_SIZE ) {
+    console_printf("Error: Register overflow in ensure.\n");
+    return 0;
+  }
+
+  // OP_RETURN of the clause returns to mrbc_nested_stop_code.
+  vm->inst = mrbc_nested_stop_code;
+  if( !mrbc_push_callinfo(vm, 0, reg_offset, 0) ) {	// ENOMEM
+    vm->inst = inst;
+    return 0;
+  }
+  mrbc_release( &regs[0] );
+  regs[0] = current_regs[0];
+  mrbc_dup( &regs[0] );
+
+  vm->pc_irep = irep;
+  vm->inst = irep->code;
+  vm->current_regs = regs;
+  vm->exc = NULL;
+  vm->exc_message = mrbc_nil_value();
+
+  // preemption does not stop the clause.
+  do {
+    mrbc_vm_run( vm );
+  } while( vm->callinfo_tail != callinfo_tail );
+
+  mrbc_release( &regs[0] );
+  vm->pc_irep = pc_irep;
+  vm->inst = inst;
+  vm->current_regs = current_regs;
+  vm->target_class = target_class;
+
+  // new exception replaces the current one.
+  if( vm->flag_raised ) {
+    mrbc_release( &exc_message );
+    return 1;
+  }
+
+  mrbc_release( &vm->exc_message );
+  vm->exc = exc;
+  vm->exc_message = exc_message;
+
+  return 0;
+}
+
+
+//================================================================
+/*! unwind to the handler of vm->exc.
+
+  Search the handler tables from the current frame to the callers,
+  run the ensure clauses on the way and jump to the rescue clause.
+
+  @param  vm	pointer of VM.
+  @param  idx	search handlers[idx-1] to handlers[0] of the current frame.
+*/
+static void unwind_exception( mrbc_vm *vm, int idx )
+{
+  while( 1 ) {
+    mrbc_irep *irep = vm->pc_irep;
+    int pc = vm->inst - irep->code - 1;	// in the current instruction.
+
+    while( (idx = find_handler( irep, pc, idx )) >= 0 ) {
+      const mrbc_irep_handler *h = &irep->handlers[idx];
+      if( h->type == MRBC_HANDLER_RESCUE ) {
+	vm->inst = irep->code + h->target;
+	return;
+      }
+      if( run_ensure( vm, irep->reps[h->target] ) ) vm->flag_raised = 0;
+    }
+
+    // raise in top level. stop the VM.
+    if( vm->callinfo_tail == NULL ) {
+      console_printf("Exception: %s\n", symid_to_str( vm->exc->sym_id ));
+      vm->inst = stop_code;
+      return;
+    }
+
+    // not rescued in this frame, back to the caller.
+    int i;
+    for( i = 1; i < irep->nregs; i++ ) {
+      mrbc_release( &vm->current_regs[i] );
+    }
+    mrbc_pop_callinfo( vm );
+
+    // return from the nested run, and the caller of it takes over.
+    if( vm->inst == mrbc_nested_stop_code ) {
+      vm->flag_raised = 1;
+      return;
+    }
+    idx = vm->pc_irep->hlen;
+  }
+}
+
+
+//================================================================
+/*! raise the exception in vm->exc.
+
+  The VM unwinds to the handler after the current instruction.
+  Entering begin/ensure costs nothing, because the handlers are
+  looked up in the tables made at load time.
+
+  @param  vm	pointer of VM.
+*/
+void mrbc_vm_raise( struct VM *vm )
+{
+#if MRBC_USE_METRICS
+  mrbc_metric_inc( &mrbc_metric_vm_exceptions );
+#endif
+  vm->flag_raised = 1;
+  vm->flag_preemption = 1;
+}
+
+
 //================================================================
 /*! OP_NOP
 
@@ -303,6 +509,8 @@ static inline int op_loadl( mrbc_vm *vm, mrbc_value *regs )
 {
   FETCH_BB();
 
+  if( IREP_UNVERIFIED(vm) && b >= vm->pc_irep->plen ) return operand_error(vm);
+
   mrbc_release(&regs[a]);
 
   mrbc_object *pool_obj = vm->pc_irep->pools[b];
@@ -345,7 +553,7 @@ static inline int op_loadineg( mrbc_vm *vm, mrbc_value *regs )
   FETCH_BB();
 
   mrbc_release(&regs[a]);
-  regs[a] = mrbc_fixnum_value(-b);
+  regs[a] = mrbc_fixnum_value(-(mrbc_int)b);
   return 0;
 }
 
@@ -699,25 +907,28 @@ static inline int op_getmcnst( mrbc_vm *vm, mrbc_value *regs )
 
 
 //================================================================
-/*! OP_GETUPVAR
+/*! get the pointer to upvar.
 
-  R(a) = uvget(b,c)
-
-  @param  vm    pointer of VM.
-  @param  regs  pointer to regs
-  @retval 0  No error.
+  @param  vm	pointer of VM.
+  @param  regs	pointer to regs
+  @param  b	register of the outer scope.
+  @param  c	level of the outer scope.
+  @return	pointer to upvar, or NULL if illegal operand.
 */
-static inline int op_getupvar( mrbc_vm *vm, mrbc_value *regs )
+static mrbc_value * upvar_ptr( mrbc_vm *vm, mrbc_value *regs, int b, int c )
 {
-  FETCH_BBB();
+  int unverified = IREP_UNVERIFIED(vm);
 
+  if( unverified && regs[0].tt != MRBC_TT_PROC ) return NULL;
   assert( regs[0].tt == MRBC_TT_PROC );
   mrbc_callinfo *callinfo = regs[0].proc->callinfo;
 
   int i;
   for( i = 0; i < c; i++ ) {
+    if( unverified && !callinfo ) return NULL;
     assert( callinfo );
     mrbc_value *regs0 = callinfo->current_regs + callinfo->reg_offset;
+    if( unverified && regs0->tt != MRBC_TT_PROC ) return NULL;
     assert( regs0->tt == MRBC_TT_PROC );
     callinfo = regs0->proc->callinfo;
   }
@@ -728,6 +939,27 @@ static inline int op_getupvar( mrbc_vm *vm, mrbc_value *regs )
   } else {
     p_val = callinfo->current_regs + callinfo->reg_offset + b;
   }
+  if( unverified && p_val >= vm->regs + MAX_REGS_SIZE ) return NULL;
+
+  return p_val;
+}
+
+
+//================================================================
+/*! OP_GETUPVAR
+
+  R(a) = uvget(b,c)
+
+  @param  vm    pointer of VM.
+  @param  regs  pointer to regs
+  @retval 0  No error.
+*/
+static inline int op_getupvar( mrbc_vm *vm, mrbc_value *regs )
+{
+  FETCH_BBB();
+
+  mrbc_value *p_val = upvar_ptr( vm, regs, b, c );
+  if( IREP_UNVERIFIED(vm) && !p_val ) return operand_error(vm);
   mrbc_dup( p_val );
 
   mrbc_release( &regs[a] );
@@ -750,23 +982,8 @@ static inline int op_setupvar( mrbc_vm *vm, mrbc_value *regs )
 {
   FETCH_BBB();
 
-  assert( regs[0].tt == MRBC_TT_PROC );
-  mrbc_callinfo *callinfo = regs[0].proc->callinfo;
-
-  int i;
-  for( i = 0; i < c; i++ ) {
-    assert( callinfo );
-    mrbc_value *regs0 = callinfo->current_regs + callinfo->reg_offset;
-    assert( regs0->tt == MRBC_TT_PROC );
-    callinfo = regs0->proc->callinfo;
-  }
-
-  mrbc_value *p_val;
-  if( callinfo == 0 ) {
-    p_val = vm->regs + b;
-  } else {
-    p_val = callinfo->current_regs + callinfo->reg_offset + b;
-  }
+  mrbc_value *p_val = upvar_ptr( vm, regs, b, c );
+  if( IREP_UNVERIFIED(vm) && !p_val ) return operand_error(vm);
   mrbc_release( p_val );
 
   mrbc_dup( &regs[a] );
@@ -789,6 +1006,7 @@ static inline int op_jmp( mrbc_vm *vm, mrbc_value *regs )
 {
   FETCH_S();
 
+  if( IREP_UNVERIFIED(vm) && a >= vm->pc_irep->ilen ) return operand_error(vm);
   vm->inst = vm->pc_irep->code + a;
 
   return 0;
@@ -808,6 +1026,7 @@ static inline int op_jmpif( mrbc_vm *vm, mrbc_value *regs )
 {
   FETCH_BS();
 
+  if( IREP_UNVERIFIED(vm) && b >= vm->pc_irep->ilen ) return operand_error(vm);
   if( regs[a].tt > MRBC_TT_FALSE ) {
     vm->inst = vm->pc_irep->code + b;
   }
@@ -829,6 +1048,7 @@ static inline int op_jmpnot( mrbc_vm *vm, mrbc_value *regs )
 {
   FETCH_BS();
 
+  if( IREP_UNVERIFIED(vm) && b >= vm->pc_irep->ilen ) return operand_error(vm);
   if( regs[a].tt <= MRBC_TT_FALSE ) {
     vm->inst = vm->pc_irep->code + b;
   }
@@ -850,6 +1070,7 @@ static inline int op_jmpnil( mrbc_vm *vm, mrbc_value *regs )
 {
   FETCH_BS();
 
+  if( IREP_UNVERIFIED(vm) && b >= vm->pc_irep->ilen ) return operand_error(vm);
   if( regs[a].tt == MRBC_TT_NIL ) {
     vm->inst = vm->pc_irep->code + b;
   }
@@ -871,18 +1092,7 @@ static inline int op_onerr( mrbc_vm *vm, mrbc_value *regs )
 {
   FETCH_S();
 
-  mrbc_callinfo *callinfo = mrbc_alloc(vm, sizeof(mrbc_callinfo));
-
-  callinfo->current_regs = vm->current_regs;
-  callinfo->pc_irep = vm->pc_irep;
-  callinfo->inst = vm->pc_irep->code + a;
-  callinfo->reg_offset = 0;
-  callinfo->method_id = 0x7fff;  // rescue
-  callinfo->n_args = 0;
-  callinfo->target_class = vm->target_class;
-  callinfo->own_class = 0;
-  callinfo->prev = vm->exception_tail;
-  vm->exception_tail = callinfo;
+  // nothing to do. the handler is in irep->handlers.
 
   return 0;
 }
@@ -903,11 +1113,7 @@ static inline int op_except( mrbc_vm *vm, mrbc_value *regs )
 
   mrbc_release( &regs[a] );
   regs[a].tt = MRBC_TT_CLASS;
-  if( vm->exc != NULL ){
-    regs[a].cls = vm->exc;
-  } else {
-    regs[a].cls = vm->exc_pending;
-  }
+  regs[a].cls = vm->exc;
 
   return 0;
 }
@@ -979,16 +1185,7 @@ static inline int op_raise( mrbc_vm *vm, mrbc_value *regs )
   FETCH_B();
 
   vm->exc = regs[a].cls;
-
-  mrbc_callinfo *callinfo = vm->callinfo_tail;
-  if( callinfo != NULL ){
-    vm->callinfo_tail = callinfo->prev;
-    vm->pc_irep = callinfo->pc_irep;
-    vm->inst = callinfo->inst;
-    mrbc_free(vm, callinfo);
-  }  else {
-    vm->exc = vm->exc_pending;
-  }
+  mrbc_vm_raise( vm );
 
   return 0;
 }
@@ -1007,18 +1204,7 @@ static inline int op_epush( mrbc_vm *vm, mrbc_value *regs )
 {
   FETCH_B();
 
-  mrbc_callinfo *callinfo = mrbc_alloc(vm, sizeof(mrbc_callinfo));
-
-  callinfo->current_regs = vm->current_regs;
-  callinfo->pc_irep = vm->pc_irep->reps[a];
-  callinfo->inst = vm->pc_irep->reps[a]->code;
-  callinfo->reg_offset = 0;
-  callinfo->method_id = 0x7ffe;   // ensure
-  callinfo->n_args = 0;
-  callinfo->target_class = vm->target_class;
-  callinfo->own_class = 0;
-  callinfo->prev = vm->exception_tail;
-  vm->exception_tail = callinfo;
+  // nothing to do. the handler is in irep->handlers.
 
   return 0;
 }
@@ -1037,20 +1223,22 @@ static inline int op_epop( mrbc_vm *vm, mrbc_value *regs )
 {
   FETCH_B();
 
-  mrbc_callinfo *callinfo = vm->exception_tail;
-  if( callinfo == NULL ){
-    return 0;
-  }
-  vm->exception_tail = callinfo->prev;
+  mrbc_irep *irep = vm->pc_irep;
+  int pc = vm->inst - irep->code - 1;
+  int idx = irep->hlen;
 
-  // same as OP_EXEC
-  mrbc_push_callinfo(vm, 0, 0, 0);
-  vm->pc_irep = callinfo->pc_irep;
-  vm->inst = vm->pc_irep->code;
-  vm->target_class = callinfo->target_class;
-  vm->exc = 0;
+  // run the inner a ensure clauses which protect here.
+  while( a > 0 && (idx = find_handler( irep, pc, idx )) >= 0 ) {
+    const mrbc_irep_handler *h = &irep->handlers[idx];
+    if( h->type != MRBC_HANDLER_ENSURE ) continue;
 
-  mrbc_free(vm, callinfo);
+    if( run_ensure( vm, irep->reps[h->target] ) ) {
+      vm->flag_raised = 0;
+      unwind_exception( vm, idx );
+      break;
+    }
+    a--;
+  }
 
   return 0;
 }
@@ -1100,6 +1288,8 @@ static inline int op_super( mrbc_vm *vm, mrbc_value *regs )
     // expand array
     assert( regs[a+1].tt == MRBC_TT_ARRAY );
 
+    // the elements are moved out of the array, so it must own them.
+    if( mrbc_array_unshare( &regs[a+1] ) != 0 ) return -1;	// ENOMEM
     mrbc_value argary = regs[a+1];
     regs[a+1].tt = MRBC_TT_EMPTY;
     mrbc_value proc = regs[a+2];
@@ -1330,8 +1520,7 @@ static inline int op_return( mrbc_vm *vm, mrbc_value *regs )
 
   // restore irep,pc,reg
   if( vm->callinfo_tail == NULL ){
-    // OP_RETURN in ensure
-    vm->exc = vm->exc_pending;
+    // OP_RETURN in top level
     return 0;
   }
   mrbc_pop_callinfo(vm);
@@ -1496,7 +1685,7 @@ static inline int op_add( mrbc_vm *vm, mrbc_value *regs )
 
   if( regs[a].tt == MRBC_TT_FIXNUM ) {
     if( regs[a+1].tt == MRBC_TT_FIXNUM ) {     // in case of Fixnum, Fixnum
-      regs[a].i += regs[a+1].i;
+      mrbc_int_add( &regs[a], regs[a].i, regs[a+1].i );
       return 0;
     }
 #if MRBC_USE_FLOAT
@@ -1518,6 +1707,15 @@ static inline int op_add( mrbc_vm *vm, mrbc_value *regs )
 #endif
   }
 
+#if MRBC_USE_FIXED
+  mrbc_fixed x, y;
+  if( mrbc_fixed_operands( &regs[a], &regs[a+1], &x, &y ) ) {
+    regs[a].tt = MRBC_TT_FIXED;
+    regs[a].fx = mrbc_fixed_add( x, y );
+    return 0;
+  }
+#endif
+
   // other case
   send_by_name(vm, "+", regs, a, 1, 0);
 
@@ -1539,7 +1737,7 @@ static inline int op_addi( mrbc_vm *vm, mrbc_value *regs )
   FETCH_BB();
 
   if( regs[a].tt == MRBC_TT_FIXNUM ) {
-    regs[a].i += b;
+    mrbc_int_add( &regs[a], regs[a].i, b );
     return 0;
   }
 
@@ -1550,6 +1748,13 @@ static inline int op_addi( mrbc_vm *vm, mrbc_value *regs )
   }
   #endif
 
+  #if MRBC_USE_FIXED
+  if( regs[a].tt == MRBC_TT_FIXED ) {
+    regs[a].fx = mrbc_fixed_add( regs[a].fx, mrbc_fixed_from_int(b) );
+    return 0;
+  }
+  #endif
+
   not_supported();
 
   return 0;
@@ -1571,7 +1776,7 @@ static inline int op_sub( mrbc_vm *vm, mrbc_value *regs )
 
   if( regs[a].tt == MRBC_TT_FIXNUM ) {
     if( regs[a+1].tt == MRBC_TT_FIXNUM ) {     // in case of Fixnum, Fixnum
-      regs[a].i -= regs[a+1].i;
+      mrbc_int_sub( &regs[a], regs[a].i, regs[a+1].i );
       return 0;
     }
 #if MRBC_USE_FLOAT
@@ -1593,6 +1798,15 @@ static inline int op_sub( mrbc_vm *vm, mrbc_value *regs )
 #endif
   }
 
+#if MRBC_USE_FIXED
+  mrbc_fixed x, y;
+  if( mrbc_fixed_operands( &regs[a], &regs[a+1], &x, &y ) ) {
+    regs[a].tt = MRBC_TT_FIXED;
+    regs[a].fx = mrbc_fixed_sub( x, y );
+    return 0;
+  }
+#endif
+
   // other case
   send_by_name(vm, "-", regs, a, 1, 0);
 
@@ -1614,7 +1828,7 @@ static inline int op_subi( mrbc_vm *vm, mrbc_value *regs )
   FETCH_BB();
 
   if( regs[a].tt == MRBC_TT_FIXNUM ) {
-    regs[a].i -= b;
+    mrbc_int_sub( &regs[a], regs[a].i, b );
     return 0;
   }
 
@@ -1625,6 +1839,13 @@ static inline int op_subi( mrbc_vm *vm, mrbc_value *regs )
   }
 #endif
 
+#if MRBC_USE_FIXED
+  if( regs[a].tt == MRBC_TT_FIXED ) {
+    regs[a].fx = mrbc_fixed_sub( regs[a].fx, mrbc_fixed_from_int(b) );
+    return 0;
+  }
+#endif
+
   not_supported();
 
   return 0;
@@ -1646,7 +1867,7 @@ static inline int op_mul( mrbc_vm *vm, mrbc_value *regs )
 
   if( regs[a].tt == MRBC_TT_FIXNUM ) {
     if( regs[a+1].tt == MRBC_TT_FIXNUM ) {     // in case of Fixnum, Fixnum
-      regs[a].i *= regs[a+1].i;
+      mrbc_int_mul( &regs[a], regs[a].i, regs[a+1].i );
       return 0;
     }
 #if MRBC_USE_FLOAT
@@ -1668,6 +1889,15 @@ static inline int op_mul( mrbc_vm *vm, mrbc_value *regs )
 #endif
   }
 
+#if MRBC_USE_FIXED
+  mrbc_fixed x, y;
+  if( mrbc_fixed_operands( &regs[a], &regs[a+1], &x, &y ) ) {
+    regs[a].tt = MRBC_TT_FIXED;
+    regs[a].fx = mrbc_fixed_mul( x, y );
+    return 0;
+  }
+#endif
+
   // other case
   send_by_name(vm, "*", regs, a, 1, 0);
 
@@ -1690,7 +1920,11 @@ static inline int op_div( mrbc_vm *vm, mrbc_value *regs )
 
   if( regs[a].tt == MRBC_TT_FIXNUM ) {
     if( regs[a+1].tt == MRBC_TT_FIXNUM ) {     // in case of Fixnum, Fixnum
-      regs[a].i /= regs[a+1].i;
+      if( regs[a+1].i == -1 ) {	// MIN / -1 overflows.
+	mrbc_int_sub( &regs[a], 0, regs[a].i );
+      } else {
+	regs[a].i /= regs[a+1].i;
+      }
       return 0;
     }
 #if MRBC_USE_FLOAT
@@ -1712,6 +1946,15 @@ static inline int op_div( mrbc_vm *vm, mrbc_value *regs )
 #endif
   }
 
+#if MRBC_USE_FIXED
+  mrbc_fixed x, y;
+  if( mrbc_fixed_operands( &regs[a], &regs[a+1], &x, &y ) ) {
+    regs[a].tt = MRBC_TT_FIXED;
+    regs[a].fx = mrbc_fixed_div( x, y );
+    return 0;
+  }
+#endif
+
   // other case
   send_by_name(vm, "/", regs, a, 1, 0);
 
@@ -1916,10 +2159,11 @@ static inline int op_arycat( mrbc_vm *vm, mrbc_value *regs )
   int size_2 = regs[a+1].array->n_stored;
   int new_size = size_1 + regs[a+1].array->n_stored;
 
+  if( mrbc_array_unshare( &regs[a] ) != 0 ) return -1;	// ENOMEM
+
   // need resize?
-  if( regs[a].array->data_size < new_size ){
-    mrbc_array_resize(&regs[a], new_size);
-  }
+  if( regs[a].array->data_size < new_size &&
+      mrbc_array_resize(&regs[a], new_size) != 0 ) return -1;	// ENOMEM
 
   int i;
   for( i = 0; i < size_2; i++ ) {
@@ -2070,6 +2314,10 @@ static inline int op_string( mrbc_vm *vm, mrbc_value *regs )
   FETCH_BB();
 
 #if MRBC_USE_STRING
+  if( IREP_UNVERIFIED(vm) && (b >= vm->pc_irep->plen ||
+			      vm->pc_irep->pools[b]->tt != MRBC_TT_STRING) ) {
+    return operand_error(vm);
+  }
   mrbc_object *pool_obj = vm->pc_irep->pools[b];
 
   /* CAUTION: pool_obj->str - 2. see IREP POOL structure. */
@@ -2162,6 +2410,8 @@ static inline int op_method( mrbc_vm *vm, mrbc_value *regs )
 {
   FETCH_BB();
 
+  if( IREP_UNVERIFIED(vm) && b >= vm->pc_irep->rlen ) return operand_error(vm);
+
   mrbc_release(&regs[a]);
 
   mrbc_value val = mrbc_proc_new( vm, vm->pc_irep->reps[b] );
@@ -2237,6 +2487,13 @@ static inline int op_exec( mrbc_vm *vm, mrbc_value *regs )
   FETCH_BB();
   assert( regs[a].tt == MRBC_TT_CLASS );
 
+  // the verifier checked the register window of class bodies.
+  if( IREP_UNVERIFIED(vm) &&
+      (b >= vm->pc_irep->rlen ||
+       regs + a + vm->pc_irep->reps[b]->nregs > vm->regs + MAX_REGS_SIZE) ) {
+    return operand_error(vm);
+  }
+
   // prepare callinfo
   mrbc_push_callinfo(vm, 0, 0, 0);
 
@@ -2275,10 +2532,12 @@ static inline int op_def( mrbc_vm *vm, mrbc_value *regs )
 
   mrbc_set_vm_id(proc, 0);
   proc->sym_id = sym_id;
+  mrbc_objspace_delete( MRBC_TT_PROC );	// it is a method now.
 
   // add to class
   proc->next = cls->procs;
   cls->procs = proc;
+  mrbc_method_generation++;
 
   // checking same method
   for( ;proc->next != NULL; proc = proc->next ) {
@@ -2343,6 +2602,7 @@ static inline int op_alias( mrbc_vm *vm, mrbc_value *regs )
   proc_alias->sym_id = sym_id_new;
   proc_alias->next = vm->target_class->procs;
   vm->target_class->procs = proc_alias;
+  mrbc_method_generation++;
 
   return 0;
 }
@@ -2546,6 +2806,9 @@ mrbc_vm *mrbc_vm_open( struct VM *vm_arg )
 #ifdef MRBC_DEBUG
   vm->flag_debug_mode = 1;
 #endif
+#if MRBC_USE_METRICS
+  mrbc_metric_inc( &mrbc_metric_vm_open );
+#endif
 
   return vm;
 }
@@ -2562,6 +2825,9 @@ void mrbc_vm_close( struct VM *vm )
   int idx = (vm->vm_id-1) >> 4;
   int bit = 1 << ((vm->vm_id-1) & 0x0f);
   free_vm_bitmap[idx] &= ~bit;
+#if MRBC_USE_METRICS
+  mrbc_metric_add( &mrbc_metric_vm_open, -1 );
+#endif
 
   // free irep and vm
   if( vm->irep ) mrbc_irep_free( vm->irep );
@@ -2594,7 +2860,7 @@ void mrbc_vm_begin( struct VM *vm )
   vm->target_class = mrbc_class_object;
 
   vm->exc = 0;
-  vm->exception_tail = 0;
+  vm->flag_raised = 0;
 
   vm->error_code = 0;
   vm->flag_preemption = 0;
@@ -2613,6 +2879,59 @@ void mrbc_vm_end( struct VM *vm )
 }
 
 
+#if defined(MRBC_DEBUG) || MRBC_OPCODE_STATS
+static const char * const opcode_names[] = {
+  // 0x00
+  "NOP",     "MOVE",    "LOADL",   "LOADI",
+  "LOADINEG","LOADI__1","LOADI_0", "LOADI_1",
+  "LOADI_2", "LOADI_3", "LOADI_4", "LOADI_5",
+  "LOADI_6", "LOADI_7", "LOADSYM", "LOADNIL",
+  // 0x10
+  "LOADSELF","LOADT",   "LOADF",   "GETGV",
+  "SETGV",   "GETSV",   "SETSV",   "GETIV",
+  "SETIV",   "GETCV",   "SETCV",   "GETCONST",
+  "SETCONST","GETMCNST","SETMCNST","GETUPVAR",
+  // 0x20
+  "SETUPVAR","JMP",     "JMPIF",   "JMPNOT",
+  "JMPNIL",  "ONERR",   "EXCEPT",  "RESCUE",
+  "POPERR",  "RAISE",   "EPUSH",   "EPOP",
+  "SENDV",   "SENDVB",  "SEND",    "SENDB",
+  // 0x30
+  "CALL",    "SUPER",   "ARGARY",  "ENTER",
+  "KEY_P",   "KEYEND",  "KARG",    "RETURN",
+  "RETURN_BLK","BREAK", "BLKPUSH", "ADD",
+  "ADDI",    "SUB",     "SUBI",    "MUL",
+  // 0x40
+  "DIV",     "EQ",      "LT",      "LE",
+  "GT",      "GE",      "ARRAY",   "ARRAY2",
+  "ARYCAT",  "ARYPUSH", "ARYDUP",  "AREF",
+  "ASET",    "APOST",   "INTERN",  "STRING",
+  // 0x50
+  "STRCAT",  "HASH",    "HASHADD", "HASHCAT",
+  "LAMBDA",  "BLOCK",   "METHOD",  "RANGE_INC",
+  "RANGE_EXC","OCLASS", "CLASS",   "MODULE",
+  "EXEC",    "DEF",     "ALIAS",   "UNDEF",
+  // 0x60
+  "SCLASS",  "TCLASS",  "DEBUG",   "ERR",
+  "EXT1",    "EXT2",    "EXT3",    "STOP",
+  "ABORT",
+};
+
+
+//================================================================
+/*! get the name of opcode.
+
+  @param  opcode   opcode
+  @return	   name without "OP_", or NULL if unknown.
+*/
+const char *mrbc_opcode_name( uint8_t opcode )
+{
+  if( opcode < sizeof(opcode_names)/sizeof(char *) ) return opcode_names[opcode];
+  return NULL;
+}
+#endif
+
+
 //================================================================
 /*! output op for debug
 
@@ -2621,49 +2940,9 @@ void mrbc_vm_end( struct VM *vm )
 #ifdef MRBC_DEBUG
 void output_opcode( uint8_t opcode )
 {
-  const char *n[] = {
-    // 0x00
-    "NOP",     "MOVE",    "LOADL",   "LOADI",
-    "LOADINEG","LOADI__1","LOADI_0", "LOADI_1",
-    "LOADI_2", "LOADI_3", "LOADI_4", "LOADI_5",
-    "LOADI_6", "LOADI_7", "LOADSYM", "LOADNIL",
-    // 0x10
-    "LOADSELF","LOADT",   "LOADF",   "GETGV",
-    "SETGV",   "GETSV",   "SETSV",   "GETIV",
-    "SETIV",   "GETCV",   "SETCV",   "GETCONST",
-    "SETCONST","GETMCNST","SETMCNST","GETUPVAR",
-    // 0x20
-    "SETUPVAR","JMP",     "JMPIF",   "JMPNOT",
-    "JMPNIL",  "ONERR",   "EXCEPT",  "RESCUE",
-    "POPERR",  "RAISE",   "EPUSH",   "EPOP",
-    "SENDV",   "SENDVB",  "SEND",    "SENDB",
-    // 0x30
-    "CALL",    "SUPER",   "ARGARY",  "ENTER",
-    "KEY_P",   "KEYEND",  "KARG",    "RETURN",
-    "RETRUN_BLK","BREAK", "BLKPUSH", "ADD",
-    "ADDI",    "SUB",     "SUBI",    "MUL",
-    // 0x40
-    "DIV",     "EQ",      "LT",      "LE",
-    "GT",      "GE",      "ARRAY",   "ARRAY2",
-    "ARYCAT",  "ARYPUSH", "ARYDUP",  "AREF",
-    "ASET",    "APOST",   "INTERN",  "STRING",
-    // 0x50
-    "STRCAT",  "HASH",    "HASHADD", "HASHCAT",
-    "LAMBDA",  "BLOCK",   "METHOD",  "RANGE_INC",
-    "RANGE_EXC","OCLASS", "CLASS",   "MODULE",
-    "EXEC",    "DEF",     "ALIAS",   "UNDEF",
-    // 0x60
-    "SCLASS",  "TCLASS",  "DEBUG",   "ERR",
-    "EXT1",    "EXT2",    "EXT3",    "STOP",
-    "ABORT",
-  };
-
-  if( opcode < sizeof(n)/sizeof(char *) ){
-    if( n[opcode] ){
-      console_printf("(OP_%s)\n", n[opcode]);
-    } else {
-      console_printf("(OP=%02x)\n", opcode);
-    }
+  const char *name = mrbc_opcode_name( opcode );
+  if( name ) {
+    console_printf("(OP_%s)\n", name);
   } else {
     console_printf("(ERROR=%02x)\n", opcode);
   }
@@ -2681,6 +2960,7 @@ int mrbc_vm_run( struct VM *vm )
 {
   int ret = 0;
 
+  vm->run_nest++;
   do {
     // regs
     mrbc_value *regs = vm->current_regs;
@@ -2691,6 +2971,13 @@ int mrbc_vm_run( struct VM *vm )
     // output OP_XXX for debug
     //if( vm->flag_debug_mode )output_opcode( op );
 
+#if MRBC_OPCODE_STATS
+    mrbc_opstat_count( vm, op );
+#if MRBC_OPCODE_CYCLES
+    uint32_t opstat_t0 = hal_cycle_count();
+#endif
+#endif
+
     switch( op ) {
     case OP_NOP:        ret = op_nop       (vm, regs); break;
     case OP_MOVE:       ret = op_move      (vm, regs); break;
@@ -2803,12 +3090,23 @@ int mrbc_vm_run( struct VM *vm )
       break;
     }
 
-    // raise in top level
-    // exit vm
-    if( vm->exception_tail == NULL && vm->callinfo_tail == NULL && vm->exc ) return 0;
-  } while( !vm->flag_preemption );
+#if MRBC_OPCODE_STATS && MRBC_OPCODE_CYCLES
+    mrbc_opstat_cycles( op, hal_cycle_count() - opstat_t0 );
+#endif
 
-  vm->flag_preemption = 0;
+    if( !vm->flag_preemption ) continue;
+    vm->flag_preemption = 0;
+
+#if MRBC_USE_PROFILER
+    if( mrbc_profiler.requested ) mrbc_profiler_sample( vm );
+#endif
+
+    // unwind the exception raised in this instruction.
+    if( ret != 0 || !vm->flag_raised ) break;
+    vm->flag_raised = 0;
+    unwind_exception( vm, vm->pc_irep->hlen );
+  } while( 1 );
+  vm->run_nest--;
 
   return ret;
 }
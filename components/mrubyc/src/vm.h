@@ -29,17 +29,43 @@ extern "C" {
 /*!@brief
   IREP Internal REPresentation
 */
+#define MRBC_IREP_VERIFIED 0x01	//!< passed mrbc_verify_irep()
+
+#define MRBC_HANDLER_RESCUE 0
+#define MRBC_HANDLER_ENSURE 1
+
+//================================================================
+/*!@brief
+  Exception handler of IREP, made at load time from OP_ONERR/OP_EPUSH.
+*/
+typedef struct IREP_HANDLER {
+  uint8_t type;			//!< MRBC_HANDLER_RESCUE or MRBC_HANDLER_ENSURE
+  uint16_t begin;		//!< protected region. (begin <= pc < end)
+  uint16_t end;
+  uint16_t target;		//!< rescue: jump address, ensure: index of reps.
+} mrbc_irep_handler;
+
+
 typedef struct IREP {
   uint16_t nlocals;		//!< # of local variables
   uint16_t nregs;		//!< # of register variables
   uint16_t rlen;		//!< # of child IREP blocks
   uint16_t ilen;		//!< # of irep
   uint16_t plen;		//!< # of pool
+  uint8_t flags;		//!< MRBC_IREP_xxx
+  uint8_t hlen;			//!< # of exception handlers
 
   uint8_t     *code;		//!< ISEQ (code) BLOCK
   mrbc_object **pools;		//!< array of POOL objects pointer.
   uint8_t     *ptr_to_sym;
   struct IREP **reps;		//!< array of child IREP's pointer.
+  mrbc_irep_handler *handlers;	//!< exception handler table.
+#if MRBC_USE_COMPRESSED_MRB
+  uint8_t *image;		//!< decompressed image owned by the root irep.
+#endif
+#if MRBC_OPCODE_STATS
+  uint32_t n_exec;		//!< # of executed instructions.
+#endif
 
 } mrbc_irep;
 typedef struct IREP mrb_irep;
@@ -87,14 +113,15 @@ typedef struct VM {
   uint8_t flag_debug_mode;
 #endif
 
-  mrbc_class *exc, *exc_pending;
+  mrbc_class *exc;
   mrbc_value exc_message;  // exception message
-  mrbc_callinfo *exception_tail;
 
   int32_t error_code;
 
   volatile int8_t flag_preemption;
   int8_t flag_need_memfree;
+  int8_t flag_raised;	// exc is raised and not unwound yet.
+  uint8_t run_nest;	// nesting of mrbc_vm_run. zero if not running.
 } mrbc_vm;
 typedef struct VM mrb_vm;
 
@@ -111,6 +138,10 @@ void mrbc_vm_close(struct VM *vm);
 void mrbc_vm_begin(struct VM *vm);
 void mrbc_vm_end(struct VM *vm);
 int mrbc_vm_run(struct VM *vm);
+const char *mrbc_opcode_name(uint8_t opcode);
+void mrbc_vm_raise(struct VM *vm);
+
+extern uint8_t mrbc_nested_stop_code[];
 
 
 
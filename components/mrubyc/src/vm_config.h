@@ -35,6 +35,11 @@
 #define MAX_EXCEPTION_COUNT 16
 #endif
 
+// maximum number of classes which have instance pool
+#if !defined(MAX_INSTANCE_POOLS)
+#define MAX_INSTANCE_POOLS 4
+#endif
+
 
 // memory management
 //  MRBC_ALLOC_16BIT or MRBC_ALLOC_24BIT
@@ -49,6 +54,30 @@
 #define MRBC_USE_FLOAT 1
 #endif
 
+// Integer is 64 bit. (default 32 bit)
+//  Timestamps in milliseconds or microseconds can be handled as Integer.
+//  In either case, the overflowed result of + - * becomes Float.
+#if !defined(MRBC_INT64)
+#define MRBC_INT64 0
+#endif
+
+// Float is single precision. (float instead of double)
+//  For targets which have only single precision FPU, such as ESP32.
+//  Float has about 7 significant digits, and mrbc_value gets smaller.
+#if !defined(MRBC_FLOAT_SINGLE)
+#define MRBC_FLOAT_SINGLE 0
+#endif
+
+// Use Fixed. Support Fixed class. (fixed-point number)
+#if !defined(MRBC_USE_FIXED)
+#define MRBC_USE_FIXED 1
+#endif
+
+// Fraction bits of Fixed. 16: Q16.16, 8: Q24.8
+#if !defined(MRBC_FIXED_FRAC_BITS)
+#define MRBC_FIXED_FRAC_BITS 16
+#endif
+
 // Use math. Support Math class.
 #if !defined(MRBC_USE_MATH)
 #define MRBC_USE_MATH 1
@@ -68,6 +97,132 @@
 #define MRBC_USE_STRING 1
 #endif
 
+// Use Struct. Support Struct class.
+#if !defined(MRBC_USE_STRUCT)
+#define MRBC_USE_STRUCT 1
+#endif
+
+// Use RingBuffer. Support RingBuffer class.
+#if !defined(MRBC_USE_RINGBUFFER)
+#define MRBC_USE_RINGBUFFER 1
+#endif
+
+// Use instance pool. Support instance_pool and mrbc_define_instance_pool().
+#if !defined(MRBC_USE_INSTANCE_POOL)
+#define MRBC_USE_INSTANCE_POOL 1
+#endif
+
+// Use compressed bytecode (.mrbz) images.
+#if !defined(MRBC_USE_COMPRESSED_MRB)
+#define MRBC_USE_COMPRESSED_MRB 1
+#endif
+
+// Use hot code swap. Support mrbc_replace_task() and mrbc_reload_mrblib().
+#if !defined(MRBC_USE_HOT_SWAP)
+#define MRBC_USE_HOT_SWAP 1
+#endif
+
+// Use bytecode verifier at load time.
+#if !defined(MRBC_USE_VERIFIER)
+#define MRBC_USE_VERIFIER 1
+#endif
+
+// Use Log class. (deferred-format binary logging)
+//  MRBC_LOG_BUFFER_SIZE: ring buffer size in 32-bit words. (power of 2)
+//  MRBC_LOG_FLUSH_IDLE: write out the records when the scheduler is idle.
+#if !defined(MRBC_USE_LOG)
+#define MRBC_USE_LOG 1
+#endif
+#if !defined(MRBC_LOG_BUFFER_SIZE)
+#define MRBC_LOG_BUFFER_SIZE 256
+#endif
+#if !defined(MRBC_LOG_DEFAULT_LEVEL)
+#define MRBC_LOG_DEFAULT_LEVEL 1
+#endif
+#if !defined(MRBC_LOG_FLUSH_IDLE)
+#define MRBC_LOG_FLUSH_IDLE 1
+#endif
+
+// Instrumentation build. Count executions of each opcode, irep and method.
+// (VM.opcode_stats) MRBC_OPCODE_CYCLES also measures the cycles of each
+// opcode with hal_cycle_count(), into log2 histograms.
+#if !defined(MRBC_OPCODE_STATS)
+#define MRBC_OPCODE_STATS 0
+#endif
+#if !defined(MRBC_OPCODE_CYCLES)
+#define MRBC_OPCODE_CYCLES 0
+#endif
+#if !defined(MRBC_OPCODE_HIST_BUCKETS)
+#define MRBC_OPCODE_HIST_BUCKETS 16
+#endif
+
+// Use sampling profiler. (Profiler class)
+//  MRBC_PROFILER_STACKS: # of distinct call stacks and pcs recorded.
+//  MRBC_PROFILER_DEPTH: max depth of a recorded call stack.
+#if !defined(MRBC_USE_PROFILER)
+#define MRBC_USE_PROFILER 0
+#endif
+#if !defined(MRBC_PROFILER_STACKS)
+#define MRBC_PROFILER_STACKS 32
+#endif
+#if !defined(MRBC_PROFILER_DEPTH)
+#define MRBC_PROFILER_DEPTH 8
+#endif
+
+// Use Benchmark class and Time.monotonic_us. (needs hal_time_us)
+#if !defined(MRBC_USE_BENCHMARK)
+#define MRBC_USE_BENCHMARK 1
+#endif
+
+// Use metrics registry. (Metrics class, "vm.*", "heap.*" and "sched.*")
+//  MRBC_METRICS_MAX: # of metrics, built-in ones included.
+#if !defined(MRBC_USE_METRICS)
+#define MRBC_USE_METRICS 1
+#endif
+#if !defined(MRBC_METRICS_MAX)
+#define MRBC_METRICS_MAX 32
+#endif
+
+// Count allocations and the peak of heap usage. (mrbc_alloc_counter)
+// The heap metrics need this.
+#if !defined(MRBC_ALLOC_STATS)
+#define MRBC_ALLOC_STATS MRBC_USE_METRICS
+#endif
+
+// Count live objects by type and by class. (ObjectSpace)
+#if !defined(MRBC_USE_OBJSPACE)
+#define MRBC_USE_OBJSPACE 1
+#endif
+
+// Console output buffer size in bytes. 0 means write through. (not buffered)
+#if !defined(MRBC_CONSOLE_BUFFER_SIZE)
+#define MRBC_CONSOLE_BUFFER_SIZE 1024
+#endif
+
+// Console flush policy.
+//  FLUSH_NEWLINE: flush when a newline is written.
+//  FLUSH_SIZE: flush when the buffered bytes reach this size.
+//  FLUSH_MS: the scheduler flushes the buffer at a task switch
+//            if the last flush is older than this.
+//  The buffer is always flushed when the scheduler becomes idle.
+//  Without FLUSH_NEWLINE, printf() in C methods may come out before the
+//  buffered Ruby output, and a crash loses the buffered lines.
+#if !defined(MRBC_CONSOLE_FLUSH_NEWLINE)
+#define MRBC_CONSOLE_FLUSH_NEWLINE 1
+#endif
+#if !defined(MRBC_CONSOLE_FLUSH_SIZE)
+#define MRBC_CONSOLE_FLUSH_SIZE (MRBC_CONSOLE_BUFFER_SIZE * 3 / 4)
+#endif
+#if !defined(MRBC_CONSOLE_FLUSH_MS)
+#define MRBC_CONSOLE_FLUSH_MS 50
+#endif
+
+// When the console buffer is full, drop the output instead of
+// waiting for the flush.
+#if !defined(MRBC_CONSOLE_DROP_WHEN_FULL)
+#define MRBC_CONSOLE_DROP_WHEN_FULL 0
+#endif
+
 
 /* Hardware dependent flags */
 
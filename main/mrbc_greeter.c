@@ -1,22 +1,20 @@
 #include "mrubyc.h"
 
-static struct RClass* mrbc_class_esp32_greeter;
-
 /* C 言語での "Hello World"*/
 void c_hello(){
   printf("Hello, world!\n");
 }
 
-/* ラッパープログラム */
-static void
-ruby_hello(mrb_vm* vm, mrb_value* v, int argc)
-{
-  c_hello();  //別プログラムを呼び出す
-}
+/* ラッパープログラム (引数の検査と戻り値の設定はマクロが生成する) */
+MRBC_BIND_0( ruby_hello, NIL, c_hello )
+
+static const mrbc_method_table greeter_methods[] = {
+  { "greet", ruby_hello },
+};
 
 void
 mrbc_greeter_gem_init(struct VM* vm)
 {
-  mrbc_class_esp32_greeter = mrbc_define_class(vm, "Greeter", mrbc_class_object);
-  mrbc_define_method(vm, mrbc_class_esp32_greeter, "greet", ruby_hello);
+  mrbc_define_class_with_methods(vm, "Greeter", mrbc_class_object,
+                                 greeter_methods, MRBC_COUNTOF(greeter_methods));
 }
@@ -0,0 +1,115 @@
+/*! @file
+  @brief
+  Benchmark of Float throughput and accuracy, double vs MRBC_FLOAT_SINGLE.
+
+  <pre>
+  Copyright (C) 2015-2020 Kyushu Institute of Technology.
+  Copyright (C) 2015-2020 Shimane IT Open-Innovation Center.
+
+  This file is distributed under BSD 3-Clause License.
+
+  (usage)
+  $ cc -O2 -I components/mrubyc/src -o bench_double tools/bench_float.c -lm
+  $ cc -O2 -I components/mrubyc/src -DMRBC_FLOAT_SINGLE=1 \
+      -o bench_single tools/bench_float.c -lm
+  $ ./bench_double; ./bench_single
+
+  The kernels use mrbc_float and MRBC_FLOAT_FUNC() in the same way as
+  the VM and the Math class. On a PC both types run on the hardware FPU,
+  so build it with the target toolchain to see the difference of the
+  single precision FPU. (ESP32: double is done by the soft-float library)
+  The errors are relative to the long double results.
+  </pre>
+*/
+
+#include <stdio.h>
+#include <math.h>
+#include <time.h>
+
+#include "value.h"
+
+#define N_DATA 1024
+#define MIN_BENCH_NSEC 200000000.0
+
+static mrbc_float data[N_DATA];
+static volatile mrbc_float sink;
+
+
+static double now_nsec( void )
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+
+/*
+  kernels. (one pass over the data)
+*/
+static mrbc_float k_arith( int i )
+{
+  return data[i] * data[(i + 1) % N_DATA] + data[i] / (data[(i + 2) % N_DATA] + 1);
+}
+static mrbc_float k_sqrt( int i ) { return MRBC_FLOAT_FUNC(sqrt)( data[i] ); }
+static mrbc_float k_sin( int i ) { return MRBC_FLOAT_FUNC(sin)( data[i] ); }
+static mrbc_float k_exp( int i ) { return MRBC_FLOAT_FUNC(exp)( data[i] / 16 ); }
+static mrbc_float k_pow( int i ) { return MRBC_FLOAT_FUNC(pow)( data[i], (mrbc_float)1.5 ); }
+
+static long double r_arith( int i )
+{
+  long double a = data[i], b = data[(i + 1) % N_DATA], c = data[(i + 2) % N_DATA];
+  return a * b + a / (c + 1);
+}
+static long double r_sqrt( int i ) { return sqrtl( data[i] ); }
+static long double r_sin( int i ) { return sinl( data[i] ); }
+static long double r_exp( int i ) { return expl( (long double)data[i] / 16 ); }
+static long double r_pow( int i ) { return powl( data[i], 1.5L ); }
+
+
+static void bench( const char *name, mrbc_float (*kernel)(int),
+		   long double (*ref)(int) )
+{
+  double t0 = now_nsec(), t;
+  long n = 0;
+  int i;
+
+  do {
+    mrbc_float sum = 0;
+    for( i = 0; i < N_DATA; i++ ) sum += kernel(i);
+    sink = sum;
+    n += N_DATA;
+  } while( (t = now_nsec() - t0) < MIN_BENCH_NSEC );
+
+  long double max_err = 0;
+  for( i = 0; i < N_DATA; i++ ) {
+    long double r = ref(i);
+    long double err = fabsl( (kernel(i) - r) / (r != 0 ? r : 1) );
+    if( err > max_err ) max_err = err;
+  }
+
+  printf("%-8s %8.2f Mop/s   max rel.err %.3Le\n", name, n / t * 1e3, max_err);
+}
+
+
+int main( void )
+{
+  int i;
+  unsigned int x = 1;
+
+  for( i = 0; i < N_DATA; i++ ) {
+    x = x * 1103515245 + 12345;
+    data[i] = (mrbc_float)((x >> 8) % 100000) / 1000;	// 0.000 .. 99.999
+  }
+
+  printf("mrbc_float: %s (%d bytes), mrbc_value: %d bytes\n",
+	 MRBC_FLOAT_SINGLE ? "float" : "double",
+	 (int)sizeof(mrbc_float), (int)sizeof(mrbc_value));
+
+  bench( "arith", k_arith, r_arith );
+  bench( "sqrt", k_sqrt, r_sqrt );
+  bench( "sin", k_sin, r_sin );
+  bench( "exp", k_exp, r_exp );
+  bench( "pow", k_pow, r_pow );
+
+  return 0;
+}
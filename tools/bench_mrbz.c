@@ -0,0 +1,138 @@
+/*! @file
+  @brief
+  Host benchmark for compressed bytecode (.mrbz) decompression.
+
+  <pre>
+  Copyright (C) 2015-2020 Kyushu Institute of Technology.
+  Copyright (C) 2015-2020 Shimane IT Open-Innovation Center.
+
+  This file is distributed under BSD 3-Clause License.
+
+  (usage)
+  $ cc -O2 -I components/mrubyc/src -o bench_mrbz \
+      tools/bench_mrbz.c components/mrubyc/src/decompress.c
+  $ ruby tools/mrbz.rb -o app.mrbz app.mrb
+  $ ./bench_mrbz app.mrbz app.mrb
+  </pre>
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "decompress.h"
+
+#define CHUNK_SIZE 64
+#define MIN_BENCH_NSEC 500000000.0
+
+
+static uint8_t *read_file( const char *fname, long *size )
+{
+  FILE *fp = fopen(fname, "rb");
+  if( !fp ) {
+    perror(fname);
+    exit(1);
+  }
+  fseek(fp, 0, SEEK_END);
+  *size = ftell(fp);
+  fseek(fp, 0, SEEK_SET);
+
+  uint8_t *buf = malloc(*size);
+  if( fread(buf, 1, *size, fp) != (size_t)*size ) {
+    perror(fname);
+    exit(1);
+  }
+  fclose(fp);
+  return buf;
+}
+
+
+static double now_nsec( void )
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+
+static int unpack( const uint8_t *z, uint8_t *dst, uint32_t size, uint32_t zsize, int w, int l, uint32_t chunk )
+{
+  mrbc_decompress d;
+  mrbc_decompress_init(&d, dst, size, w, l);
+
+  const uint8_t *p = z + MRBC_MRBZ_HEADER_SIZE;
+  uint32_t remain = zsize;
+  while( 1 ) {
+    uint32_t n = remain < chunk ? remain : chunk;
+    int r = mrbc_decompress_feed(&d, p, n);
+    if( r != 0 ) return r;
+    if( remain == 0 ) return -1;
+    p += n;
+    remain -= n;
+  }
+}
+
+
+int main( int argc, char *argv[] )
+{
+  if( argc < 2 ) {
+    fprintf(stderr, "usage: %s file.mrbz [original.mrb]\n", argv[0]);
+    return 1;
+  }
+
+  long zfile_size;
+  uint8_t *z = read_file(argv[1], &zfile_size);
+  uint32_t size, zsize;
+  int w, l;
+  if( mrbc_decompress_header(z, &size, &zsize, &w, &l) != 0 ) {
+    fprintf(stderr, "%s: not a .mrbz image\n", argv[1]);
+    return 1;
+  }
+  uint8_t *dst = malloc(size);
+
+  printf("%s: %u -> %ld bytes, window %d bits, lookahead %d bits\n",
+	 argv[1], size, zfile_size, w, l);
+
+  if( argc >= 3 ) {
+    long orig_size;
+    uint8_t *orig = read_file(argv[2], &orig_size);
+    if( unpack(z, dst, size, zsize, w, l, 1) != 1 ||
+	orig_size != size || memcmp(orig, dst, size) != 0 ) {
+      printf("verify: NG\n");
+      return 1;
+    }
+    printf("verify: OK\n");
+    free(orig);
+  }
+
+  static const uint32_t chunks[] = { CHUNK_SIZE, UINT32_MAX };
+  int i;
+  for( i = 0; i < 2; i++ ) {
+    long n = 0;
+    double t0 = now_nsec(), t1;
+    do {
+      unpack(z, dst, size, zsize, w, l, chunks[i]);
+      n++;
+      t1 = now_nsec();
+    } while( t1 - t0 < MIN_BENCH_NSEC );
+
+    double us = (t1 - t0) / n / 1000;
+    printf("decompress (%s): %8.2f us/image, %7.2f MB/s\n",
+	   i == 0 ? "64 byte chunks" : "whole image   ", us, size / us);
+  }
+
+  long n = 0;
+  double t0 = now_nsec(), t1;
+  do {
+    memcpy(dst, z, size < zfile_size ? size : zfile_size);
+    __asm__ volatile("" ::: "memory");
+    n++;
+    t1 = now_nsec();
+  } while( t1 - t0 < MIN_BENCH_NSEC );
+  printf("memcpy (reference)         : %8.2f us/image\n", (t1 - t0) / n / 1000);
+
+  free(dst);
+  free(z);
+  return 0;
+}
@@ -0,0 +1,105 @@
+#!/usr/bin/env ruby
+#
+# mrbbundle.rb - make a bundle image of many .mrb modules for mruby/c.
+#
+# Copyright (C) 2015-2020 Kyushu Institute of Technology.
+# Copyright (C) 2015-2020 Shimane IT Open-Innovation Center.
+#
+#  This file is distributed under BSD 3-Clause License.
+#
+# usage:
+#  ruby mrbbundle.rb [-B symbol] -o output MODULE...
+#
+#  MODULE is  KIND:NAME=FILE[@DEP,DEP...][%PRIORITY]
+#    KIND      lib, task or dormant
+#    NAME      module name (max 19 chars)
+#    DEP       names of lib modules which must run before this module.
+#    PRIORITY  task priority (1..255)
+#
+#  (e.g.)
+#   ruby mrbbundle.rb -B app_bundle -o main/app_bundle.c \
+#     lib:greeter=build/greeter.mrb lib:hey=build/hey.mrb@greeter \
+#     task:master=build/master.mrb task:slave=build/slave.mrb%100
+#
+#  See components/mrubyc/src/bundle.c for the image format.
+#
+
+KINDS = { "lib" => 0, "task" => 1, "dormant" => 2 }
+
+def crc16(data)
+  crc = 0xffff
+  data.each_byte {|b|
+    crc ^= b << 8
+    8.times { crc = (crc & 0x8000) != 0 ? ((crc << 1) ^ 0x1021) & 0xffff : (crc << 1) & 0xffff }
+  }
+  crc
+end
+
+def usage
+  STDERR.puts "usage: #{$0} [-B symbol] -o output KIND:NAME=FILE[@DEP,...][%PRIORITY]..."
+  exit 1
+end
+
+symbol = nil
+output = nil
+modules = []
+
+while arg = ARGV.shift
+  case arg
+  when "-B" then symbol = ARGV.shift
+  when "-o" then output = ARGV.shift
+  when /\A(lib|task|dormant):([^=]+)=([^@%]+)(?:@([^%]+))?(?:%(\d+))?\z/
+    raise "name too long: #{$2}" if $2.bytesize >= 20
+    modules << { kind: KINDS[$1], name: $2, file: $3,
+                 deps: ($4 || "").split(","), priority: ($5 || 0).to_i,
+                 data: File.binread($3) }
+  else
+    usage
+  end
+end
+usage if !output || modules.empty?
+
+# sort libraries in dependency order. (stable, tasks come last)
+sorted = []
+visit = lambda {|m, path|
+  next if sorted.include?(m)
+  raise "circular dependency: #{(path + [m[:name]]).join(' -> ')}" if path.include?(m[:name])
+  m[:deps].each {|d|
+    dep = modules.find {|x| x[:name] == d } or raise "unknown module: #{d}"
+    visit.(dep, path + [m[:name]])
+  }
+  sorted << m
+}
+modules.select {|m| m[:kind] == 0 }.each {|m| visit.(m, []) }
+modules.reject {|m| m[:kind] == 0 }.each {|m| visit.(m, []) }
+
+# build image.
+offset = 16 + 32 * sorted.size
+toc = "".b
+body = "".b
+sorted.each {|m|
+  raise "#{m[:file]}: not a .mrb/.mrbz binary" unless m[:data].start_with?("RITE", "MRBZ")
+  pad = (4 - (offset + body.bytesize) % 4) % 4
+  body << "\0" * pad
+  toc << [m[:name], offset + body.bytesize, m[:data].bytesize,
+          m[:kind], m[:priority], crc16(m[:data])].pack("a20NNCCn")
+  body << m[:data]
+}
+image = ["MRBB0001", offset + body.bytesize, sorted.size, crc16(toc)].pack("a8Nnn") + toc + body
+
+if symbol
+  File.open(output, "w") {|f|
+    f.puts "/* mruby/c bundle: #{sorted.map {|m| m[:name] }.join(', ')} */"
+    f.puts "#include <stdint.h>"
+    f.puts "extern const uint8_t #{symbol}[];"
+    f.puts "const uint8_t"
+    f.puts "#if defined __GNUC__"
+    f.puts "__attribute__((aligned(4)))"
+    f.puts "#endif"
+    f.puts "#{symbol}[] = {"
+    image.bytes.each_slice(16) {|s| f.puts s.map {|b| format("0x%02x,", b) }.join }
+    f.puts "};"
+  }
+else
+  File.binwrite(output, image)
+end
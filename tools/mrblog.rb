@@ -0,0 +1,185 @@
+#!/usr/bin/env ruby
+#
+# mrblog.rb - format table and decoder of the mruby/c Log records.
+#
+# Copyright (C) 2015-2020 Kyushu Institute of Technology.
+# Copyright (C) 2015-2020 Shimane IT Open-Innovation Center.
+#
+#  This file is distributed under BSD 3-Clause License.
+#
+# usage:
+#  ruby mrblog.rb table source.rb source.c ... > log.tbl
+#  ruby mrblog.rb decode [-t TICK_MS] log.tbl [console.txt]
+#
+#  table   extracts the format strings from the "log:" comments.
+#            Log.info(12, temp, humid)   #log: 12 "temp=%.1f humid=%d%%"
+#            MRBC_LOG_W( 13, err );      //log: 13 "I2C error %x"
+#          It checks duplicated ids, and the number of arguments of
+#          Log.xxx(id, ...) and MRBC_LOG_x(id, ...) calls.
+#  decode  converts "@L ..." lines (Log.flush) to text, and passes
+#          other console lines through.
+#  -t      tick unit in ms, MRBC_TICK_UNIT. (default 10)
+#
+
+LEVELS = %w(DEBUG INFO WARN ERROR)
+TYPE_INT, TYPE_FLOAT, TYPE_SPECIAL = 0, 1, 2
+SPECIALS = %w(nil false true ?)
+
+RE_DEFINE = %r{(?:#|//|/\*)\s*log:\s*(\d+)\s+"((?:[^"\\]|\\.)*)"}
+RE_RUBY_CALL = /\bLog\.(?:debug|info|warn|error)\s*\(?\s*(\d+)\s*(.*)/
+RE_C_CALL = /\bMRBC_LOG(?:_[DIWE]\s*\(|\s*\(\s*[^,]+,)\s*(\d+)\s*(.*)/
+RE_CONV = /%([-+ 0#]*\d*(?:\.\d+)?)([diuxXobfeEgGcs%])/
+
+
+# count arguments after the format id. ("..., a, b(c, d))" => 2)
+def count_args(rest)
+  depth = 0
+  n = 0
+  rest.each_char {|ch|
+    case ch
+    when "(", "[", "{" then depth += 1
+    when ")", "]", "}"
+      break if depth == 0
+      depth -= 1
+    when ","
+      n += 1 if depth == 0
+    when "#"
+      break if depth == 0
+    end
+  }
+  n
+end
+
+def count_conv(fmt)
+  fmt.scan(RE_CONV).count {|_, conv| conv != "%" }
+end
+
+
+def make_table(files)
+  table = {}
+  calls = []
+  errors = 0
+
+  files.each {|file|
+    File.foreach(file).with_index(1) {|line, lineno|
+      line.scan(RE_DEFINE) {|id, fmt|
+        id = id.to_i
+        if table[id] && table[id][0] != fmt
+          $stderr.puts "#{file}:#{lineno}: format id #{id} is already defined at #{table[id][1]}"
+          errors += 1
+        end
+        table[id] ||= [fmt, "#{file}:#{lineno}"]
+      }
+      code = line.sub(RE_DEFINE, "")
+      if (m = RE_RUBY_CALL.match(code) || RE_C_CALL.match(code))
+        calls << [m[1].to_i, count_args(m[2]), "#{file}:#{lineno}"]
+      end
+    }
+  }
+
+  calls.each {|id, n_args, where|
+    if !table[id]
+      $stderr.puts "#{where}: format id #{id} is not defined"
+      errors += 1
+    elsif (n = count_conv(table[id][0])) != n_args
+      $stderr.puts "#{where}: format id #{id} needs #{n} arguments, but #{n_args} given"
+      errors += 1
+    end
+  }
+
+  table.keys.sort.each {|id| puts "#{id}\t#{table[id][0]}" }
+  errors == 0
+end
+
+
+def load_table(file)
+  table = {}
+  File.foreach(file) {|line|
+    id, fmt = line.chomp.split("\t", 2)
+    table[id.to_i] = "\"#{fmt}\"".undump if fmt
+  }
+  table
+end
+
+
+def arg_value(word, type, conv)
+  case type
+  when TYPE_FLOAT
+    f = [word].pack("L").unpack1("f")
+    "diuxXobc".include?(conv) ? f.to_i : f
+  when TYPE_SPECIAL
+    SPECIALS[word & 3]
+  else
+    if "uxXob".include?(conv)
+      word
+    else
+      i = word >= 0x80000000 ? word - 0x100000000 : word
+      "feEgG".include?(conv) ? i.to_f : i
+    end
+  end
+end
+
+def format_record(table, words, tick_ms)
+  fmt_id = words[0] >> 16
+  n_args = (words[0] >> 12) & 0x0f
+  level = (words[0] >> 8) & 0x0f
+  task_id = words[0] & 0xff
+  types = n_args > 0 ? words[2] : 0
+  args = words[3, n_args] || []
+
+  head = format("[%10.3f] %-5s T%d ", words[1] * tick_ms / 1000.0,
+                LEVELS[level] || level.to_s, task_id)
+  fmt = table[fmt_id]
+  if !fmt
+    return head + "(format #{fmt_id}) " + args.map {|w| format("%08x", w) }.join(" ")
+  end
+
+  idx = 0
+  head + fmt.gsub(RE_CONV) {
+    flags, conv = $1, $2
+    next "%" if conv == "%"
+    if idx >= args.size
+      "?"
+    else
+      type = (types >> (idx * 2)) & 3
+      v = arg_value(args[idx], type, conv)
+      idx += 1
+      if v.is_a?(String)
+        format("%#{flags}s", v)
+      else
+        format("%#{flags}#{conv == 'u' ? 'd' : conv}", conv == "s" ? v.to_s : v)
+      end
+    end
+  }
+end
+
+def decode(table, input, tick_ms)
+  input.each_line {|line|
+    if line =~ /^@L((?: [0-9a-f]{8})+)\s*$/
+      words = $1.split.map {|w| w.to_i(16) }
+      puts format_record(table, words, tick_ms)
+    else
+      puts line
+    end
+  }
+end
+
+
+case ARGV.shift
+when "table"
+  exit(make_table(ARGV) ? 0 : 1)
+
+when "decode"
+  tick_ms = 10
+  if ARGV[0] == "-t"
+    ARGV.shift
+    tick_ms = ARGV.shift.to_f
+  end
+  table = load_table(ARGV.shift)
+  decode(table, ARGV[0] ? File.open(ARGV[0]) : $stdin, tick_ms)
+
+else
+  $stderr.puts "usage: ruby mrblog.rb table files... > log.tbl"
+  $stderr.puts "       ruby mrblog.rb decode [-t TICK_MS] log.tbl [console.txt]"
+  exit 1
+end
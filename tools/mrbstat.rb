@@ -0,0 +1,365 @@
+#!/usr/bin/env ruby
+#
+# mrbstat.rb - static resource analysis of .mrb images for mruby/c.
+#
+# Copyright (C) 2015-2020 Kyushu Institute of Technology.
+# Copyright (C) 2015-2020 Shimane IT Open-Innovation Center.
+#
+#  This file is distributed under BSD 3-Clause License.
+#
+# usage:
+#  ruby mrbstat.rb [-v] [-b BUILTIN_SYMBOLS] [-r MAX_REGS_SIZE] file.mrb ...
+#
+#  -v   print table of each irep.
+#  -b   # of symbols registered by mrbc_init(). (default 161)
+#  -r   current MAX_REGS_SIZE. (default 100)
+#
+#  Give all images of the application (mrblib and tasks) at once.
+#  Methods defined in any image are used to follow the calls.
+#  Same algorithm as components/mrubyc/src/analyze.c, which runs on
+#  the target. Object sizes below are for ESP32 (32bit, double aligned
+#  to 8), change them for other targets.
+#
+
+SIZE = {
+  value: 16, object: 16, irep: 32, string: 12, array: 12, hash: 12,
+  range: 40, proc: 24, class: 16, callinfo: 28, tcb_base: 88, pointer: 4,
+  handler: 8,
+}
+
+# operand types of each opcode. (same as verify.c)
+Z, B, BB, BBB, BS, S, W = 0, 1, 2, 3, 4, 5, 6
+OPERAND_TYPE = [
+  Z,   BB,  BB,  BB,  BB,  B,   B,   B,   B,   B,   B,   B,   B,   B,   BB,  B,
+  B,   B,   B,   BB,  BB,  BB,  BB,  BB,  BB,  BB,  BB,  BB,  BB,  BB,  BB,  BBB,
+  BBB, S,   BS,  BS,  BS,  S,   B,   BB,  B,   B,   B,   B,   BB,  BB,  BBB, BBB,
+  Z,   BB,  BS,  W,   BB,  Z,   BB,  B,   B,   B,   BS,  B,   BB,  B,   BB,  B,
+  B,   B,   B,   B,   B,   B,   BB,  BBB, B,   B,   B,   BBB, BBB, BBB, B,   BB,
+  B,   BB,  BB,  B,   BB,  BB,  BB,  B,   B,   B,   BB,  BB,  BB,  BB,  BB,  B,
+  B,   B,   BBB, B,   Z,   Z,   Z,   Z,   Z,
+]
+
+OP_ONERR     = 0x25; OP_EPUSH     = 0x2a
+OP_SENDV     = 0x2c; OP_SENDVB    = 0x2d; OP_SEND   = 0x2e; OP_SENDB  = 0x2f
+OP_SUPER     = 0x31; OP_ARRAY     = 0x46; OP_ARRAY2 = 0x47; OP_STRING = 0x4f
+OP_HASH      = 0x51; OP_LAMBDA    = 0x54; OP_BLOCK  = 0x55; OP_METHOD = 0x56
+OP_RANGE_INC = 0x57; OP_RANGE_EXC = 0x58; OP_CLASS  = 0x5a; OP_MODULE = 0x5b
+OP_EXEC      = 0x5c; OP_DEF       = 0x5d; OP_EXT1   = 0x64; OP_EXT3   = 0x66
+
+
+def block_size(size)
+  return 0 if size == 0
+  size = (size + 4 + 3) & ~3            # header and alignment.
+  [size, 4 + SIZE[:pointer] * 3].max
+end
+
+
+class Irep
+  attr_accessor :nlocals, :nregs, :ilen, :code, :pools, :syms, :reps
+  attr_accessor :name, :depth, :regs, :state, :alloc_sites, :object_bytes
+  attr_accessor :handlers
+  attr_accessor :file
+
+  def initialize
+    @reps = []
+    @state = 0
+    @alloc_sites = 0
+    @object_bytes = 0
+    @handlers = 0
+  end
+
+  # iterate instructions. yields opcode and operands.
+  def each_insn
+    pc = 0
+    ext = 0
+    while pc < @ilen
+      op = @code.getbyte(pc)
+      pc += 1
+      opr = [0, 0, 0]
+      rd = lambda {|wide| v = wide ? @code[pc, 2].unpack1("n") : @code.getbyte(pc)
+                          pc += wide ? 2 : 1; v }
+      case OPERAND_TYPE[op]
+      when B   then opr[0] = rd.(ext & 1 != 0)
+      when BB  then opr[0] = rd.(ext & 1 != 0); opr[1] = rd.(ext & 2 != 0)
+      when BBB then opr[0] = rd.(ext & 1 != 0); opr[1] = rd.(ext & 2 != 0)
+                    opr[2] = rd.(false)
+      when BS  then opr[0] = rd.(ext & 1 != 0); opr[1] = rd.(true)
+      when S   then opr[0] = rd.(true)
+      when W   then opr[0] = (@code.getbyte(pc) << 16) | @code[pc+1, 2].unpack1("n")
+                    pc += 3
+      end
+      ext = (OP_EXT1..OP_EXT3).include?(op) ? op - OP_EXT1 + 1 : 0
+      yield op, *opr
+    end
+  end
+
+  def each_irep(&block)
+    block.call(self)
+    @reps.each {|r| r.each_irep(&block) }
+  end
+end
+
+
+#
+# read .mrb (RITE0006) image.
+#
+def load_mrb(fname)
+  bin = File.binread(fname)
+  raise "#{fname}: not a RITE0006 image." if bin[0, 8] != "RITE0006"
+
+  pos = 22
+  while pos < bin.size
+    id, size = bin[pos, 8].unpack("a4N")
+    if id == "IREP"
+      irep_pos = pos + 12
+      return load_irep(bin, irep_pos, fname).first
+    end
+    break if id == "END\0"
+    pos += size
+  end
+  raise "#{fname}: no IREP section."
+end
+
+def load_irep(bin, pos, fname)
+  irep = Irep.new
+  irep.file = fname
+  irep.nlocals, irep.nregs, rlen, irep.ilen = bin[pos + 4, 10].unpack("nnnN")
+  pos += 14
+  pos += -pos & 3                       # padding
+  irep.code = bin[pos, irep.ilen]
+  pos += irep.ilen
+
+  irep.pools = []
+  npools = bin[pos, 4].unpack1("N")
+  pos += 4
+  npools.times {
+    tt, len = bin[pos, 3].unpack("Cn")
+    irep.pools << [tt, bin[pos + 3, len]]
+    pos += 3 + len
+  }
+
+  irep.syms = []
+  nsyms = bin[pos, 4].unpack1("N")
+  pos += 4
+  nsyms.times {
+    len = bin[pos, 2].unpack1("n")
+    irep.syms << bin[pos + 2, len]
+    pos += 2 + len + 1
+  }
+
+  rlen.times {
+    child, pos = load_irep(bin, pos, fname)
+    irep.reps << child
+  }
+  [irep, pos]
+end
+
+
+#
+# scan the irep, to find method names and alloc sites.
+#
+def scan_irep(irep)
+  method_reg = method_rep = nil
+  irep.each_insn {|op, a, b, c|
+    size = case op
+           when OP_METHOD
+             method_reg, method_rep = a, b
+             block_size(SIZE[:proc])
+           when OP_DEF
+             irep.reps[method_rep].name = irep.syms[b] if a + 1 == method_reg
+             method_reg = nil
+             0
+           when OP_STRING
+             block_size(SIZE[:string]) + block_size(irep.pools[b][1].size + 1)
+           when OP_ARRAY  then block_size(SIZE[:array]) + block_size(SIZE[:value] * b)
+           when OP_ARRAY2 then block_size(SIZE[:array]) + block_size(SIZE[:value] * c)
+           when OP_HASH   then block_size(SIZE[:hash]) + block_size(SIZE[:value] * b * 2)
+           when OP_RANGE_INC, OP_RANGE_EXC then block_size(SIZE[:range])
+           when OP_LAMBDA, OP_BLOCK        then block_size(SIZE[:proc])
+           when OP_CLASS, OP_MODULE        then block_size(SIZE[:class])
+           when OP_ONERR, OP_EPUSH
+             irep.handlers += 1
+             0
+           else 0
+           end
+    next if size == 0
+    irep.alloc_sites += 1
+    irep.object_bytes += size
+  }
+end
+
+
+#
+# calculate call depth and registers of the irep.
+#
+class Analyzer
+  attr_reader :recursion
+
+  def initialize(ireps)
+    @ireps = ireps
+    @recursion = nil
+  end
+
+  def call_cost(name, caller)
+    found = false
+    depth = regs = 0
+    @ireps.each {|nd|
+      next if nd.equal?(caller) || nd.name != name
+      visit(nd)
+      if nd.state != 2 || nd.depth < 0
+        @recursion ||= name
+        return nil
+      end
+      found = true
+      depth = [depth, nd.depth].max
+      regs = [regs, nd.regs].max
+    }
+    [found, depth, regs]
+  end
+
+  def visit(nd)
+    return if nd.state != 0
+    nd.state = 1
+    depth = 0
+    regs = nd.nregs
+    unbounded = false
+    block_rep = nil
+
+    nd.each_insn {|op, a, b, c|
+      d = r = 0
+      case op
+      when OP_BLOCK
+        block_rep = b
+        next
+
+      when OP_SEND, OP_SENDB, OP_SENDV, OP_SENDVB, OP_SUPER
+        if op == OP_SUPER
+          name, argc = nd.name, b
+        else
+          name = nd.syms[b]
+          argc = (op == OP_SEND || op == OP_SENDB) ? c : 1
+        end
+        argc = 1 if argc == 127
+
+        cost = name ? call_cost(name, nd) : [false, 0, 0]
+        unless cost
+          unbounded = true
+          break
+        end
+        found, d, r = cost
+        r = argc + 2 unless found       # C function.
+
+        if (op == OP_SENDB || op == OP_SENDVB) && block_rep
+          blk = nd.reps[block_rep]
+          visit(blk)
+          if blk.state != 2 || blk.depth < 0
+            unbounded = true
+            break
+          end
+          d += blk.depth
+          r += blk.regs
+        end
+        block_rep = nil
+        r += a
+
+      when OP_EXEC
+        body = nd.reps[b]
+        visit(body)
+        if body.state != 2 || body.depth < 0
+          unbounded = true
+          break
+        end
+        d = body.depth
+        r = a + body.regs
+
+      else
+        next
+      end
+
+      depth = [depth, d].max
+      regs = [regs, r].max
+    }
+
+    nd.depth = unbounded ? -1 : depth + 1
+    nd.regs = unbounded ? -1 : regs
+    nd.state = 2
+  end
+end
+
+
+#
+# main
+#
+verbose = false
+builtin_symbols = 161
+max_regs_size = 100
+files = []
+while arg = ARGV.shift
+  case arg
+  when "-v" then verbose = true
+  when "-b" then builtin_symbols = ARGV.shift.to_i
+  when "-r" then max_regs_size = ARGV.shift.to_i
+  else files << arg
+  end
+end
+if files.empty?
+  STDERR.puts "usage: ruby #{$0} [-v] [-b BUILTIN_SYMBOLS] [-r MAX_REGS_SIZE] file.mrb ..."
+  exit 1
+end
+
+tops = files.map {|f| load_mrb(f) }
+ireps = []
+tops.each {|top| top.each_irep {|irep| ireps << irep } }
+ireps.each {|irep| scan_irep(irep) }
+analyzer = Analyzer.new(ireps)
+ireps.each {|irep| analyzer.visit(irep) }
+
+if verbose
+  puts "IREP NREGS NLOCALS  ILEN PLEN RLEN ALLOC(bytes) DEPTH REGS NAME"
+  ireps.each_with_index {|nd, i|
+    printf("%4d %5d %7d %5d %4d %4d %5d(%5d) %5d %4d %s\n", i,
+           nd.nregs, nd.nlocals, nd.ilen, nd.pools.size, nd.reps.size,
+           nd.alloc_sites, nd.object_bytes, nd.depth, nd.regs, nd.name)
+  }
+  puts
+end
+
+unbounded = ireps.any? {|nd| nd.depth < 0 }
+max_depth = ireps.map(&:depth).max
+max_regs = ireps.map(&:regs).max
+symbols = ireps.flat_map(&:syms).uniq
+literal_bytes = ireps.sum {|nd| nd.pools.sum {|tt, s| tt == 0 ? s.size + 1 : 0 } }
+irep_bytes = ireps.sum {|nd|
+  block_size(SIZE[:irep]) + block_size(SIZE[:pointer] * nd.reps.size) +
+    block_size(SIZE[:pointer] * nd.pools.size) +
+    block_size(SIZE[:object]) * nd.pools.size +
+    (nd.handlers > 0 ? block_size(SIZE[:handler] * nd.handlers) : 0)
+}
+object_bytes = ireps.sum(&:object_bytes)
+callinfo_bytes = unbounded ? 0 : block_size(SIZE[:callinfo]) * (max_depth - 1)
+regs = unbounded ? max_regs_size : max_regs
+task_bytes = block_size(SIZE[:tcb_base] + SIZE[:value] * regs)
+total = irep_bytes + task_bytes * tops.size + callinfo_bytes + object_bytes
+
+tops.each {|top|
+  d = top.depth < 0 ? "unbounded" : top.depth
+  r = top.regs < 0 ? "unbounded" : top.regs
+  puts "#{top.file}: call depth #{d}, registers #{r}"
+}
+if unbounded
+  puts "Call depth: unbounded (recursive call of '#{analyzer.recursion}')"
+else
+  puts "Call depth: #{max_depth}"
+end
+puts "Symbols: #{symbols.size} in images"
+puts "String literals: #{literal_bytes} bytes"
+puts "Heap: irep #{irep_bytes} + task #{task_bytes}*#{tops.size} + callinfo #{callinfo_bytes} + objects #{object_bytes} = #{total} bytes"
+puts
+puts "Recommended:"
+if unbounded
+  puts " MAX_REGS_SIZE      #{max_regs_size} (unbounded, keep current)"
+else
+  puts " MAX_REGS_SIZE      #{max_regs}"
+end
+puts " MAX_SYMBOLS_COUNT  #{builtin_symbols + symbols.size}"
+puts " memory pool        #{total} + runtime objects (bytes)"
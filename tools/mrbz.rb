@@ -0,0 +1,134 @@
+#!/usr/bin/env ruby
+#
+# mrbz.rb - compress .mrb image for mruby/c. (LZSS, heatshrink compatible stream)
+#
+# Copyright (C) 2015-2020 Kyushu Institute of Technology.
+# Copyright (C) 2015-2020 Shimane IT Open-Innovation Center.
+#
+#  This file is distributed under BSD 3-Clause License.
+#
+# usage:
+#  ruby mrbz.rb [-w WINDOW_BITS] [-l LOOKAHEAD_BITS] [-B symbol] -o output input.mrb
+#
+#  WINDOW_BITS     4..15  (default 8)
+#  LOOKAHEAD_BITS  3..WINDOW_BITS-1  (default 4)
+#
+#  The device needs no window buffer; it decompresses into the RAM image.
+#  See components/mrubyc/src/decompress.c for the image format.
+#
+
+class BitWriter
+  attr_reader :buf
+
+  def initialize
+    @buf = "".b
+    @cur = 0
+    @n = 0
+  end
+
+  def put(value, bits)
+    (bits - 1).downto(0) {|i|
+      @cur = (@cur << 1) | ((value >> i) & 1)
+      @n += 1
+      if @n == 8
+        @buf << @cur.chr
+        @cur = 0
+        @n = 0
+      end
+    }
+  end
+
+  def finish
+    @buf << (@cur << (8 - @n)).chr if @n > 0
+    @buf
+  end
+end
+
+def compress(data, wbits, lbits)
+  window = 1 << wbits
+  max_len = 1 << lbits
+  # use back reference only when it is shorter than literals.
+  min_len = (1 + wbits + lbits) / 9 + 1
+  chains = Hash.new {|h, k| h[k] = [] }
+  out = BitWriter.new
+  pos = 0
+
+  while pos < data.bytesize
+    best_len = 0
+    best_dist = 0
+    if pos + 2 <= data.bytesize
+      key = data.byteslice(pos, 2)
+      chains[key].reverse_each {|cand|
+        dist = pos - cand
+        break if dist > window
+        len = 0
+        len += 1 while len < max_len && pos + len < data.bytesize &&
+                       data.getbyte(cand + len) == data.getbyte(pos + len)
+        if len > best_len
+          best_len = len
+          best_dist = dist
+          break if len == max_len
+        end
+      }
+    end
+
+    step = 1
+    if best_len >= min_len
+      out.put(0, 1)
+      out.put(best_dist - 1, wbits)
+      out.put(best_len - 1, lbits)
+      step = best_len
+    else
+      out.put(1, 1)
+      out.put(data.getbyte(pos), 8)
+    end
+    step.times {
+      chains[data.byteslice(pos, 2)] << pos if pos + 2 <= data.bytesize
+      pos += 1
+    }
+  end
+  out.finish
+end
+
+wbits = 8
+lbits = 4
+symbol = nil
+output = nil
+input = nil
+while arg = ARGV.shift
+  case arg
+  when "-w" then wbits = ARGV.shift.to_i
+  when "-l" then lbits = ARGV.shift.to_i
+  when "-B" then symbol = ARGV.shift
+  when "-o" then output = ARGV.shift
+  else input = arg
+  end
+end
+if !input || !output || !(4..15).include?(wbits) || !(3...wbits).include?(lbits)
+  STDERR.puts "usage: #{$0} [-w 4..15] [-l 3..w-1] [-B symbol] -o output input.mrb"
+  exit 1
+end
+
+data = File.binread(input)
+raise "#{input}: not a RITE binary" unless data.start_with?("RITE")
+z = compress(data, wbits, lbits)
+image = ["MRBZ", wbits, lbits, 0, data.bytesize, z.bytesize].pack("a4CCnNN") + z
+STDERR.puts format("%s: %d -> %d bytes (%.1f%%)", input, data.bytesize,
+                   image.bytesize, 100.0 * image.bytesize / data.bytesize)
+
+if symbol
+  File.open(output, "w") {|f|
+    f.puts "/* compressed by mrbz.rb from #{File.basename(input)} */"
+    f.puts "#include <stdint.h>"
+    f.puts "extern const uint8_t #{symbol}[];"
+    f.puts "const uint8_t"
+    f.puts "#if defined __GNUC__"
+    f.puts "__attribute__((aligned(4)))"
+    f.puts "#endif"
+    f.puts "#{symbol}[] = {"
+    image.bytes.each_slice(16) {|s| f.puts s.map {|b| format("0x%02x,", b) }.join }
+    f.puts "};"
+  }
+else
+  File.binwrite(output, image)
+end